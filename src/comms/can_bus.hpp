@@ -0,0 +1,61 @@
+#ifndef CAN_BUS_HPP
+#define CAN_BUS_HPP
+
+#include <stdint.h>
+
+#define CAN_FRAME_SIZE 8 // data bytes in a classic CAN frame
+
+/// @brief A standard CAN frame as rm_CAN sees it. Backends convert to and from their driver's own type,
+/// so nothing above the backend depends on FlexCAN
+struct CANFrame {
+    /// @brief frame ID
+    uint32_t id = 0;
+    /// @brief whether id is a 29 bit extended ID
+    bool extended = false;
+    /// @brief number of data bytes
+    uint8_t len = CAN_FRAME_SIZE;
+    /// @brief data bytes
+    uint8_t buf[CAN_FRAME_SIZE] = { 0 };
+    /// @brief bus the frame arrived on, numbered from 1 like FlexCAN (1 for CAN1)
+    uint8_t bus = 0;
+};
+
+/// @brief Receive callback type, called with each received frame
+typedef void (*can_receive_fn_t)(const CANFrame& frame);
+
+/// @brief Outcome of handing a frame to a CANBus
+enum CANWriteResult {
+    CAN_WRITE_SENT,     // went straight into a TX mailbox
+    CAN_WRITE_QUEUED,   // no free mailbox, held in the driver's TX queue and sent from the TX ISR
+    CAN_WRITE_FULL,     // no free mailbox and the TX queue is full, dropped
+    CAN_WRITE_BUS_OFF   // the controller is bus off, dropped
+};
+
+/// @brief A single CAN bus as seen by rm_CAN. Lets rm_CAN treat every FlexCAN instance the same way,
+/// and lets a different backend (e.g. a fake bus on a host) stand in for the hardware.
+class CANBus {
+public:
+    /// @brief Virtual destructor so backends can be deleted through this interface
+    virtual ~CANBus() = default;
+
+    /// @brief Start the bus and route every received frame to a handler
+    /// @param baud_rate bus speed in bits per second
+    /// @param handler called with each received frame (from the receive ISR on hardware)
+    virtual void init(uint32_t baud_rate, can_receive_fn_t handler) = 0;
+
+    /// @brief Queue a frame for transmission
+    /// @param frame frame to send
+    /// @return whether the frame went out, was queued or was dropped
+    virtual CANWriteResult write(const CANFrame& frame) = 0;
+
+    /// @brief Only accept the given standard IDs in hardware
+    /// @param ids array of standard IDs to accept
+    /// @param num_ids number of IDs, 0 rejects everything
+    virtual void set_filters(const uint32_t* ids, int num_ids) = 0;
+
+    /// @brief Get the hardware transmit error counter (TEC)
+    /// @return transmit error counter
+    virtual uint32_t get_tx_error_counter() = 0;
+};
+
+#endif // CAN_BUS_HPP
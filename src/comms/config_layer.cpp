@@ -182,5 +182,13 @@ void Config::fill_data(CommsPacket packets[MAX_CONFIG_PACKETS], uint8_t sizes[MA
         if (id == yaml_section_id_mappings.at("encoder_pins")) {
             memcpy(encoder_pins, packets[i].raw + 8, sub_size);
         }
+        if (id == yaml_section_id_mappings.at("motor_info")) {
+            size_t linear_index = index / sizeof(float);
+            size_t i1 = linear_index / 3;
+            size_t i2 = linear_index % 3;
+            memcpy(&motor_info[i1][i2], packets[i].raw + 8, sub_size);
+            index += sub_size;
+            has_motor_info = true;
+        }
     }
 }
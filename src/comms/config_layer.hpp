@@ -36,7 +36,8 @@ static const std::map<std::string, u_int8_t> yaml_section_id_mappings = {
     {"drive_conversion_factors", 20},
     {"governor_types", 21},
     {"odom_values", 22},
-    {"encoder_pins", 23}
+    {"encoder_pins", 23},
+    {"motor_info", 24}
 };
 
 /// @brief struct to hold configuration data
@@ -97,6 +98,10 @@ struct Config {
     float switcher_values[2];
     /// @brief pin numbers on the teensy for the encoders
     float encoder_pins[2];
+    /// @brief bus location of each motor: CAN bus (1-3, 0 if unused), motor ID on the bus (1-8), controller type
+    float motor_info[NUM_MOTORS][3];
+    /// @brief whether the yaml had a motor_info section, otherwise the default motor map is used
+    bool has_motor_info = false;
 
 private:
     /// @brief keep track of past index for when there are multiple packets for a section
@@ -0,0 +1,10 @@
+#include "flexcan_bus.hpp"
+#include "rm_can.hpp"
+
+// the Teensy 4.1's FlexCAN controllers, kept out of rm_can.cpp so it builds without FlexCAN
+static FlexCANBus<CAN1> s_can1;
+static FlexCANBus<CAN2> s_can2;
+static FlexCANBus<CAN3> s_can3;
+static CANBus* s_flexcan_buses[NUM_CAN_BUSES] = { &s_can1, &s_can2, &s_can3 };
+
+rm_CAN::rm_CAN() : rm_CAN(s_flexcan_buses) {}
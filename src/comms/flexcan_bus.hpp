@@ -0,0 +1,73 @@
+#ifndef FLEXCAN_BUS_HPP
+#define FLEXCAN_BUS_HPP
+
+// FlexCAN_T4 library
+// Documentation: https://github.com/tonton81/FlexCAN_T4
+#include <FlexCAN_T4.h>
+#include "can_bus.hpp"
+
+/// @brief CANBus backed by one of the Teensy's FlexCAN controllers
+/// @tparam _bus FlexCAN controller (CAN1, CAN2 or CAN3)
+template <CAN_DEV_TABLE _bus>
+class FlexCANBus : public CANBus {
+public:
+    void init(uint32_t baud_rate, can_receive_fn_t handler) override {
+        s_handler = handler;
+
+        // events() is never called, so onReceive handlers run directly in the ISR instead of through the RX queue
+        can.begin();
+        can.setBaudRate(baud_rate);
+        can.enableFIFO(true);
+        can.onReceive(receive_isr);
+        can.enableFIFOInterrupt();
+    }
+
+    CANWriteResult write(const CANFrame& frame) override {
+        // the driver reports bus off the same way as a queued frame, so check the controller's fault state (FLTCONF) first
+        if (FLEXCANb_ESR1(_bus) & 0x20) return CAN_WRITE_BUS_OFF;
+
+        CAN_message_t msg;
+        msg.id = frame.id;
+        msg.flags.extended = frame.extended;
+        msg.len = frame.len;
+        memcpy(msg.buf, frame.buf, CAN_FRAME_SIZE);
+
+        // a queued frame is also reported as written, so watch the TX queue to tell if a mailbox was free
+        uint32_t queued = can.getTXQueueCount();
+        if (!can.write(msg)) return CAN_WRITE_FULL;
+        return can.getTXQueueCount() > queued ? CAN_WRITE_QUEUED : CAN_WRITE_SENT;
+    }
+
+    void set_filters(const uint32_t* ids, int num_ids) override {
+        // block everything, then open one FIFO filter per ID (8 table A filters)
+        can.setFIFOFilter(REJECT_ALL);
+        for (int i = 0; i < num_ids; i++) can.setFIFOFilter(i, ids[i], STD);
+    }
+
+    uint32_t get_tx_error_counter() override { return FLEXCANb_ECR(_bus) & 0xff; }
+
+private:
+    /// @brief Converts a received FlexCAN message and forwards it to the handler
+    /// @param msg received message
+    static void receive_isr(const CAN_message_t& msg) {
+        CANFrame frame;
+        frame.id = msg.id;
+        frame.extended = msg.flags.extended;
+        frame.len = msg.len;
+        frame.bus = msg.bus;
+        memcpy(frame.buf, msg.buf, CAN_FRAME_SIZE);
+        if (s_handler) s_handler(frame);
+    }
+
+    /// @brief handler given to init(), one per controller since FlexCAN callbacks carry no context
+    static can_receive_fn_t s_handler;
+
+    /// @brief FlexCAN object
+    /// @note frames are handled in the ISR so the driver's RX queue is unused and kept small
+    FlexCAN_T4<_bus, RX_SIZE_16, TX_SIZE_16> can;
+};
+
+template <CAN_DEV_TABLE _bus>
+can_receive_fn_t FlexCANBus<_bus>::s_handler = nullptr;
+
+#endif // FLEXCAN_BUS_HPP
@@ -1,77 +1,226 @@
 #include "rm_can.hpp"
+#include "../utils/logger.hpp"
 
-rm_CAN::rm_CAN() {}
+rm_CAN* rm_CAN::s_instance = nullptr;
+
+rm_CAN::rm_CAN(CANBus* buses[NUM_CAN_BUSES]) {
+    for (int i = 0; i < NUM_CAN_BUSES; i++) m_buses[i] = buses[i];
+
+    // default map, the first two buses in order
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        if (i < NUM_DEFAULT_MOTORS) {
+            m_motors[i].can_id = i / NUM_MOTORS_PER_BUS;
+            m_motors[i].motor_id = i % NUM_MOTORS_PER_BUS + 1;
+        }
+        m_motor_active[i] = true;
+    }
+    update_routing();
+}
 
 void rm_CAN::init() {
-    // initialize CAN 1
-    m_can1.begin();
-    m_can1.setBaudRate(1000000);
-    m_can1.enableFIFO(true);
-
-    // initialize CAN 2
-    m_can2.begin();
-    m_can2.setBaudRate(1000000);
-    m_can2.enableFIFO(true);
-
-    // set message IDs for CAN 1
-    m_output[CAN_1][0].id = 0x200;
-    m_output[CAN_1][1].id = 0x1ff;
-    m_output[CAN_1][2].id = 0x2ff;
-
-    // set message IDs for CAN 2
-    m_output[CAN_2][0].id = 0x200;
-    m_output[CAN_2][1].id = 0x1ff;
-    m_output[CAN_2][2].id = 0x2ff;
+    s_instance = this;
+
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        m_buses[i]->init(CAN_BAUD_RATE, receive_isr);
+
+        // set message IDs
+        m_output[i][0].id = 0x200;
+        m_output[i][1].id = 0x1ff;
+        m_output[i][2].id = 0x2ff;
+    }
+
+    // program the filters if the active motors were set before init
+    update_routing();
+    m_window_start_us = micros();
 
     // zero CANs just in case
     zero();
 }
 
 void rm_CAN::read() {
-    // read from CAN 1
-    CAN_message_t msg1;
-    while (m_can1.read(msg1)) {
-        // isolate the ID part of the message id (0x202 becomes 2)
-        int id = msg1.id & 0xf;
-        id -= 1; // subtract by 1 to allow for array indexing
-
-        // fill appropriate buffer
-        for (int i = 0; i < CAN_MESSAGE_SIZE; i++) {
-            m_input.data[CAN_1][id][i] = msg1.buf[i];
-        }
+    // copy with interrupts off so no motor's frame is half written and all motors come from the same instant
+    noInterrupts();
+    memcpy(&m_input, &m_mailbox, sizeof(CANData));
+    interrupts();
+
+    uint32_t now = micros();
+
+    // an active motor is online if it has ever reported and its latest frame is recent enough
+    uint32_t online = 0;
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        const MotorInfo& motor = m_motors[i];
+        if (!m_motor_active[i] || motor.can_id < 0) continue;
+
+        int slot = motor.motor_id - 1;
+        if (m_input.seq[motor.can_id][slot] == 0) continue;
+        if (now - m_input.timestamp[motor.can_id][slot] < m_motor_timeout_us) online |= 1ul << i;
     }
+    m_input.online_mask = online;
+
+    update_stats(now);
+}
 
-    // read from CAN 2
-    CAN_message_t msg2;
+void rm_CAN::receive(const CANFrame& frame, uint32_t now_us) {
+    // FlexCAN numbers buses from 1
+    int bus = frame.bus - 1;
+    // feedback ID to motor slot (0x202 becomes 1)
+    int id = (int)frame.id - CAN_FEEDBACK_BASE_ID - 1;
 
-    while (m_can2.read(msg2)) {
-        // isolate the ID part of the message id (0x202 becomes 2)
-        int id = msg2.id & 0xf;
-        id -= 1; // subtract by 1 to allow for array indexing
+    if (bus < 0 || bus >= NUM_CAN_BUSES) return;
+    m_rx_frames[bus] = m_rx_frames[bus] + 1;
 
-        // fill appropriate buffer
-        for (int i = 0; i < CAN_MESSAGE_SIZE; i++) m_input.data[CAN_2][id][i] = msg2.buf[i];
+    // drop anything that isn't feedback from an active motor, the hardware filters should catch most of these
+    if (frame.extended || id < 0 || id >= NUM_MOTORS_PER_BUS || !m_slot_active[bus][id]) {
+        m_rx_rejected[bus] = m_rx_rejected[bus] + 1;
+        return;
     }
+
+    // fill appropriate buffer
+    memcpy(m_mailbox.data[bus][id], frame.buf, CAN_MESSAGE_SIZE);
+    m_mailbox.decode(bus, id, now_us);
+}
+
+void rm_CAN::zero_position(uint16_t canID, uint16_t motorID, float position) {
+    int index = can_motor_index(canID, motorID);
+    int64_t offset = (int64_t)(position * (MOTOR_ANGLE_RESOLUTION / (2 * PI)));
+
+    // the mailbox belongs to the ISR
+    noInterrupts();
+    m_mailbox.position_zero[index] = m_mailbox.position_count[index] - offset;
+    interrupts();
+}
+
+void rm_CAN::receive_isr(const CANFrame& frame) {
+    if (s_instance) s_instance->receive(frame, micros());
 }
 
 uint8_t rm_CAN::write() {
-    int w1, w2;
+    // never command a motor we can't hear from
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        const MotorInfo& motor = m_motors[i];
+        if (m_motor_active[i] && motor.can_id >= 0 && !m_input.is_online(i)) write_motor(motor.can_id, motor.motor_id, 0);
+    }
+
+    bool success = true;
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        if (!write_bus(i)) success = false;
+    }
+
+    return success;
+}
 
-    // write all messages to CAN 1
-    for (int i = 0; i < NUM_MESSAGE_IDS; i++)
-        w1 = m_can1.write(m_output[CAN_1][i]);
+bool rm_CAN::write_bus(uint16_t canID) {
+    CANBus* can = m_buses[canID];
+    CANBusStats& stats = m_stats[canID];
+    bool success = true;
 
-    // write all messages to CAN 2
-    for (int i = 0; i < NUM_MESSAGE_IDS; i++)
-        w2 = m_can2.write(m_output[CAN_2][i]);
+    for (int i = 0; i < NUM_MESSAGE_IDS; i++) {
+        // no motors on this group, don't spend bus bandwidth on it
+        if (!m_group_active[canID][i]) continue;
 
-    // normalize from the -1 or 1 output of CAN write command to 0 or 1
-    if (w1 == -1)
-        w1 = 0;
-    if (w2 == -1)
-        w2 = 0;
+        switch (can->write(m_output[canID][i])) {
+        case CAN_WRITE_QUEUED:
+            // still goes out once a mailbox frees up
+            stats.tx_mailbox_full++;
+            stats.tx_frames++;
+            break;
+        case CAN_WRITE_SENT:
+            stats.tx_frames++;
+            break;
+        default:
+            stats.tx_dropped++;
+            success = false;
+            break;
+        }
+    }
+
+    return success;
+}
+
+void rm_CAN::set_motor_map(const MotorInfo motors[NUM_MOTORS]) {
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        m_motors[i] = motors[i];
+
+        // drop anything that doesn't point at a real slot rather than writing out of bounds later
+        if (m_motors[i].can_id >= NUM_CAN_BUSES || m_motors[i].motor_id < 1 || m_motors[i].motor_id > NUM_MOTORS_PER_BUS) {
+            if (m_motors[i].can_id >= 0) LOG_WARN("CAN: motor %d mapped to invalid bus %d motor %d, ignoring", i, m_motors[i].can_id, m_motors[i].motor_id);
+            m_motors[i].can_id = -1;
+        }
+    }
+    update_routing();
+}
+
+void rm_CAN::set_active_motors(const bool active[NUM_MOTORS]) {
+    for (int i = 0; i < NUM_MOTORS; i++) m_motor_active[i] = active[i];
+    m_filters_enabled = true;
+    update_routing();
+}
+
+void rm_CAN::write_motors(const float values[NUM_MOTORS]) {
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        const MotorInfo& motor = m_motors[i];
+        if (motor.can_id >= 0) write_motor_norm(motor.can_id, motor.motor_id, motor.controller_type, values[i]);
+    }
+}
+
+void rm_CAN::update_routing() {
+    bool slot_active[NUM_CAN_BUSES][NUM_MOTORS_PER_BUS] = {};
+    int8_t motor_slot[NUM_MOTORS];
+
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        const MotorInfo& motor = m_motors[i];
+        motor_slot[i] = motor.can_id >= 0 ? can_motor_index(motor.can_id, motor.motor_id) : -1;
+        if (motor.can_id >= 0 && m_motor_active[i]) slot_active[motor.can_id][motor.motor_id - 1] = true;
+    }
+
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        // same motor to message mapping as write_motor()
+        for (int j = 0; j < NUM_MESSAGE_IDS; j++) m_group_active[i][j] = false;
+        for (int j = 0; j < NUM_MOTORS_PER_BUS; j++) {
+            if (slot_active[i][j]) m_group_active[i][j / 4] = true;
+        }
+    }
+
+    // the receive ISR reads these
+    noInterrupts();
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        for (int j = 0; j < NUM_MOTORS_PER_BUS; j++) m_slot_active[i][j] = slot_active[i][j];
+    }
+    memcpy(m_mailbox.motor_slot, motor_slot, sizeof(motor_slot));
+    interrupts();
+    memcpy(m_input.motor_slot, motor_slot, sizeof(motor_slot));
+
+    // leave the hardware accepting everything until we know which motors are in use and the buses are started
+    if (!m_filters_enabled || s_instance != this) return;
+
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        // one FIFO filter per active motor (8 table A filters, one per slot)
+        uint32_t ids[NUM_MOTORS_PER_BUS];
+        int num_ids = 0;
+        for (int j = 0; j < NUM_MOTORS_PER_BUS; j++) {
+            if (slot_active[i][j]) ids[num_ids++] = CAN_FEEDBACK_BASE_ID + j + 1;
+        }
+        m_buses[i]->set_filters(ids, num_ids);
+    }
+}
+
+void rm_CAN::update_stats(uint32_t now_us) {
+    uint32_t elapsed = now_us - m_window_start_us;
+    if (elapsed < CAN_STATS_WINDOW_US) return;
+
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        CANBusStats& stats = m_stats[i];
+        stats.rx_frames = m_rx_frames[i];
+        stats.rx_rejected = m_rx_rejected[i];
+
+        // every frame on the wire uses bandwidth, whichever direction it went
+        uint32_t frames = stats.tx_frames + stats.rx_frames;
+        stats.utilization = (float)(frames - m_window_frames[i]) * CAN_FRAME_BITS / ((float)elapsed * (CAN_BAUD_RATE / 1E6));
+        m_window_frames[i] = frames;
+    }
+    for (int i = 0; i < NUM_CAN_BUSES; i++) m_stats[i].tx_error_counter = m_buses[i]->get_tx_error_counter();
 
-    return w1 && w2;
+    m_window_start_us = now_us;
 }
 
 void rm_CAN::zero_motors() {
@@ -123,7 +272,7 @@ void rm_CAN::write_motor_norm(uint16_t canID, uint16_t motorID, uint8_t controll
         write_motor(canID, motorID, (int)(value * GM6020_OUTPUT_SCALE));
         break;
     default:
-        Serial.println("CURo WARN: Invalid motor controller type on write_motor_norm() call!");
+        LOG_WARN("CURo WARN: Invalid motor controller type on write_motor_norm() call!");
     }
 }
 
@@ -1,21 +1,20 @@
 #ifndef CAN_MANAGER_HPP
 #define CAN_MANAGER_HPP
 
-// FlexCAN_T4 library
-#include <FlexCAN_T4.h>
+#include <Arduino.h>
+#include "can_bus.hpp"
 
 // C620 Brushless DC Motor Speed Controller
 // Documentation: https://rm-static.djicdn.com/tem/17348/RoboMaster%20C620%20Brushless%20DC%20Motor%20Speed%20Controller%20V1.01.pdf 
 
-// FlexCAN_T4
-// Documentation: https://github.com/tonton81/FlexCAN_T4
-
 constexpr uint16_t CAN_1 = 0;             // CAN 1 (indexable value)
 constexpr uint16_t CAN_2 = 1;             // CAN 2 (indexable value)
+constexpr uint16_t CAN_3 = 2;             // CAN 3 (indexable value)
 
-#define NUM_CAN_BUSES      2 // 2 cans per robot
+#define NUM_CAN_BUSES      3 // 3 cans on the teensy 4.1, unused buses send nothing
 #define NUM_MOTORS_PER_BUS 8 // 8 motors per can
 #define NUM_MOTORS         (NUM_CAN_BUSES * NUM_MOTORS_PER_BUS)
+#define NUM_DEFAULT_MOTORS 16 // motors mapped by default (CAN 1 and CAN 2) when the config has no motor_info
 #define NUM_MESSAGE_IDS    3 // 3 messages per can: 0x200, 0x1ff, 0x2ff
 #define CAN_MESSAGE_SIZE   8 // 8 uint8_t's per message buffer
 
@@ -27,6 +26,17 @@ constexpr uint16_t CAN_2 = 1;             // CAN 2 (indexable value)
 #define C620_OUTPUT_SCALE  16384
 #define GM6020_OUTPUT_SCALE 30000
 
+#define MOTOR_ANGLE_RESOLUTION 8192 // encoder counts per rotor revolution
+#define MOTOR_VELOCITY_WINDOW_US 20000 // window (us) the position based velocity is measured over, longer is finer but laggier
+
+#define CAN_FEEDBACK_BASE_ID 0x200  // motor feedback frames are 0x201 to 0x208, slot = id - base - 1
+
+#define CAN_MOTOR_TIMEOUT_US 5000   // default time (us) without feedback before a motor is considered offline
+
+#define CAN_BAUD_RATE 1000000       // bits per second on every bus
+#define CAN_FRAME_BITS 125          // approximate bits on the wire per 8 byte standard frame (111 + average bit stuffing)
+#define CAN_STATS_WINDOW_US 100000  // window (us) bus utilization is averaged over
+
 /// @brief Returns a 2-byte value given 2 1-byte values
 /// @param highByte higher order byte
 /// @param lowByte lower order byte
@@ -39,10 +49,130 @@ enum MotorAttribute {
     ANGLE, SPEED, TORQUE, TEMP
 };
 
+/// @brief Index of a physical motor slot in the flat CANData feedback arrays
+/// @param canID ID of the CAN which the motor is on, expects indexable ID value
+/// @param motorID ID of the individual motor, starting at 1 like get_motor_attribute()
+/// @return flat slot index
+/// @note This is the bus address of a motor, the controllers and micro state use the logical motor index from the motor map
+constexpr int can_motor_index(uint16_t canID, uint16_t motorID) {
+    return canID * NUM_MOTORS_PER_BUS + (motorID - 1);
+}
+
+/// @brief Where a logical motor (controller/micro state index) lives on the CAN buses
+struct MotorInfo {
+    /// @brief ID of the CAN which the motor is on (indexable value), -1 if this motor index is unused
+    int8_t can_id = -1;
+    /// @brief ID of the motor on its bus, starting at 1
+    uint8_t motor_id = 0;
+    /// @brief type of motor controller (C610, C620 or GM6020), sets the output scale
+    uint8_t controller_type = C620;
+};
+
+/// @brief Traffic statistics of a single CAN bus
+/// @note This is copied into the outgoing comms packet as raw bytes, keep it packed with fixed-width types
+struct CANBusStats {
+    /// @brief estimated fraction of the bus bandwidth in use over the last stats window [0, 1]
+    float utilization = 0;
+    /// @brief number of frames the driver accepted for transmission, into a mailbox or its TX queue
+    uint32_t tx_frames = 0;
+    /// @brief number of frames received
+    uint32_t rx_frames = 0;
+    /// @brief number of received frames that got past the hardware filters but weren't feedback from an active motor
+    uint32_t rx_rejected = 0;
+    /// @brief number of frames that found no free TX mailbox and were queued to be retried from the TX ISR
+    uint32_t tx_mailbox_full = 0;
+    /// @brief number of frames dropped because the TX mailboxes and the driver's TX queue were full or the bus was off
+    uint32_t tx_dropped = 0;
+    /// @brief hardware transmit error counter (TEC), rises with every frame the controller has to retransmit
+    uint32_t tx_error_counter = 0;
+};
+
+static_assert(NUM_MOTORS <= 32, "CANData::online_mask needs a bit per motor");
+
 /// @brief The purpose of this struct is to be able to pass updated CAN data around without having to pass a rm_CAN object pointer which can be finnicky.
 struct CANData {
     /// @brief actual stored motor data to be sent around
     uint8_t data[NUM_CAN_BUSES][NUM_MOTORS_PER_BUS][CAN_MESSAGE_SIZE];
+    /// @brief time (us) the latest frame from each motor was received
+    uint32_t timestamp[NUM_CAN_BUSES][NUM_MOTORS_PER_BUS];
+    /// @brief number of frames received from each motor, changes whenever a new frame arrives
+    uint32_t seq[NUM_CAN_BUSES][NUM_MOTORS_PER_BUS];
+
+    /// @brief flat slot index (see can_motor_index()) of each logical motor, -1 if the motor is unused
+    int8_t motor_slot[NUM_MOTORS];
+
+    // feedback decoded once when each frame arrives, indexed with can_motor_index()
+
+    /// @brief rotor angle (rad) in [0, 2pi)
+    float angle[NUM_MOTORS];
+    /// @brief rotor velocity (rad/s)
+    float velocity[NUM_MOTORS];
+    /// @brief torque current in the motor controller's raw units (see the *_OUTPUT_SCALE defines)
+    float current[NUM_MOTORS];
+    /// @brief motor temperature (C)
+    float temperature[NUM_MOTORS];
+
+    /// @brief multi-turn rotor position (rad) relative to the zero set with rm_CAN::zero_position()
+    float position[NUM_MOTORS];
+    /// @brief rotor velocity (rad/s) from the change in multi-turn position over MOTOR_VELOCITY_WINDOW_US.
+    /// Finer than the 1 RPM speed field but lags it by about half a window
+    float fine_velocity[NUM_MOTORS];
+    /// @brief unwrapped rotor encoder count, always congruent to the raw angle mod MOTOR_ANGLE_RESOLUTION
+    int64_t position_count[NUM_MOTORS];
+    /// @brief encoder count that position is measured from
+    int64_t position_zero[NUM_MOTORS];
+    /// @brief encoder count at the start of the current velocity window
+    int64_t window_count[NUM_MOTORS];
+    /// @brief time (us) the current velocity window started
+    uint32_t window_start_us[NUM_MOTORS];
+
+    /// @brief bit i is set if logical motor i is active and has reported within the timeout
+    /// @note set by rm_CAN::read() when the snapshot is taken
+    uint32_t online_mask;
+
+    /// @brief Whether a motor is active and reporting
+    /// @param index logical motor index
+    /// @return true if the motor is online
+    inline bool is_online(int index) const { return online_mask & (1ul << index); }
+
+    /// @brief Decode the stored frame of a motor into the feedback arrays and track its multi-turn position
+    /// @param canID ID of the CAN which the motor is on, expects indexable ID value
+    /// @param slot index of the motor on its bus, starting at 0
+    /// @param now_us time (us) the frame was received
+    void decode(int canID, int slot, uint32_t now_us) {
+        const uint8_t* frame = data[canID][slot];
+        int index = canID * NUM_MOTORS_PER_BUS + slot;
+        uint16_t raw_angle = (uint16_t)((frame[0] << 8) | frame[1]);
+        angle[index] = raw_angle * (float)(2 * PI / MOTOR_ANGLE_RESOLUTION);
+        velocity[index] = (int16_t)((frame[2] << 8) | frame[3]) * (float)(2 * PI / 60.0);
+        current[index] = (int16_t)((frame[4] << 8) | frame[5]);
+        temperature[index] = frame[6];
+
+        if (seq[canID][slot] == 0) {
+            // first frame, start from the single-turn angle
+            position_count[index] = raw_angle;
+            window_count[index] = raw_angle;
+            window_start_us[index] = now_us;
+            fine_velocity[index] = 0;
+        } else {
+            // take the shortest way around, this holds as long as the rotor turns less than half a turn between frames
+            int32_t delta = (int32_t)raw_angle - (int32_t)(position_count[index] & (MOTOR_ANGLE_RESOLUTION - 1));
+            if (delta > MOTOR_ANGLE_RESOLUTION / 2) delta -= MOTOR_ANGLE_RESOLUTION;
+            if (delta < -MOTOR_ANGLE_RESOLUTION / 2) delta += MOTOR_ANGLE_RESOLUTION;
+            position_count[index] += delta;
+
+            uint32_t window = now_us - window_start_us[index];
+            if (window >= MOTOR_VELOCITY_WINDOW_US) {
+                fine_velocity[index] = (position_count[index] - window_count[index]) * (float)(2 * PI / MOTOR_ANGLE_RESOLUTION) / (window * 1E-6f);
+                window_count[index] = position_count[index];
+                window_start_us[index] = now_us;
+            }
+        }
+        position[index] = (position_count[index] - position_zero[index]) * (float)(2 * PI / MOTOR_ANGLE_RESOLUTION);
+
+        timestamp[canID][slot] = now_us;
+        seq[canID][slot]++;
+    }
 
     /// @brief Reads and returns value from input array of specified motor
     /// @param canID ID of the CAN which the motor is on, expects indexable ID value
@@ -72,23 +202,66 @@ struct CANData {
     }
 };
 
-/// @brief Manages both CANs on the robot. Able to read from and write to individual or multiple motors on the CANs.
+/// @brief Manages all CANs on the robot. Able to read from and write to individual or multiple motors on the CANs.
 class rm_CAN {
 public:
-    /// @brief Empty constructor (implementation weirdly needs to be in the .cpp)
+    /// @brief Uses the Teensy's FlexCAN controllers (defined in flexcan_bus.cpp so this class builds without FlexCAN)
     rm_CAN();
 
+    /// @brief Uses custom bus backends instead of the FlexCAN controllers
+    /// @param buses one backend per bus, indexed by CAN ID
+    rm_CAN(CANBus* buses[NUM_CAN_BUSES]);
+
     /// @brief Initializes and zeros CANs
     void init();
 
-    /// @brief Reads all inbound CAN packets and fills the input array accordingly
+    /// @brief Takes a consistent snapshot of the latest frame from every motor for this control step
+    /// @note Frames are received in the CAN ISR, this only copies the mailboxes
     void read();
 
+    /// @brief Stores a received feedback frame in its motor's mailbox
+    /// @note Called from the CAN receive ISR. Frames can also be injected here directly (e.g. from a fake bus)
+    /// @param frame received frame, frame.bus is the FlexCAN bus number (1 for CAN1)
+    /// @param now_us time (us) the frame was received
+    void receive(const CANFrame& frame, uint32_t now_us);
+
     /// @brief Writes current values from output array to the CANs
     /// @return True or false depending if the operation was successful
-    /// @note Does issue a Write command to the CANs
+    /// @note Does issue a Write command to the CANs. Message groups with no active motors are skipped
     uint8_t write();
 
+    /// @brief Sets where each logical motor is on the buses and what drives it
+    /// @param motors bus location and controller type of each logical motor
+    /// @note The default map puts motors 0-15 on CAN 1 and CAN 2 in order as C620s
+    void set_motor_map(const MotorInfo motors[NUM_MOTORS]);
+
+    /// @brief Sets which motors are in use. Message groups (0x200, 0x1ff, 0x2ff) with no active motors are no longer sent,
+    /// and the hardware FIFO filters are programmed to only accept feedback from the active motors
+    /// @param active whether each logical motor is in use
+    /// @note Every mapped motor is treated as active and all frames are accepted until this is called
+    void set_active_motors(const bool active[NUM_MOTORS]);
+
+    /// @brief Sets the output of every mapped motor with normalized values, using each motor's controller type
+    /// @note Does not issue a Write command to the CANs
+    /// @param values values in the range of [-1.0, 1.0], indexed by logical motor
+    void write_motors(const float values[NUM_MOTORS]);
+
+    /// @brief Sets how long an active motor can go without sending feedback before it's considered offline.
+    /// Offline motors have their command zeroed on every write()
+    /// @param timeout_us timeout in microseconds
+    void set_motor_timeout(uint32_t timeout_us) { m_motor_timeout_us = timeout_us; }
+
+    /// @brief Sets the current multi-turn position of a motor
+    /// @param canID ID of the CAN which the motor is on, expects indexable ID value
+    /// @param motorID ID of the individual motor, expects indexable ID value
+    /// @param position position (rad) the motor is at now, 0 to zero it
+    /// @note Takes effect on the motor's next feedback frame
+    void zero_position(uint16_t canID, uint16_t motorID, float position = 0);
+
+    /// @brief Get the traffic statistics of every bus
+    /// @return array of NUM_CAN_BUSES bus stats
+    const CANBusStats* get_bus_stats() const { return m_stats; }
+
 public:
     /// @brief Sets the buffer values in output array to 0
     /// @note Does not issue a Write command to the CANs
@@ -139,15 +312,61 @@ public:
     CANData* get_data() { return &m_input; }
 
 private:
-    /// @brief CAN 1 object
-    FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> m_can1;
-    /// @brief CAN 2 object
-    FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> m_can2;
-
-    /// @brief Output array in the format of CAN_message_t's
-    CAN_message_t m_output[NUM_CAN_BUSES][NUM_MESSAGE_IDS];
-    /// @brief Input array in the format of uint8_t's
-    CANData m_input;
+    /// @brief Receive ISR callback shared by all buses, forwards to receive()
+    /// @param frame received frame
+    static void receive_isr(const CANFrame& frame);
+
+    /// @brief instance the receive ISR forwards frames to
+    static rm_CAN* s_instance;
+
+    /// @brief Bus backends, indexed by CAN ID
+    CANBus* m_buses[NUM_CAN_BUSES];
+
+    /// @brief Writes the active message groups of one bus
+    /// @param canID ID of the CAN, expects indexable ID value
+    /// @return true if no frame was dropped
+    bool write_bus(uint16_t canID);
+
+    /// @brief Recomputes which slots and message groups are in use from the motor map and active motors,
+    /// and reprograms the hardware filters once the active motors are known
+    void update_routing();
+
+    /// @brief Updates the bus utilization estimate once per stats window
+    /// @param now_us current time in microseconds
+    void update_stats(uint32_t now_us);
+
+    /// @brief Output array of frames
+    CANFrame m_output[NUM_CAN_BUSES][NUM_MESSAGE_IDS];
+    /// @brief whether each message group has an active motor and should be sent
+    bool m_group_active[NUM_CAN_BUSES][NUM_MESSAGE_IDS];
+
+    /// @brief bus location and controller type of each logical motor
+    MotorInfo m_motors[NUM_MOTORS];
+    /// @brief whether each logical motor is in use
+    bool m_motor_active[NUM_MOTORS];
+    /// @brief whether set_active_motors() has been called, the hardware filters stay open until then
+    bool m_filters_enabled = false;
+
+    /// @brief traffic statistics of each bus
+    CANBusStats m_stats[NUM_CAN_BUSES];
+    /// @brief whether feedback from each motor slot is expected, checked by the receive ISR
+    volatile bool m_slot_active[NUM_CAN_BUSES][NUM_MOTORS_PER_BUS];
+
+    /// @brief frames received on each bus (written by the receive ISR)
+    volatile uint32_t m_rx_frames[NUM_CAN_BUSES] = { 0 };
+    /// @brief frames rejected in software on each bus (written by the receive ISR)
+    volatile uint32_t m_rx_rejected[NUM_CAN_BUSES] = { 0 };
+    /// @brief frame count (tx + rx) of each bus at the start of the current stats window
+    uint32_t m_window_frames[NUM_CAN_BUSES] = { 0 };
+    /// @brief time (us) the current stats window started
+    uint32_t m_window_start_us = 0;
+
+    /// @brief time (us) without feedback before an active motor is considered offline
+    uint32_t m_motor_timeout_us = CAN_MOTOR_TIMEOUT_US;
+    /// @brief Latest frame from each motor, only written by the receive ISR
+    CANData m_mailbox = {};
+    /// @brief Snapshot of the mailboxes taken by read(), this is what the rest of the code sees
+    CANData m_input = {};
 
 };
 
@@ -1,4 +1,5 @@
 #include "usb_hid.hpp"
+#include "../utils/logger.hpp"
 
 uint8_t CommsPacket::get_id() {
     // c++ moment
@@ -32,6 +33,12 @@ void CommsPacket::get_hive_override_state(float state[STATE_LEN][3]) {
     memcpy(state, raw + KHADAS_PACKET_HIVE_OVERRIDE_STATE_OFFSET, sizeof(float) * STATE_LEN * 3);
 }
 
+uint16_t CommsPacket::get_hive_override_packet_id() {
+    uint16_t id;
+    memcpy(&id, raw + KHADAS_PACKET_HIVE_OVERRIDE_PACKET_ID_OFFSET, sizeof(uint16_t));
+    return id;
+}
+
 void CommsPacket::get_ref_draw_data(char** draw_data) {}
 
 void CommsPacket::set_time(double time) {
@@ -50,6 +57,31 @@ void CommsPacket::set_ref_data(uint8_t ref_data[180]) {
     memcpy(raw + TEENSY_PACKET_REF_OFFSET, ref_data, 180);
 }
 
+void CommsPacket::set_loop_stats(const ControlTickStats* stats) {
+    memcpy(raw + TEENSY_PACKET_LOOP_STATS_OFFSET, stats, sizeof(ControlTickStats));
+}
+
+void CommsPacket::set_can_stats(const CANBusStats* stats) {
+    memcpy(raw + TEENSY_PACKET_CAN_STATS_OFFSET, stats, NUM_CAN_BUSES * sizeof(CANBusStats));
+}
+
+void CommsPacket::set_motor_online(uint32_t mask) {
+    memcpy(raw + TEENSY_PACKET_MOTOR_ONLINE_OFFSET, &mask, sizeof(uint32_t));
+}
+
+void CommsPacket::set_gyro_bias(const float bias[3], bool stationary) {
+    memcpy(raw + TEENSY_PACKET_GYRO_BIAS_OFFSET, bias, 3 * sizeof(float));
+    raw[TEENSY_PACKET_GYRO_BIAS_OFFSET + 3 * sizeof(float)] = stationary;
+}
+
+void CommsPacket::set_task_misses(const Scheduler* scheduler) {
+    uint16_t misses[TEENSY_PACKET_NUM_TASKS] = { 0 };
+    for (int i = 0; i < scheduler->get_num_tasks() && i < TEENSY_PACKET_NUM_TASKS; i++) {
+        misses[i] = (uint16_t)scheduler->get_stats(i).deadline_misses;
+    }
+    memcpy(raw + TEENSY_PACKET_TASK_MISSES_OFFSET, misses, sizeof(misses));
+}
+
 HIDLayer::HIDLayer() {}
 
 void HIDLayer::init() { Serial.println("Starting HID layer"); }
@@ -61,7 +93,7 @@ void HIDLayer::ping() {
         if (read()) {
             // if we read, attempt to write
             if (!write())
-                Serial.printf("Failed to send ping %llu\n", m_packetsSent);
+                LOG_WARN("Failed to send ping %llu", m_packetsSent);
         }
     }
 }
@@ -108,7 +140,7 @@ bool HIDLayer::write() {
         m_packetsSent++;
         return true;
     } else {
-        Serial.println("Comms: failed write");
+        LOG_WARN("Comms: failed write");
         m_packetsFailed++;
         return false;
     }
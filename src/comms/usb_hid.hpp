@@ -4,6 +4,9 @@
 #include "Arduino.h"
 #include "usb_rawhid.h"				// usb_rawhid functions
 #include "../controls/state.hpp"	// STATE_LEN macro
+#include "../utils/control_tick.hpp"	// ControlTickStats
+#include "rm_can.hpp"					// CANBusStats
+#include "../utils/scheduler.hpp"	// Scheduler
 
 /// @brief Packet size for communication packets
 constexpr unsigned int COMMS_PACKET_SIZE = 1023u;
@@ -22,8 +25,10 @@ constexpr unsigned int KHADAS_PACKET_REF_OFFSET = 292u;	// 128 bytes
 constexpr unsigned int KHADAS_PACKET_HIVE_OVERRIDE_STATE_REQUEST_OFFSET = 420u; // 1 byte
 /// @brief The offset of the override state from hive
 constexpr unsigned int KHADAS_PACKET_HIVE_OVERRIDE_STATE_OFFSET = 421u; // 288 bytes
+/// @brief The offset of the ID of the Teensy packet the override state was sampled at (0 if untagged)
+constexpr unsigned int KHADAS_PACKET_HIVE_OVERRIDE_PACKET_ID_OFFSET = 709u; // 2 bytes
 /// @brief The offset to the end of the Khadas packet
-constexpr unsigned int KHADAS_PACKET_END_OFFSET = 709u;
+constexpr unsigned int KHADAS_PACKET_END_OFFSET = 711u;
 
 
 // Teensy -> Khadas
@@ -39,8 +44,23 @@ constexpr unsigned int TEENSY_PACKET_ESTATE_OFFSET = 12u;	// 288 bytes
 constexpr unsigned int TEENSY_PACKET_SENSOR_OFFSET = 300u;	// 400 bytes
 /// @brief The offset of the packet ref data from the base of the Teesny packet
 constexpr unsigned int TEENSY_PACKET_REF_OFFSET = 700u;	// 180 bytes
+/// @brief The offset of the control loop timing stats from the base of the Teensy packet
+constexpr unsigned int TEENSY_PACKET_LOOP_STATS_OFFSET = 880u;	// 28 bytes
+/// @brief The offset of the CAN bus traffic stats from the base of the Teensy packet
+constexpr unsigned int TEENSY_PACKET_CAN_STATS_OFFSET = 908u;	// 84 bytes (28 per bus)
+/// @brief The offset of the motor online bitmask from the base of the Teensy packet
+constexpr unsigned int TEENSY_PACKET_MOTOR_ONLINE_OFFSET = 992u;	// 4 bytes
+/// @brief The offset of the online gyro bias (x, y, z floats then a stationary byte) from the base of the Teensy packet
+constexpr unsigned int TEENSY_PACKET_GYRO_BIAS_OFFSET = 996u;	// 13 bytes
+/// @brief The offset of the per-task scheduler deadline misses (low 16 bits of each count) from the base of the Teensy packet
+constexpr unsigned int TEENSY_PACKET_TASK_MISSES_OFFSET = 1009u;	// 10 bytes (2 per task)
 /// @brief The offset to the end of the Teensy packet
-constexpr unsigned int TEENSY_PACKET_END_OFFSET = 880u;
+constexpr unsigned int TEENSY_PACKET_END_OFFSET = 1019u;
+
+/// @brief Number of scheduler tasks whose deadline misses fit in the Teensy packet
+constexpr int TEENSY_PACKET_NUM_TASKS = (TEENSY_PACKET_END_OFFSET - TEENSY_PACKET_TASK_MISSES_OFFSET) / sizeof(uint16_t);
+
+static_assert(TEENSY_PACKET_MOTOR_ONLINE_OFFSET - TEENSY_PACKET_CAN_STATS_OFFSET == NUM_CAN_BUSES * sizeof(CANBusStats), "CAN stats section doesn't match the bus count");
 
 /// @brief The offset to dr16 data from the sensor data section
 constexpr unsigned int SENSOR_DR16_OFFSET = 0u;
@@ -48,6 +68,12 @@ constexpr unsigned int SENSOR_DR16_OFFSET = 0u;
 constexpr unsigned int SENSOR_LIDAR1_OFFSET = 18u;
 /// @brief The offset to the lidar2 data from the sensor data section
 constexpr unsigned int SENSOR_LIDAR2_OFFSET = 172u;
+/// @brief The offset to the buff encoder status (BuffEncoder::export_data of the first SENSOR_NUM_BUFF_ENC encoders) from the sensor data section
+constexpr unsigned int SENSOR_BUFF_ENC_OFFSET = 326u;	// 12 bytes (6 per encoder)
+/// @brief Number of buff encoders whose status fits in the sensor data section
+constexpr int SENSOR_NUM_BUFF_ENC = 2;
+/// @brief The offset to the chassis pose variance (x, y, heading floats) from the sensor data section
+constexpr unsigned int SENSOR_CHASSIS_VARIANCE_OFFSET = 338u;	// 12 bytes
 
 /// @brief An encapsulating data struct managing data from all of Teensy's sensors
 struct SensorData {
@@ -100,6 +126,10 @@ struct CommsPacket {
 	/// @param state The float array to put the state into
 	void get_hive_override_state(float state[STATE_LEN][3]);
 
+	/// @brief Get the ID of the Teensy packet whose estimate the hive override state was sampled at
+	/// @return The Teensy packet ID, 0 if hive didn't tag the override
+	uint16_t get_hive_override_packet_id();
+
 	// teensy setters
 	/// @brief Set the time of this packet
 	/// @param time The time as a double
@@ -113,6 +143,22 @@ struct CommsPacket {
 	/// @brief Set the ref data for this packet
 	/// @param ref_data The ref data byte array
 	void set_ref_data(uint8_t ref_data[180]);
+	/// @brief Set the control loop timing stats for this packet
+	/// @param stats The control tick stats to send
+	void set_loop_stats(const ControlTickStats* stats);
+	/// @brief Set the CAN bus traffic stats for this packet
+	/// @param stats Array of NUM_CAN_BUSES bus stats
+	void set_can_stats(const CANBusStats* stats);
+	/// @brief Set the motor online bitmask for this packet
+	/// @param mask Bit i is set if motor i is online
+	void set_motor_online(uint32_t mask);
+	/// @brief Set the online gyro bias for this packet
+	/// @param bias Gyro bias (rad/s) in x, y, z
+	/// @param stationary Whether the robot is detected as stationary
+	void set_gyro_bias(const float bias[3], bool stationary);
+	/// @brief Set the scheduler deadline misses for this packet, a task that never fits in the idle time shows up here
+	/// @param scheduler The scheduler to read the task stats from, tasks past TEENSY_PACKET_NUM_TASKS are left out
+	void set_task_misses(const Scheduler* scheduler);
 };
 
 /// @brief The communications layer between Khadas and Teensy
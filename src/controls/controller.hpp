@@ -16,8 +16,6 @@ struct Controller {
 protected:
     /// @brief gains for a specific controller
     float gains[NUM_GAINS];
-    /// @brief Timer object so we can use dt in controllers
-    Timer timer;
     /// @brief defines controller inputs and outputs (0 means Macro_state input, micro_state output)
     /// @note (1 means Micro_state input, motor_current output) (2 means Macro state input, motor_current output)
     int controller_level;
@@ -38,24 +36,46 @@ public:
     /// @brief Generates an output from a state reference and estimation
     /// @param reference target reference
     /// @param estimate current macro state estimate
+    /// @param dt time (s) since the last control step
     /// @returns motor_current or Micro_state depending on controller_level
-    virtual float step(float reference[3], float estimate[3]) = 0;
+    virtual float step(float reference[3], float estimate[3], float dt) = 0;
     /// @brief Generates an output from a state reference and estimation
     /// @param reference target reference
     /// @param estimate current micro state estimate
+    /// @param dt time (s) since the last control step
     /// @returns motor_current 
-    virtual float step(float reference, float estimate[MICRO_STATE_LEN]) = 0;
+    virtual float step(float reference, float estimate[MICRO_STATE_LEN], float dt) = 0;
 
-    /// @brief Resets integrators/timers
-    virtual void reset() { timer.start_timer(); }
+    /// @brief Resets integrators
+    virtual void reset() {}
+
+    /// @brief Whether this controller always outputs 0 and can be skipped
+    /// @return true for the NullController
+    virtual bool is_null() const { return false; }
+
+    /// @brief Whether the micro state step is a plain bounded PID of estimate[0] with gains 0-2,
+    /// so it can be run in a PIDBank with the other motors instead of through step()
+    /// @return true if the micro step can be batched
+    virtual bool is_micro_pid() const { return false; }
+
+    /// @brief Whether this controller is a row of the full state feedback bank, which ControllerManager steps for
+    /// every such motor at once instead of through step()
+    /// @return true for the StateFeedbackController
+    virtual bool is_state_feedback() const { return false; }
+
+    /// @brief get the gains of this controller
+    /// @return gains array of length NUM_GAINS
+    const float* get_gains() const { return gains; }
 };
 
 /// @brief Default controller
 struct NullController : public Controller {
 public:
-    float step(float reference[3], float estimate[3]) { return 0; }
+    float step(float reference[3], float estimate[3], float dt) { return 0; }
+
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) { return 0; }
 
-    float step(float reference, float estimate[MICRO_STATE_LEN]) { return 0; }
+    bool is_null() const { return true; }
 };
 
 /// @brief PID controller working on position
@@ -73,10 +93,9 @@ public:
     /// @brief step for macro_state input
     /// @param reference macro_reference
     /// @param estimate macro_estimate
+    /// @param dt time (s) since the last control step
     /// @return Motor output or micro_reference
-    float step(float reference[3], float estimate[3]) {
-        float dt = timer.delta();
-
+    float step(float reference[3], float estimate[3], float dt) {
         pid.setpoint = reference[0]; // 0th index = position
         pid.measurement = estimate[0];
         pid.K[0] = gains[0];
@@ -89,10 +108,9 @@ public:
     /// @brief step for micro_state input
     /// @param reference micro_reference
     /// @param estimate micro_estimate
+    /// @param dt time (s) since the last control step
     /// @return Motor output
-    float step(float reference, float estimate[MICRO_STATE_LEN]) {
-        float dt = timer.delta();
-
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) {
         pid.setpoint = reference; // 0th index = position
         pid.measurement = estimate[0];
         pid.K[0] = gains[0];
@@ -103,6 +121,8 @@ public:
         return output;
     }
 
+    bool is_micro_pid() const { return true; }
+
     /// @brief reset controller which 0's integrators
     void reset() {
         Controller::reset();
@@ -126,10 +146,9 @@ public:
     /// @brief step for macro_state input
     /// @param reference macro_reference
     /// @param estimate macro_estimate
+    /// @param dt time (s) since the last control step
     /// @return Motor output or micro_reference
-    float step(float reference[3], float estimate[3]) {
-        float dt = timer.delta();
-
+    float step(float reference[3], float estimate[3], float dt) {
         pid.setpoint = reference[1]; // 1st index = position
         pid.measurement = estimate[1];
         pid.K[0] = gains[0];
@@ -143,10 +162,9 @@ public:
     /// @brief step for micro_state input
     /// @param reference micro_reference
     /// @param estimate micro_estimate
+    /// @param dt time (s) since the last control step
     /// @return Motor output
-    float step(float reference, float estimate[MICRO_STATE_LEN]) {
-        float dt = timer.delta();
-
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) {
         pid.setpoint = reference; // 0th index = position
         pid.measurement = estimate[0];
         pid.K[0] = gains[0];
@@ -157,6 +175,8 @@ public:
         return output;
     }
 
+    bool is_micro_pid() const { return true; }
+
     /// @brief reset controller which 0's integrators
     void reset() {
         Controller::reset();
@@ -179,10 +199,9 @@ public:
     /// @brief step for macro_state input
     /// @param reference macro_reference
     /// @param estimate macro_estimate
+    /// @param dt time (s) since the last control step
     /// @return Motor output or micro_reference
-    float step(float reference[3], float estimate[3]) {
-        float dt = timer.delta();
-
+    float step(float reference[3], float estimate[3], float dt) {
         pid.setpoint = reference[1]; // 1st index = position
         pid.measurement = estimate[1];
         pid.K[0] = gains[0];
@@ -197,10 +216,9 @@ public:
     /// @brief step for micro_state input
     /// @param reference micro_reference
     /// @param estimate micro_estimate
+    /// @param dt time (s) since the last control step
     /// @return Motor output
-    float step(float reference, float estimate[MICRO_STATE_LEN]) {
-        float dt = timer.delta();
-
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) {
         pid.setpoint = reference; // 0th index = position
         pid.measurement = estimate[0];
         pid.K[0] = gains[0];
@@ -211,6 +229,8 @@ public:
         return output;
     }
 
+    bool is_micro_pid() const { return true; }
+
     void reset() {
         Controller::reset();
         pid.sumError = 0.0;
@@ -234,8 +254,7 @@ public:
             Serial.println("FullStateFeedbackController can't be a low level controller");
     }
 
-    float step(float reference[3], float estimate[3]) {
-        float dt = timer.delta();
+    float step(float reference[3], float estimate[3], float dt) {
         float output = 0.0;
 
         pid1.K[0] = gains[0];
@@ -258,7 +277,7 @@ public:
         return output;
     }
 
-    float step(float reference, float estimate[MICRO_STATE_LEN]) { return 0; }
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) { return 0; }
 
     void reset() {
         Controller::reset();
@@ -284,14 +303,15 @@ public:
     /// @brief don't do anything if we get a macro state
     /// @param reference reference
     /// @param estimate estimate
+    /// @param dt time (s) since the last control step
     /// @return 0
-    float step(float reference[3], float estimate[3]) { return 0; }
+    float step(float reference[3], float estimate[3], float dt) { return 0; }
     /// @brief take s in a micro_reference of wheel velocity
     /// @param reference reference
     /// @param estimate estimate
+    /// @param dt time (s) since the last control step
     /// @return outputs motor current
-    float step(float reference, float estimate[MICRO_STATE_LEN]) {
-        float dt = timer.delta();
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) {
         pid.setpoint = reference; // 1st index = position
         pid.measurement = estimate[0];
         pid.K[0] = gains[0];
@@ -335,10 +355,9 @@ public:
     /// @brief don't do anything if we get a macro state
     /// @param reference reference
     /// @param estimate estimate
+    /// @param dt time (s) since the last control step
     /// @return 0
-    float step(float reference[3], float estimate[3]) { 
-        float dt = timer.delta();
-
+    float step(float reference[3], float estimate[3], float dt) { 
         pidp.K[0] = gains[0];
         pidp.K[1] = gains[1];
         pidp.K[2] = gains[2];
@@ -386,8 +405,9 @@ public:
     /// @brief dont do anything if we get a micro_reference
     /// @param reference reference
     /// @param estimate estimate
+    /// @param dt time (s) since the last control step
     /// @return 0
-    float step(float reference, float estimate[MICRO_STATE_LEN]) {return 0;}
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) {return 0;}
 
     void reset() {
         Controller::reset();
@@ -413,9 +433,9 @@ public:
     /// @brief don't do anything if we get a macro state
     /// @param reference reference
     /// @param estimate estimate
+    /// @param dt time (s) since the last control step
     /// @return 0
-    float step(float reference[3], float estimate[3]) { 
-        float dt = timer.delta();
+    float step(float reference[3], float estimate[3], float dt) { 
         pidp.setpoint = reference[0]; // 1st index = position
         pidp.measurement = estimate[0];
 
@@ -445,8 +465,9 @@ public:
     /// @brief dont do anything if we get a micro_reference
     /// @param reference reference
     /// @param estimate estimate
+    /// @param dt time (s) since the last control step
     /// @return 0
-    float step(float reference, float estimate[MICRO_STATE_LEN]) {return 0;}
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) {return 0;}
 
     void reset() {
         Controller::reset();
@@ -454,4 +475,24 @@ public:
     }
 };
 
+/// @brief Full state feedback (LQR style) controller across every state the motor couples to.
+/// Position gains of the motor's states go in gains 0-5 and velocity gains in 6-11, in the order of its kinematics entries
+/// @note This only holds the gains, ControllerManager runs every motor of this type together in a StateFeedbackBank
+struct StateFeedbackController : public Controller {
+public:
+    /// @brief set controller level and make sure it outputs a motor current
+    /// @param _controller_level controller level(if it outputs a torque or a target micro state).
+    StateFeedbackController(int _controller_level) {
+        controller_level = _controller_level;
+        if (controller_level != 2)
+            Serial.println("StateFeedbackController must be an overarching (level 2) controller");
+    }
+
+    float step(float reference[3], float estimate[3], float dt) { return 0; }
+
+    float step(float reference, float estimate[MICRO_STATE_LEN], float dt) { return 0; }
+
+    bool is_state_feedback() const { return true; }
+};
+
 #endif // CONTROLLER_H
\ No newline at end of file
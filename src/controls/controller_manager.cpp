@@ -1,8 +1,9 @@
 #include "controller_manager.hpp"
 
-void ControllerManager::init(const Config* _config_data) {
+void ControllerManager::init(const Config* _config_data, const bool _wrap_states[STATE_LEN]) {
     // set the config data reference
     config_data = _config_data;
+    memcpy(wrap_states, _wrap_states, sizeof(wrap_states));
     
     // intializes all controllers given the controller_types matrix
     for (int i = 0; i < NUM_CAN_BUSES; i++) {
@@ -13,6 +14,81 @@ void ControllerManager::init(const Config* _config_data) {
         }
     }
 
+    compile_plan();
+}
+
+void ControllerManager::compile_plan() {
+    num_planned = 0;
+    micro_bank.clear();
+    for (int m = 0; m < NUM_MOTORS; m++) {
+        MotorPlan& motor_plan = plan[num_planned];
+        motor_plan = MotorPlan{};
+        motor_plan.motor = m;
+
+        bool has_controller = false;
+        for (int k = 0; k < NUM_CONTROLLER_LEVELS; k++) {
+            Controller* controller = controllers[m][k];
+            if (controller && !controller->is_null()) {
+                motor_plan.levels[k] = controller;
+                has_controller = true;
+            }
+        }
+        // motors without any controller always output 0
+        if (!has_controller) continue;
+
+        // plain PID micro controllers move into the bank, their gains are only copied once here
+        Controller* micro = motor_plan.levels[1];
+        if (micro && micro->is_micro_pid()) {
+            const float* gains = micro->get_gains();
+            float K[4] = { gains[0], gains[1], gains[2], 0 };
+            int channel = micro_bank.add_channel(K, true, false);
+            if (channel >= 0) {
+                motor_plan.micro_channel = channel;
+                motor_plan.levels[1] = nullptr;
+            }
+        }
+
+        // state feedback runs in its own bank across every motor that uses it
+        if (motor_plan.levels[2] && motor_plan.levels[2]->is_state_feedback()) {
+            motor_plan.feedback = motor_plan.levels[2];
+            motor_plan.levels[2] = nullptr;
+        }
+
+        for (int j = 0; j < STATE_LEN; j++) {
+            if (config_data->kinematics_p[m][j] != 0 || config_data->kinematics_v[m][j] != 0) motor_plan.states[motor_plan.num_states++] = j;
+        }
+        num_planned++;
+    }
+
+    compile_state_feedback();
+}
+
+void ControllerManager::compile_state_feedback() {
+    feedback_bank.clear();
+    for (int p = 0; p < num_planned; p++) {
+        MotorPlan& motor_plan = plan[p];
+        if (!motor_plan.feedback) continue;
+        motor_plan.feedback_row = feedback_bank.add_motor(motor_plan.motor, motor_plan.feedback->get_gains(), motor_plan.states, motor_plan.num_states, wrap_states);
+    }
+}
+
+void ControllerManager::add_kinematics_entry(int motor, int state) {
+    for (int i = 0; i < num_planned; i++) {
+        MotorPlan& motor_plan = plan[i];
+        if (motor_plan.motor != motor) continue;
+
+        for (int j = 0; j < motor_plan.num_states; j++) {
+            if (motor_plan.states[j] == state) return;
+        }
+
+        // keep the states in order so controllers see them in the same order as before
+        int j = motor_plan.num_states++;
+        for (; j > 0 && motor_plan.states[j - 1] > state; j--) motor_plan.states[j] = motor_plan.states[j - 1];
+        motor_plan.states[j] = state;
+
+        if (motor_plan.feedback) compile_state_feedback();
+        return;
+    }
 }
 
 void ControllerManager::init_controller(uint8_t can_id, uint8_t motor_id, int controller_type, int controller_level, const float gains[NUM_GAINS]) {
@@ -51,6 +127,10 @@ void ControllerManager::init_controller(uint8_t can_id, uint8_t motor_id, int co
         controllers[index][controller_level] = new ChassisFullStateFeedbackController(controller_level);
         controllers[index][controller_level]->set_gains(gains);
         break;
+    case 8:
+        controllers[index][controller_level] = new StateFeedbackController(controller_level);
+        controllers[index][controller_level]->set_gains(gains);
+        break;
     default:
         controllers[index][controller_level] = new NullController();
         controllers[index][controller_level]->set_gains(gains);
@@ -58,61 +138,85 @@ void ControllerManager::init_controller(uint8_t can_id, uint8_t motor_id, int co
     }
 }
 
-void ControllerManager::step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float micro_estimate[NUM_MOTORS][MICRO_STATE_LEN], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float outputs[NUM_MOTORS]) {
+void ControllerManager::reset_motor(int motor) {
+    for (int k = 0; k < NUM_CONTROLLER_LEVELS; k++) {
+        if (controllers[motor][k]) controllers[motor][k]->reset();
+    }
+    for (int p = 0; p < num_planned; p++) {
+        if (plan[p].motor == motor && plan[p].micro_channel >= 0) micro_bank.reset(plan[p].micro_channel);
+    }
+}
+
+void ControllerManager::step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float micro_estimate[NUM_MOTORS][MICRO_STATE_LEN], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float outputs[NUM_MOTORS], const LoopTime& time) {
     // clear the outputs array before updating
     for (int i = 0;i < NUM_MOTORS;i++) outputs[i] = 0;
 
-    float micro_reference[STATE_LEN];
+    float micro_reference[NUM_MOTORS];
     // Iterate through controller level 0
-    for (int m = 0; m < NUM_MOTORS; m++) {
-        float output = 0;
-        for (int j = 0; j < STATE_LEN; j++) {
-            if (kinematics_v[m][j] == 0 && kinematics_p[m][j] == 0) continue;
-            float temp_macro_reference[3];
-            float temp_macro_estimate[3];
-
-            temp_macro_reference[0] = macro_reference[j][0] * kinematics_p[m][j];
-            temp_macro_estimate[0] = macro_estimate[j][0] * kinematics_p[m][j];
+    for (int p = 0; p < num_planned; p++) {
+        const MotorPlan& motor_plan = plan[p];
+        int m = motor_plan.motor;
+        micro_reference[m] = motor_plan.levels[0] ? step_macro(motor_plan, 0, macro_reference, macro_estimate, kinematics_p, kinematics_v, time.dt) : 0;
+    }
 
-            temp_macro_reference[1] = macro_reference[j][1] * kinematics_v[m][j];
-            temp_macro_estimate[1] = macro_estimate[j][1] * kinematics_v[m][j];
-            //itterate the high level controllers first
-            output += controllers[m][0]->step(temp_macro_reference, temp_macro_estimate);
+    // Iterate through controller level 1, plain PIDs are run together in the bank
+    for (int p = 0; p < num_planned; p++) {
+        const MotorPlan& motor_plan = plan[p];
+        int m = motor_plan.motor;
+        if (motor_plan.micro_channel >= 0) {
+            micro_bank.setpoint[motor_plan.micro_channel] = micro_reference[m];
+            micro_bank.measurement[motor_plan.micro_channel] = micro_estimate[m][0];
+        }
+    }
+    micro_bank.step(time.dt);
+
+    for (int p = 0; p < num_planned; p++) {
+        const MotorPlan& motor_plan = plan[p];
+        int m = motor_plan.motor;
+        if (motor_plan.micro_channel >= 0) {
+            outputs[m] += micro_bank.output[motor_plan.micro_channel];
+        } else if (motor_plan.levels[1]) {
+            //itterate the low level controllers second
+            outputs[m] += motor_plan.levels[1]->step(micro_reference[m], micro_estimate[m], time.dt);
         }
-        micro_reference[m] = output;
     }
 
+    // Iterate through controller level 2, state feedback motors are run together in their bank
+    feedback_bank.step(macro_reference, macro_estimate, kinematics_p, kinematics_v);
+    for (int p = 0; p < num_planned; p++) {
+        const MotorPlan& motor_plan = plan[p];
+        if (motor_plan.feedback_row >= 0) outputs[motor_plan.motor] += feedback_bank.output[motor_plan.feedback_row];
+        if (!motor_plan.levels[2]) continue;
 
-    // Iterate through controller level 1
-    for (int m = 0; m < NUM_MOTORS; m++) {
-        float temp_micro_reference;
-        float temp_micro_estimate[MICRO_STATE_LEN];
-        temp_micro_reference = micro_reference[m];
-        for (int j = 0; j < MICRO_STATE_LEN; j++) temp_micro_estimate[j] = micro_estimate[m][j];
-
-        //itterate the low level controllers second
-        outputs[m] += controllers[m][1]->step(temp_micro_reference, temp_micro_estimate);
+        //itterate the overarching controllers last
+        outputs[motor_plan.motor] += step_macro(motor_plan, 2, macro_reference, macro_estimate, kinematics_p, kinematics_v, time.dt);
     }
+}
 
-    // Iterate through controller level 2
-    for (int m = 0; m < NUM_MOTORS; m++) {
-        float output = 0;
-        for (int j = 0; j < STATE_LEN; j++) {
-            if (kinematics_v[m][j] == 0 && kinematics_p[m][j] == 0) continue;
-            float temp_macro_reference[3];
-            float temp_macro_estimate[3];
+float ControllerManager::step_macro(const MotorPlan& motor_plan, int level, float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float dt) {
+    int m = motor_plan.motor;
+    Controller* controller = motor_plan.levels[level];
 
-            temp_macro_reference[0] = macro_reference[j][0] * kinematics_p[m][j];
-            temp_macro_estimate[0] = macro_estimate[j][0] * kinematics_p[m][j];
+    float output = 0;
+    for (int s = 0; s < motor_plan.num_states; s++) {
+        int j = motor_plan.states[s];
+        float kp = kinematics_p[m][j];
+        float kv = kinematics_v[m][j];
+        // runtime entries can still pass through zero
+        if (kv == 0 && kp == 0) continue;
 
-            temp_macro_reference[1] = macro_reference[j][1] * kinematics_v[m][j];
-            temp_macro_estimate[1] = macro_estimate[j][1] * kinematics_v[m][j];
+        float temp_macro_reference[3];
+        float temp_macro_estimate[3];
 
-            //itterate the overarching controllers last
-            output += controllers[m][2]->step(temp_macro_reference, temp_macro_estimate);
-        }
-        outputs[m] += output;
+        temp_macro_reference[0] = macro_reference[j][0] * kp;
+        temp_macro_estimate[0] = macro_estimate[j][0] * kp;
+
+        temp_macro_reference[1] = macro_reference[j][1] * kv;
+        temp_macro_estimate[1] = macro_estimate[j][1] * kv;
+
+        output += controller->step(temp_macro_reference, temp_macro_estimate, dt);
     }
+    return output;
 }
 
 // void ControllerManager::step(float reference[STATE_LEN][3], float estimate[STATE_LEN][3], float outputs[NUM_MOTORS])
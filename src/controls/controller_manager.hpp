@@ -5,6 +5,27 @@
 #include "../comms/rm_can.hpp"
 #include "../sensors/RefSystem.hpp"
 #include "../comms/config_layer.hpp"
+#include "../utils/control_tick.hpp"
+#include "../filters/pid_bank.hpp"
+#include "state_feedback.hpp"
+
+/// @brief Precompiled work for a single motor, built once so step() only touches real controllers and kinematics
+struct MotorPlan {
+    /// @brief motor index
+    uint8_t motor = 0;
+    /// @brief number of states with a kinematics entry for this motor
+    uint8_t num_states = 0;
+    /// @brief states with a kinematics entry for this motor
+    uint8_t states[STATE_LEN] = { 0 };
+    /// @brief controller on each level, nullptr if it's a NullController or runs in the micro bank
+    Controller* levels[NUM_CONTROLLER_LEVELS] = { nullptr };
+    /// @brief channel of the level 1 controller in the micro bank, -1 if it's stepped on its own
+    int8_t micro_channel = -1;
+    /// @brief level 2 state feedback controller, run in the state feedback bank instead of through levels[2]
+    Controller* feedback = nullptr;
+    /// @brief row of the motor in the state feedback bank, -1 if it has none
+    int8_t feedback_row = -1;
+};
 
 /// @brief Manage all controllers
 class ControllerManager {
@@ -12,17 +33,48 @@ private:
     /// @brief Keep track of the controller used on each motor
     Controller* controllers[NUM_MOTORS][NUM_CONTROLLER_LEVELS] = { nullptr };
 
+    /// @brief plan of each motor with at least one real controller, in motor order
+    MotorPlan plan[NUM_MOTORS];
+    /// @brief number of motors in the plan
+    int num_planned = 0;
+
+    /// @brief plain PID level 1 controllers of every motor, evaluated together
+    PIDBank micro_bank;
+    /// @brief state feedback level 2 controllers of every motor, evaluated together
+    StateFeedbackBank feedback_bank;
+
+    /// @brief Build the plan from the controllers and the config kinematics
+    void compile_plan();
+
+    /// @brief Rebuild the state feedback bank from the plan, whenever the planned states change
+    void compile_state_feedback();
+
+    /// @brief Steps a macro state controller level of one motor over its planned states
+    /// @param motor_plan plan of the motor
+    /// @param level controller level (0 or 2), must not be null in the plan
+    /// @param macro_reference State reference (governed target state)
+    /// @param macro_estimate estimated current joint states
+    /// @param kinematics_p position kinematics matrix
+    /// @param kinematics_v velocity kinematics matrix
+    /// @param dt time (s) since the last control step
+    /// @return summed output of the controller over every state
+    float step_macro(const MotorPlan& motor_plan, int level, float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float dt);
+
     /// @brief config struct to store all config data
     /// @note this is read only
     const Config* config_data = nullptr;
 
+    /// @brief whether the position of each state wraps at +-pi, used for the state feedback errors
+    bool wrap_states[STATE_LEN] = { false };
+
 public:
     /// @brief default constructor, does nothing
     ControllerManager() = default;
 
     /// @brief Initializes controllers with data from the config yaml
     /// @param _config_data read-only config reference storing all config data
-    void init(const Config* _config_data);
+    /// @param _wrap_states STATE_LEN flags, true if the position of that state wraps (see State::get_wrap())
+    void init(const Config* _config_data, const bool _wrap_states[STATE_LEN]);
 
     /// @brief Populates the corresponding index of the "controllers" array attribute with a controller object
     /// @param can_id can bus number. Use the defines! (0 indexed. ie can_1 = 0)
@@ -32,6 +84,17 @@ public:
     /// @param gains gains matrix input (see controller.hpp for what each gain means)
     void init_controller(uint8_t can_id, uint8_t motor_id, int controller_type, int controller_level, const float gains[NUM_GAINS]);
 
+    /// @brief Adds a kinematics entry that is zero in the config but gets written at runtime (e.g. chassis rotation)
+    /// @param motor motor index
+    /// @param state state index
+    /// @note Entries that are nonzero in the config are planned automatically. Planned entries can be rewritten every tick,
+    /// step() always reads their current value from the matrices it is passed
+    void add_kinematics_entry(int motor, int state);
+
+    /// @brief Resets every controller level of a motor (integrators and timers)
+    /// @param motor motor index (can_id * NUM_MOTORS_PER_BUS + motor_id - 1)
+    void reset_motor(int motor);
+
     /// @brief Steps through controllers and calculates output, which is written to the "output" array attribute.
     /// @param macro_reference State reference (governed target state)
     /// @param macro_estimate estimated current joint states
@@ -39,7 +102,8 @@ public:
     /// @param kinematics_p position kinematics matrix relating motors to states (Number_of_motors x State_length)
     /// @param kinematics_v velocity kinematics matrix relating motors to states (Number_of_motors x State_length)
     /// @param outputs generated motor input normalized -1 to 1
-    void step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float micro_estimate[NUM_MOTORS][MICRO_STATE_LEN], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float outputs[NUM_MOTORS]);
+    /// @param time time of this control step, every controller gets the same dt
+    void step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float micro_estimate[NUM_MOTORS][MICRO_STATE_LEN], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float outputs[NUM_MOTORS], const LoopTime& time);
 };
 
 #endif // CONTROLLER_MANAGER_H
\ No newline at end of file
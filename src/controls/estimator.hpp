@@ -5,9 +5,44 @@
 #include "state.hpp"
 #include "../sensors/RefSystem.hpp"
 #include "../comms/config_layer.hpp"
+#include "../utils/logger.hpp"
+#include "../filters/mahony_filter.hpp"
+#include "../filters/chassis_ekf.hpp"
+#include "../filters/gimbal_geometry.hpp"
 
 #define NUM_SENSOR_VALUES 8
 
+/// @brief Rows of a state matrix that an estimator writes to. Row j of the view is the j-th state assigned to the estimator,
+/// so estimators index their outputs locally and write straight into the EstimatorManager's output matrix
+/// @tparam ROWS number of rows in the target matrix, also the most rows an estimator can index
+/// @tparam COLS number of columns in the target matrix
+template <int ROWS, int COLS>
+struct StateRowView {
+    /// @brief Point the local rows at rows of a target matrix
+    /// @param target matrix to write to
+    /// @param rows target row of each assigned local row, -1 to drop the writes to that local row
+    /// @param count number of assigned local rows, the rest are pointed at the scratch row
+    /// @param scratch row that catches writes to unassigned and dropped local rows, must hold COLS floats
+    void bind(float target[][COLS], const int* rows, int count, float* scratch) {
+        for (int j = 0; j < ROWS; j++) row[j] = (j < count && rows[j] >= 0) ? target[rows[j]] : scratch;
+    }
+
+    /// @brief Get a local row
+    /// @param j local row index
+    /// @return pointer to the COLS values of the row
+    inline float* operator[](int j) const { return row[j]; }
+
+private:
+    /// @brief target of each local row
+    float* row[ROWS] = { nullptr };
+};
+
+/// @brief View of the macro state (robot joint) rows an estimator writes to
+struct MacroStateView : public StateRowView<STATE_LEN, 3> {};
+
+/// @brief View of the micro state (motor) rows an estimator writes to
+struct MicroStateView : public StateRowView<NUM_MOTORS, MICRO_STATE_LEN> {};
+
 /// @brief Parent estimator struct. All estimators should inherit from this.
 struct Estimator {
 public:
@@ -15,11 +50,19 @@ public:
 
     virtual ~Estimator() {};
 
-    /// @brief step the current state(s) and update the estimate array accordingly
-    /// @param outputs estimated state array to update with certain estimated states
+    /// @brief step the current state(s) and update the estimate array accordingly. Macro estimators override this one
+    /// @param outputs view of the macro state rows assigned to this estimator
     /// @param curr_state current state array to update with new state
     /// @param override true if we want to override the current state with the new state
-    virtual void step_states(float outputs[STATE_LEN][3], float curr_state[STATE_LEN][3], int override) = 0;
+    /// @param dt time (s) since the last control step
+    virtual void step_states(MacroStateView& outputs, float curr_state[STATE_LEN][3], int override, float dt) {}
+
+    /// @brief step the current micro state(s) and update the estimate array accordingly. Micro estimators override this one
+    /// @param outputs view of the micro state rows assigned to this estimator
+    /// @param curr_state current macro state
+    /// @param override true if we want to override the current state with the new state
+    /// @param dt time (s) since the last control step
+    virtual void step_states(MicroStateView& outputs, float curr_state[STATE_LEN][3], int override, float dt) {}
 
     /// @brief gets the number of states that an estimator is estimating
     /// @return get number of states estimated by this estimator
@@ -32,9 +75,6 @@ protected:
     /// @brief number of states that an estimator will estimate. For the micro estimators its the number micro states to estimate
     int num_states;
 
-    ///@brief create a timer object for each estimator
-    Timer time;
-
     /// @brief Computes the magnitude of a vector given length n
     /// @param a Vector to compute the magnitude of
     /// @param n Length of Vector a
@@ -138,12 +178,12 @@ protected:
         // Case 2
         else {
             if (D1 == 0 && D2 == 0 && D3 == 0) {
-                Serial.println("matrix solve bad1");
+                LOG_WARN("matrix solve bad1");
                 output[0] = 0;
                 output[1] = 0;
                 output[2] = 0;
             } else if (D1 != 0 || D2 != 0 || D3 != 0) {
-                Serial.println("matrix solve bad2");
+                LOG_WARN("matrix solve bad2");
                 output[0] = 0;
                 output[1] = 0;
                 output[2] = 0;
@@ -177,23 +217,8 @@ private:
 
     /// @brief gravity pitch angle
     float starting_pitch_angle;
-    /// @brief yaw axis in spherical coords
-    float yaw_axis_spherical[3];
-
-    /// @brief pitch axis in spherical coords
-    float pitch_axis_spherical[3];
-
-    /// @brief roll axis in spherical coords
-    float roll_axis_spherical[3];
-
-    /// @brief yaw axis unit vector
-    float yaw_axis_unitvector[3];
-
-    /// @brief pitch axis unit vector
-    float pitch_axis_unitvector[3];
-
-    /// @brief roll axis unit vector
-    float roll_axis_unitvector[3];
+    /// @brief gimbal axes in the imu frame
+    GimbalGeometry geometry;
 
     /// @brief global relative yaw
     float yaw_axis_global[3];
@@ -227,20 +252,11 @@ private:
     float global_yaw_angle = 0;
     /// @brief global roll angle
     float global_roll_angle = 0;
-    /// @brief current rev encoder raw value
-    float curr_rev_raw[3] = {0};
-
-    /// @brief previous rev encoder raw value
-    float prev_rev_raw[3] = {0};
-
     /// @brief total meters travelled by each odom wheel
-    float total_odom_pos[3] = {0};
-
-    /// @brief rev encoder difference
-    float rev_diff[3] = {0};
+    float total_odom_pos[NUM_ODOM_PODS] = {0};
 
     /// @brief odom pos difference
-    float odom_pos_diff[3] = {0};
+    float odom_pos_diff[NUM_ODOM_PODS] = {0};
     /// @brief previous chassis angle
     float prev_chassis_angle = 0;
     /// @brief odom pod offset from the center of the robot
@@ -256,15 +272,12 @@ private:
     float initial_chassis_angle = 0;
     /// @brief counts one time to set the starting chassis angle
     int count1 = 0;
-    /// @brief delta time
-    float dt = 0;
-
     /// @brief buff encoder on the yaw
     BuffEncoder* buff_enc_yaw;
     /// @brief buff encoder on the pitch
     BuffEncoder* buff_enc_pitch;
-    /// @brief Odom encoder values
-    RevEncoder* rev_enc[3];
+    /// @brief Odom pod encoders
+    OdomEncoder* odom_enc[NUM_ODOM_PODS];
     /// @brief can data pointer from EstimatorManager
     CANData* can_data;
     /// @brief icm imu
@@ -279,20 +292,18 @@ private:
 public:
     /// @brief estimate the state of the gimbal
     /// @param config_data inputted sensor values from khadas yaml
-    /// @param r1 rev encoder 1
-    /// @param r2 rev encoder 2
-    /// @param r3 rev encoder 3
+    /// @param o1 odom pod encoder 1
+    /// @param o2 odom pod encoder 2
     /// @param b1 buff encoder 1
     /// @param b2 buff encoder 2
     /// @param imu icm encoder
     /// @param data can data from Estimator Manager
     /// @param n num states this estimator estimates
-    GimbalEstimator(Config config_data, RevEncoder* r1, RevEncoder* r2, RevEncoder* r3, BuffEncoder* b1, BuffEncoder* b2, ICM20649* imu, CANData* data, int n) {
+    GimbalEstimator(Config config_data, OdomEncoder* o1, OdomEncoder* o2, BuffEncoder* b1, BuffEncoder* b2, ICM20649* imu, CANData* data, int n) {
         buff_enc_yaw = b1; // sensor object definitions
         buff_enc_pitch = b2;
-        rev_enc[0] = r1;
-        rev_enc[1] = r2;
-        rev_enc[2] = r3;
+        odom_enc[0] = o1;
+        odom_enc[1] = o2;
         can_data = data;
         icm_imu = imu;
         num_states = n; // number of estimated states
@@ -314,10 +325,8 @@ public:
         odom_wheel_radius = config_data.odom_values[0];
         odom_axis_offset_x = config_data.odom_values[1];
         odom_axis_offset_y = config_data.odom_values[2];
-        // definitions for spherical coordinates of new axis in the imu refrence frame
-        yaw_axis_spherical[0] = 1;   // rho (1 for a spherical)
-        pitch_axis_spherical[0] = 1; // rho (1 for a spherical)
-        roll_axis_spherical[0] = 1;  // rho (1 for a spherical)
+        // the axis geometry only depends on config and the pitch encoder
+        geometry.init(imu_yaw_axis_vector, imu_pitch_axis_vector, starting_pitch_angle);
     }
 
     ~GimbalEstimator() {};
@@ -326,7 +335,8 @@ public:
     /// @param output output array to add estimated states to
     /// @param curr_state current state array to update with new state
     /// @param override true if we want to override the current state with the new state
-    void step_states(float output[STATE_LEN][3], float curr_state[STATE_LEN][3], int override) override {
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) override {
         // Serial.printf("Pitch encoder offset: %f\n" ,PITCH_ENCODER_OFFSET);
 
         float pitch_enc_angle = (-buff_enc_pitch->get_angle()) - PITCH_ENCODER_OFFSET;
@@ -341,74 +351,14 @@ public:
         while (yaw_enc_angle <= -PI)
             yaw_enc_angle += 2 * PI;
 
-        // calculates yaw velocity before integrating to find position
-        // calculates the difference in initial and current pitch angle
-        float pitch_diff = starting_pitch_angle - pitch_enc_angle;
-
-        // Serial.println(pitch_enc_angle);
-
-        // gimbal rotation axis in spherical coordinates in imu refrence frame
-        if (imu_yaw_axis_vector[0] == 0)
-            yaw_axis_spherical[1] = 1.57;
-        else if (imu_yaw_axis_vector[0] < 0) {
-            yaw_axis_spherical[1] = PI + atan(imu_yaw_axis_vector[1] / imu_yaw_axis_vector[0]); // theta
-        } else {
-            yaw_axis_spherical[1] = atan(imu_yaw_axis_vector[1] / imu_yaw_axis_vector[0]); // theta
-        }
-        yaw_axis_spherical[2] = acos(imu_yaw_axis_vector[2] / __magnitude(imu_yaw_axis_vector, 3)) - pitch_diff; // phi
-
-        // roll_axis_spherical[1] = yaw_axis_spherical[1]; // theta
-        // roll_axis_spherical[2] = yaw_axis_spherical[2]-(PI*0.5); // phi
-
-        // pitch_axis_spherical[1] = yaw_axis_spherical[1]-(PI*0.5);
-        // pitch_axis_spherical[2] = (PI*0.5);
-
-        // convert spherical to cartesian, These unit vectors are axis in the gimbal refrence frame
-        yaw_axis_unitvector[0] = yaw_axis_spherical[0] * cos(yaw_axis_spherical[1]) * sin(yaw_axis_spherical[2]);
-        yaw_axis_unitvector[1] = yaw_axis_spherical[0] * sin(yaw_axis_spherical[1]) * sin(yaw_axis_spherical[2]);
-        yaw_axis_unitvector[2] = yaw_axis_spherical[0] * cos(yaw_axis_spherical[2]);
-
-        // Serial.printf("x: %f,y: %f,z: %f\n", roll_axis_unitvector[0],roll_axis_unitvector[1],roll_axis_unitvector[2]);
-
-        // roll_axis_unitvector[0] = roll_axis_spherical[0]*cos(roll_axis_spherical[1])*sin(roll_axis_spherical[2]);
-        // roll_axis_unitvector[1] = roll_axis_spherical[0]*sin(roll_axis_spherical[1])*sin(roll_axis_spherical[2]);
-        // roll_axis_unitvector[2] = roll_axis_spherical[0]*cos(roll_axis_spherical[2]);
-
-        // pitch_axis_unitvector[0] = pitch_axis_spherical[0]*cos(pitch_axis_spherical[1])*sin(pitch_axis_spherical[2]);
-        // pitch_axis_unitvector[1] = pitch_axis_spherical[0]*sin(pitch_axis_spherical[1])*sin(pitch_axis_spherical[2]);
-        // pitch_axis_unitvector[2] = pitch_axis_spherical[0]*cos(pitch_axis_spherical[2]);
-        float mag = sqrt(pow(imu_pitch_axis_vector[0],2) + pow(imu_pitch_axis_vector[1],2) + pow(imu_pitch_axis_vector[2],2));
-        pitch_axis_unitvector[0] = imu_pitch_axis_vector[0] / mag;
-        pitch_axis_unitvector[1] = imu_pitch_axis_vector[1] / mag;
-        pitch_axis_unitvector[2] = imu_pitch_axis_vector[2] / mag;
-
-        __crossProduct(pitch_axis_unitvector, yaw_axis_unitvector, roll_axis_unitvector);
-
-        float magicNum = 0; // left yaw increases with 0.8
-        __rotateVector3D(roll_axis_unitvector, yaw_axis_unitvector, magicNum, yaw_axis_unitvector);
-        __rotateVector3D(roll_axis_unitvector, pitch_axis_unitvector, magicNum, pitch_axis_unitvector);
-
-        // __rotateVector3D(yaw_axis_unitvector,roll_axis_unitvector,(PI*0.5),pitch_axis_unitvector);
-
-        // offset the axis' based on the pitch yaw and roll data, These vectors give global pitch yaw and roll
-        // __rotateVector3D(roll_axis_unitvector, yaw_axis_unitvector, global_roll_angle, yaw_axis_global);
-        // __rotateVector3D(roll_axis_unitvector, pitch_axis_unitvector, global_roll_angle, pitch_axis_global);
-
-        // __rotateVector3D(pitch_axis_unitvector, yaw_axis_unitvector, (global_pitch_angle - pitch_enc_angle), yaw_axis_global);
-        // __rotateVector3D(pitch_axis_unitvector, roll_axis_unitvector, (global_pitch_angle - pitch_enc_angle), roll_axis_global);
+        // the yaw axis tilts with the pitch, the rest of the axis geometry is fixed by config
+        geometry.update(pitch_enc_angle);
 
         // gets the velocity data from the imu and uses the gravity vector to calculate the yaw velocity
         float raw_omega_vector[3] = { icm_imu->get_gyro_X(), icm_imu->get_gyro_Y(), icm_imu->get_gyro_Z() };
         // *Note: X is pitch Y is Roll Z is Yaw, when level
         // positive pitch angle is up, positive roll angle is right(robot pov), positive yaw is left(robot pov)
 
-        float temp1[3];
-        float temp2[3];
-        float temp3[3];
-        __crossProduct(yaw_axis_unitvector, pitch_axis_unitvector, temp1);
-        __crossProduct(yaw_axis_unitvector, roll_axis_unitvector, temp2);
-        __crossProduct(roll_axis_unitvector, pitch_axis_unitvector, temp3);
-
         // update previous to the current value before current is updated
         previous_pitch_velocity = current_pitch_velocity;
         previous_yaw_velocity = current_yaw_velocity;
@@ -416,17 +366,15 @@ public:
 
         float imu_vel_offset = 1;
         // calculate the pitch yaw and roll velocities (Gimbal Relative)
-        current_pitch_velocity = __vectorProduct(pitch_axis_unitvector, raw_omega_vector, 3) / imu_vel_offset;
-        current_yaw_velocity = __vectorProduct(yaw_axis_unitvector, raw_omega_vector, 3) / imu_vel_offset;
-        current_roll_velocity = -__vectorProduct(roll_axis_unitvector, raw_omega_vector, 3) / imu_vel_offset;
+        current_pitch_velocity = __vectorProduct(geometry.pitch_axis, raw_omega_vector, 3) / imu_vel_offset;
+        current_yaw_velocity = __vectorProduct(geometry.yaw_axis, raw_omega_vector, 3) / imu_vel_offset;
+        current_roll_velocity = -__vectorProduct(geometry.roll_axis, raw_omega_vector, 3) / imu_vel_offset;
 
         // calculate the pitch yaw and roll velocities (Global Reference)
         global_pitch_velocity = __vectorProduct(pitch_axis_global, raw_omega_vector, 3);
         global_yaw_velocity = __vectorProduct(yaw_axis_global, raw_omega_vector, 3);
         global_roll_velocity = __vectorProduct(roll_axis_global, raw_omega_vector, 3);
         // position integration
-        dt = time.delta();
-        
         // chassis_angle = yaw_angle - yaw_enc_angle;
         chassis_angle = -yaw_enc_angle;
         if(count1 == 0){
@@ -464,13 +412,9 @@ public:
         output[4][1] = current_pitch_velocity;
         output[4][2] = pitch_enc_angle;
 
-        for(int i = 0; i < 3; i++){
-            curr_rev_raw[i] = rev_enc[i]->get_angle_radians();
-            if ((curr_rev_raw[i]-prev_rev_raw[i]) > PI) rev_diff[i] = ((curr_rev_raw[i]-prev_rev_raw[i])-(2*PI));
-            else if ((curr_rev_raw[i]-prev_rev_raw[i]) < -PI) rev_diff[i] = ((curr_rev_raw[i]-prev_rev_raw[i])+(2*PI));
-            else rev_diff[i] = (curr_rev_raw[i]-prev_rev_raw[i]);
-            prev_rev_raw[i] = curr_rev_raw[i];
-            odom_pos_diff[i] = rev_diff[i]*odom_wheel_radius;
+        // the quadrature counters give the change since the last read directly, no wrapping needed
+        for(int i = 0; i < NUM_ODOM_PODS; i++){
+            odom_pos_diff[i] = odom_enc[i]->get_delta_radians()*odom_wheel_radius;
             total_odom_pos[i] = odom_pos_diff[i]+total_odom_pos[i];
         }
 
@@ -577,23 +521,8 @@ private:
 
     /// @brief gravity pitch angle
     float starting_pitch_angle;
-    /// @brief yaw axis in spherical coords
-    float yaw_axis_spherical[3];
-
-    /// @brief pitch axis in spherical coords
-    float pitch_axis_spherical[3];
-
-    /// @brief roll axis in spherical coords
-    float roll_axis_spherical[3];
-
-    /// @brief yaw axis unit vector
-    float yaw_axis_unitvector[3];
-
-    /// @brief pitch axis unit vector
-    float pitch_axis_unitvector[3];
-
-    /// @brief roll axis unit vector
-    float roll_axis_unitvector[3];
+    /// @brief gimbal axes in the imu frame
+    GimbalGeometry geometry;
 
     /// @brief global relative yaw
     float yaw_axis_global[3];
@@ -656,9 +585,6 @@ private:
     float initial_chassis_angle = 0;
     /// @brief counts one time to set the starting chassis angle
     int count1 = 0;
-    /// @brief delta time
-    float dt = 0;
-
     /// @brief buff encoder on the yaw
     BuffEncoder* buff_enc_yaw;
     /// @brief buff encoder on the pitch
@@ -704,10 +630,8 @@ public:
         odom_wheel_radius = config_data.odom_values[0];
         odom_axis_offset_x = config_data.odom_values[1];
         odom_axis_offset_y = config_data.odom_values[2];
-        // definitions for spherical coordinates of new axis in the imu refrence frame
-        yaw_axis_spherical[0] = 1;   // rho (1 for a spherical)
-        pitch_axis_spherical[0] = 1; // rho (1 for a spherical)
-        roll_axis_spherical[0] = 1;  // rho (1 for a spherical)
+        // the axis geometry only depends on config and the pitch encoder
+        geometry.init(imu_yaw_axis_vector, imu_pitch_axis_vector, starting_pitch_angle);
     }
 
     GimbalEstimatorNoOdom() {};
@@ -716,7 +640,8 @@ public:
     /// @param output output array to add estimated states to
     /// @param curr_state current state of the system
     /// @param override override the current state
-    void step_states(float output[STATE_LEN][3], float curr_state[STATE_LEN][3], int override) override {
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) override {
         // Serial.printf("Pitch encoder offset: %f\n" ,PITCH_ENCODER_OFFSET);
 
         float pitch_enc_angle = (-buff_enc_pitch->get_angle()) - PITCH_ENCODER_OFFSET;
@@ -731,61 +656,8 @@ public:
         while (yaw_enc_angle <= -PI)
             yaw_enc_angle += 2 * PI;
 
-        // calculates yaw velocity before integrating to find position
-        // calculates the difference in initial and current pitch angle
-        float pitch_diff = starting_pitch_angle - pitch_enc_angle;
-
-        // Serial.println(pitch_enc_angle);
-
-        // gimbal rotation axis in spherical coordinates in imu refrence frame
-        if (imu_yaw_axis_vector[0] == 0)
-            yaw_axis_spherical[1] = 1.57;
-        else if (imu_yaw_axis_vector[0] < 0) {
-            yaw_axis_spherical[1] = PI + atan(imu_yaw_axis_vector[1] / imu_yaw_axis_vector[0]); // theta
-        } else {
-            yaw_axis_spherical[1] = atan(imu_yaw_axis_vector[1] / imu_yaw_axis_vector[0]); // theta
-        }
-        yaw_axis_spherical[2] = acos(imu_yaw_axis_vector[2] / __magnitude(imu_yaw_axis_vector, 3)) - pitch_diff; // phi
-
-        // roll_axis_spherical[1] = yaw_axis_spherical[1]; // theta
-        // roll_axis_spherical[2] = yaw_axis_spherical[2]-(PI*0.5); // phi
-
-        // pitch_axis_spherical[1] = yaw_axis_spherical[1]-(PI*0.5);
-        // pitch_axis_spherical[2] = (PI*0.5);
-
-        // convert spherical to cartesian, These unit vectors are axis in the gimbal refrence frame
-        yaw_axis_unitvector[0] = yaw_axis_spherical[0] * cos(yaw_axis_spherical[1]) * sin(yaw_axis_spherical[2]);
-        yaw_axis_unitvector[1] = yaw_axis_spherical[0] * sin(yaw_axis_spherical[1]) * sin(yaw_axis_spherical[2]);
-        yaw_axis_unitvector[2] = yaw_axis_spherical[0] * cos(yaw_axis_spherical[2]);
-
-        // Serial.printf("x: %f,y: %f,z: %f\n", roll_axis_unitvector[0],roll_axis_unitvector[1],roll_axis_unitvector[2]);
-
-        // roll_axis_unitvector[0] = roll_axis_spherical[0]*cos(roll_axis_spherical[1])*sin(roll_axis_spherical[2]);
-        // roll_axis_unitvector[1] = roll_axis_spherical[0]*sin(roll_axis_spherical[1])*sin(roll_axis_spherical[2]);
-        // roll_axis_unitvector[2] = roll_axis_spherical[0]*cos(roll_axis_spherical[2]);
-
-        // pitch_axis_unitvector[0] = pitch_axis_spherical[0]*cos(pitch_axis_spherical[1])*sin(pitch_axis_spherical[2]);
-        // pitch_axis_unitvector[1] = pitch_axis_spherical[0]*sin(pitch_axis_spherical[1])*sin(pitch_axis_spherical[2]);
-        // pitch_axis_unitvector[2] = pitch_axis_spherical[0]*cos(pitch_axis_spherical[2]);
-        float mag = sqrt(pow(imu_pitch_axis_vector[0],2) + pow(imu_pitch_axis_vector[1],2) + pow(imu_pitch_axis_vector[2],2));
-        pitch_axis_unitvector[0] = imu_pitch_axis_vector[0] / mag;
-        pitch_axis_unitvector[1] = imu_pitch_axis_vector[1] / mag;
-        pitch_axis_unitvector[2] = imu_pitch_axis_vector[2] / mag;
-
-        __crossProduct(pitch_axis_unitvector, yaw_axis_unitvector, roll_axis_unitvector);
-
-        float magicNum = 0; // left yaw increases with 0.8
-        __rotateVector3D(roll_axis_unitvector, yaw_axis_unitvector, magicNum, yaw_axis_unitvector);
-        __rotateVector3D(roll_axis_unitvector, pitch_axis_unitvector, magicNum, pitch_axis_unitvector);
-
-        // __rotateVector3D(yaw_axis_unitvector,roll_axis_unitvector,(PI*0.5),pitch_axis_unitvector);
-
-        // offset the axis' based on the pitch yaw and roll data, These vectors give global pitch yaw and roll
-        // __rotateVector3D(roll_axis_unitvector, yaw_axis_unitvector, global_roll_angle, yaw_axis_global);
-        // __rotateVector3D(roll_axis_unitvector, pitch_axis_unitvector, global_roll_angle, pitch_axis_global);
-
-        // __rotateVector3D(pitch_axis_unitvector, yaw_axis_unitvector, (global_pitch_angle - pitch_enc_angle), yaw_axis_global);
-        // __rotateVector3D(pitch_axis_unitvector, roll_axis_unitvector, (global_pitch_angle - pitch_enc_angle), roll_axis_global);
+        // the yaw axis tilts with the pitch, the rest of the axis geometry is fixed by config
+        geometry.update(pitch_enc_angle);
 
         // gets the velocity data from the imu and uses the gravity vector to calculate the yaw velocity
         float raw_omega_vector[3] = { icm_imu->get_gyro_X(), icm_imu->get_gyro_Y(), icm_imu->get_gyro_Z() };
@@ -793,13 +665,6 @@ public:
         // *Note: X is pitch Y is Roll Z is Yaw, when level
         // positive pitch angle is up, positive roll angle is right(robot pov), positive yaw is left(robot pov)
 
-        float temp1[3];
-        float temp2[3];
-        float temp3[3];
-        __crossProduct(yaw_axis_unitvector, pitch_axis_unitvector, temp1);
-        __crossProduct(yaw_axis_unitvector, roll_axis_unitvector, temp2);
-        __crossProduct(roll_axis_unitvector, pitch_axis_unitvector, temp3);
-
         // update previous to the current value before current is updated
         previous_pitch_velocity = current_pitch_velocity;
         previous_yaw_velocity = current_yaw_velocity;
@@ -807,16 +672,15 @@ public:
 
         float imu_vel_offset = 1;
         // calculate the pitch yaw and roll velocities (Gimbal Relative)
-        current_pitch_velocity = __vectorProduct(pitch_axis_unitvector, raw_omega_vector, 3) / imu_vel_offset;
-        current_yaw_velocity = __vectorProduct(yaw_axis_unitvector, raw_omega_vector, 3) / imu_vel_offset;
-        current_roll_velocity = -__vectorProduct(roll_axis_unitvector, raw_omega_vector, 3) / imu_vel_offset;
+        current_pitch_velocity = __vectorProduct(geometry.pitch_axis, raw_omega_vector, 3) / imu_vel_offset;
+        current_yaw_velocity = __vectorProduct(geometry.yaw_axis, raw_omega_vector, 3) / imu_vel_offset;
+        current_roll_velocity = -__vectorProduct(geometry.roll_axis, raw_omega_vector, 3) / imu_vel_offset;
 
         // calculate the pitch yaw and roll velocities (Global Reference)
         global_pitch_velocity = __vectorProduct(pitch_axis_global, raw_omega_vector, 3);
         global_yaw_velocity = __vectorProduct(yaw_axis_global, raw_omega_vector, 3);
         global_roll_velocity = __vectorProduct(roll_axis_global, raw_omega_vector, 3);
         // position integration
-        dt = time.delta();
         if (dt > .1)
             dt = 0; // first dt loop generates huge time so check for that
         yaw_angle += current_yaw_velocity * (dt);
@@ -905,6 +769,332 @@ public:
 
 
 
+#define GIMBAL_ATTITUDE_MAX_SAMPLE_GAP_US 10000 // IMU samples further apart than this aren't integrated across
+
+/// @brief Estimate the yaw, pitch, roll and chassis heading with a quaternion attitude filter fusing the gyro and accelerometer.
+/// Unlike the Euler integration in the other gimbal estimators the accelerometer keeps pitch and roll from drifting and the filter learns the gyro bias.
+/// Every timestamped IMU sample since the last step is fed to the filter, so it runs at the IMU rate rather than the loop rate.
+/// Samples are rotated into the gimbal frame from the configured yaw and pitch axes (see GimbalGeometry) before they reach the filter.
+/// Writes the same rows as GimbalEstimatorNoOdom except x and y (0 and 1), which it doesn't estimate, with the same conventions:
+/// the pitch row holds the pitch encoder angle and the rate about the pitch axis
+struct GimbalAttitudeEstimator : public Estimator {
+private:
+    /// @brief yaw encoder offset for 0 radians
+    float YAW_ENCODER_OFFSET;
+    /// @brief pitch encoder offset for 0 radians
+    float PITCH_ENCODER_OFFSET;
+    /// @brief added to the filter yaw so it starts at the configured angle and follows overrides
+    float yaw_offset;
+    /// @brief chassis angle from the previous step
+    float prev_chassis_angle = 0;
+    /// @brief counts one time to set the starting chassis angle
+    int count1 = 0;
+    /// @brief attitude filter, runs in the gimbal frame
+    MahonyFilter filter;
+    /// @brief gimbal axes in the IMU frame
+    GimbalGeometry geometry;
+    /// @brief rotation from the IMU frame to the gimbal frame (X pitch axis, Y roll axis, Z yaw axis at the calibration pitch).
+    /// The IMU is on the pitch stage so this is fixed, the filter's pitch is measured from the calibration pitch
+    float imu_to_gimbal[3][3];
+    /// @brief time (us) of the last IMU sample given to the filter
+    uint32_t last_sample_us = 0;
+    /// @brief buff encoder on the yaw
+    BuffEncoder* buff_enc_yaw;
+    /// @brief buff encoder on the pitch
+    BuffEncoder* buff_enc_pitch;
+    /// @brief icm imu
+    ICM20649* icm_imu;
+
+public:
+    /// @brief estimate the attitude of the gimbal
+    /// @param config_data inputted sensor values from khadas yaml
+    /// @param b1 buff encoder on the yaw
+    /// @param b2 buff encoder on the pitch
+    /// @param imu icm imu on the gimbal
+    /// @param n num states this estimator estimates
+    GimbalAttitudeEstimator(Config config_data, BuffEncoder* b1, BuffEncoder* b2, ICM20649* imu, int n) {
+        buff_enc_yaw = b1;
+        buff_enc_pitch = b2;
+        icm_imu = imu;
+        num_states = n;
+        YAW_ENCODER_OFFSET = config_data.encoder_offsets[0];
+        PITCH_ENCODER_OFFSET = config_data.encoder_offsets[1];
+        yaw_offset = config_data.default_gimbal_starting_angles[0];
+
+        // the gimbal axes at the pitch the yaw axis was calibrated at give the fixed IMU to gimbal rotation
+        geometry.init(config_data.yaw_axis_vector, config_data.pitch_axis_vector, config_data.pitch_angle_at_yaw_imu_calibration);
+        geometry.update(config_data.pitch_angle_at_yaw_imu_calibration);
+        // X along the pitch axis, Y = Z x X (GimbalGeometry's roll axis points the other way), then Z = X x Y so the rows stay orthonormal
+        // even if the configured axes aren't quite perpendicular
+        float* x = imu_to_gimbal[0];
+        float* y = imu_to_gimbal[1];
+        float* z = imu_to_gimbal[2];
+        for (int i = 0; i < 3; i++) {
+            x[i] = geometry.pitch_axis[i];
+            y[i] = -geometry.roll_axis[i];
+        }
+        float y_mag = sqrtf(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]);
+        for (int i = 0; i < 3; i++) y[i] /= y_mag;
+        z[0] = x[1] * y[2] - x[2] * y[1];
+        z[1] = x[2] * y[0] - x[0] * y[2];
+        z[2] = x[0] * y[1] - x[1] * y[0];
+    }
+
+    /// @brief calculate estimated states and add to output array
+    /// @param output output array to add estimated states to
+    /// @param curr_state current state of the system
+    /// @param override override the current yaw
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) override {
+        float pitch_enc_angle = (-buff_enc_pitch->get_angle()) - PITCH_ENCODER_OFFSET;
+        while (pitch_enc_angle >= PI)
+            pitch_enc_angle -= 2 * PI;
+        while (pitch_enc_angle <= -PI)
+            pitch_enc_angle += 2 * PI;
+
+        float yaw_enc_angle = (buff_enc_yaw->get_angle()) - YAW_ENCODER_OFFSET;
+        while (yaw_enc_angle >= PI)
+            yaw_enc_angle -= 2 * PI;
+        while (yaw_enc_angle <= -PI)
+            yaw_enc_angle += 2 * PI;
+
+        if (count1 == 0) {
+            count1++;
+            dt = 0;
+        }
+
+        // integrate every IMU sample over its own time step instead of once per loop
+        for (int i = 0; i < icm_imu->get_num_samples(); i++) {
+            const IMUSample& sample = icm_imu->get_sample(i);
+            int32_t sample_dt_us = (int32_t)(sample.time_us - last_sample_us);
+            // skip the step over the first sample and over gaps (FIFO resets)
+            float sample_dt = (last_sample_us != 0 && sample_dt_us > 0 && sample_dt_us < GIMBAL_ATTITUDE_MAX_SAMPLE_GAP_US) ? sample_dt_us * 1e-6f : 0;
+            last_sample_us = sample.time_us;
+            float gyro[3];
+            float accel[3];
+            to_gimbal_frame(sample.gyro, gyro);
+            to_gimbal_frame(sample.accel, accel);
+            filter.update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], sample_dt);
+        }
+
+        float raw_omega[3] = { icm_imu->get_gyro_X(), icm_imu->get_gyro_Y(), icm_imu->get_gyro_Z() };
+        float omega[3];
+        to_gimbal_frame(raw_omega, omega);
+
+        float yaw, pitch, roll;
+        filter.get_euler(yaw, pitch, roll);
+        if (override == 1) yaw_offset = curr_state[3][0] - yaw;
+        yaw += yaw_offset;
+        while (yaw >= PI)
+            yaw -= 2 * PI;
+        while (yaw <= -PI)
+            yaw += 2 * PI;
+
+        // bias corrected rates in the gimbal frame, yaw about the world vertical and pitch about the gimbal's pitch axis
+        // (omega[0] is the raw rate projected on geometry.pitch_axis, the first row of imu_to_gimbal)
+        const float* bias_correction = filter.get_bias_correction();
+        for (int i = 0; i < 3; i++) omega[i] += bias_correction[i];
+        float world_omega[3];
+        filter.body_to_world(omega, world_omega);
+
+        float chassis_angle = yaw - yaw_enc_angle;
+        while (chassis_angle >= PI)
+            chassis_angle -= 2 * PI;
+        while (chassis_angle <= -PI)
+            chassis_angle += 2 * PI;
+        float d_chassis_heading = chassis_angle - prev_chassis_angle;
+        if (d_chassis_heading > PI) d_chassis_heading -= 2 * PI;
+        else if (d_chassis_heading < -PI) d_chassis_heading += 2 * PI;
+        prev_chassis_angle = chassis_angle;
+
+        output[2][0] = chassis_angle;
+        output[2][1] = dt > 0 ? d_chassis_heading / dt : 0;
+        output[2][2] = yaw_enc_angle;
+        output[3][0] = yaw;
+        output[3][1] = world_omega[2];
+        output[3][2] = roll;
+        output[4][0] = pitch_enc_angle;
+        output[4][1] = omega[0];
+        output[4][2] = pitch_enc_angle;
+    }
+
+    /// @brief Get the attitude filter
+    /// @return the filter, its pitch is the world pitch of the gimbal measured from the calibration pitch
+    inline const MahonyFilter& get_filter() const { return filter; }
+
+private:
+    /// @brief Rotate a vector from the IMU frame into the gimbal frame
+    /// @param imu vector in the IMU frame
+    /// @param gimbal vector in the gimbal frame
+    inline void to_gimbal_frame(const float imu[3], float gimbal[3]) const {
+        for (int i = 0; i < 3; i++) gimbal[i] = imu_to_gimbal[i][0] * imu[0] + imu_to_gimbal[i][1] * imu[1] + imu_to_gimbal[i][2] * imu[2];
+    }
+};
+
+#define CHASSIS_WHEEL_RADIUS 0.0516f            // drive wheel radius (m)
+#define CHASSIS_GEAR_RATIO 0.10897435897f       // drive wheel turns per motor rotor turn
+#define CHASSIS_WHEEL_ARM 0.1835f               // drive wheel surface speed per rad/s of chassis rotation (m)
+#define CHASSIS_NUM_WHEELS 4                    // drive wheels, logical motors 0-3 of the motor map
+
+/// @brief Estimate the chassis pose and velocity with a ChassisEKF.
+/// Fuses the odometry pod deltas, the four drive wheel speeds from CAN (logical motors 0-3: front right, back right,
+/// back left, front left) and the chassis yaw rate (gimbal IMU yaw rate minus the yaw encoder rate)
+struct ChassisEstimator : public Estimator {
+private:
+    /// @brief yaw encoder offset for 0 radians
+    float YAW_ENCODER_OFFSET;
+    /// @brief pitch encoder offset for 0 radians
+    float PITCH_ENCODER_OFFSET;
+    /// @brief gimbal yaw the chassis heading starts from
+    float starting_yaw;
+    /// @brief yaw encoder angle from the previous step
+    float prev_yaw_enc_angle = 0;
+    /// @brief whether the filter has been started
+    bool started = false;
+    /// @brief gimbal axes in the IMU frame
+    GimbalGeometry geometry;
+    /// @brief odom pod wheel radius
+    float odom_wheel_radius;
+    /// @brief rolling direction (x, y) and rotation lever of each odom pod in the chassis frame
+    float pod_geometry[NUM_ODOM_PODS][3];
+    /// @brief CAN frame count of each drive motor at the last step, wheels are only fused when they send a new frame
+    uint32_t prev_seq[CHASSIS_NUM_WHEELS] = { 0 };
+    /// @brief chassis filter
+    ChassisEKF ekf;
+    /// @brief Odom pod encoders
+    OdomEncoder* odom_enc[NUM_ODOM_PODS];
+    /// @brief buff encoder on the yaw
+    BuffEncoder* buff_enc_yaw;
+    /// @brief buff encoder on the pitch
+    BuffEncoder* buff_enc_pitch;
+    /// @brief icm imu
+    ICM20649* icm_imu;
+    /// @brief can data pointer from EstimatorManager
+    CANData* can_data;
+
+public:
+    /// @brief estimate the chassis pose
+    /// @param config_data inputted sensor values from khadas yaml
+    /// @param o1 odom pod encoder 1
+    /// @param o2 odom pod encoder 2
+    /// @param b1 buff encoder on the yaw
+    /// @param b2 buff encoder on the pitch
+    /// @param imu icm imu on the gimbal
+    /// @param data can data from Estimator Manager
+    /// @param n num states this estimator estimates
+    ChassisEstimator(Config config_data, OdomEncoder* o1, OdomEncoder* o2, BuffEncoder* b1, BuffEncoder* b2, ICM20649* imu, CANData* data, int n) {
+        odom_enc[0] = o1;
+        odom_enc[1] = o2;
+        buff_enc_yaw = b1;
+        buff_enc_pitch = b2;
+        icm_imu = imu;
+        can_data = data;
+        num_states = n;
+        YAW_ENCODER_OFFSET = config_data.encoder_offsets[0];
+        PITCH_ENCODER_OFFSET = config_data.encoder_offsets[1];
+        starting_yaw = config_data.default_gimbal_starting_angles[0];
+        geometry.init(config_data.yaw_axis_vector, config_data.pitch_axis_vector, config_data.pitch_angle_at_yaw_imu_calibration);
+
+        // the pods are turned 10 degrees, the same layout GimbalEstimator integrates
+        float odom_angle_offset = 0.1745;
+        odom_wheel_radius = config_data.odom_values[0];
+        pod_geometry[0][0] = cosf(odom_angle_offset);
+        pod_geometry[0][1] = sinf(odom_angle_offset);
+        pod_geometry[0][2] = -config_data.odom_values[1];
+        pod_geometry[1][0] = -sinf(odom_angle_offset);
+        pod_geometry[1][1] = cosf(odom_angle_offset);
+        pod_geometry[1][2] = -config_data.odom_values[2];
+    }
+
+    /// @brief calculate estimated states and add to output array
+    /// @param output output array to add estimated states to
+    /// @param curr_state current state of the system
+    /// @param override override the current pose
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) override {
+        // drive wheel surface speed per m/s of chassis x, y and per rad/s of rotation, for logical motors 0-3
+        static const float wheel_rows[CHASSIS_NUM_WHEELS][3] = {
+            { 1, 0, CHASSIS_WHEEL_ARM },
+            { 0, -1, CHASSIS_WHEEL_ARM },
+            { -1, 0, CHASSIS_WHEEL_ARM },
+            { 0, 1, CHASSIS_WHEEL_ARM },
+        };
+
+        float pitch_enc_angle = (-buff_enc_pitch->get_angle()) - PITCH_ENCODER_OFFSET;
+        while (pitch_enc_angle >= PI)
+            pitch_enc_angle -= 2 * PI;
+        while (pitch_enc_angle <= -PI)
+            pitch_enc_angle += 2 * PI;
+
+        float yaw_enc_angle = (buff_enc_yaw->get_angle()) - YAW_ENCODER_OFFSET;
+        while (yaw_enc_angle >= PI)
+            yaw_enc_angle -= 2 * PI;
+        while (yaw_enc_angle <= -PI)
+            yaw_enc_angle += 2 * PI;
+
+        if (!started) {
+            ekf.reset(0, 0, starting_yaw - yaw_enc_angle);
+            prev_yaw_enc_angle = yaw_enc_angle;
+            started = true;
+            dt = 0;
+        }
+        if (override == 1) ekf.set_pose(curr_state[0][0], curr_state[1][0], curr_state[2][0]);
+
+        if (dt > 0) {
+            ekf.predict(dt);
+
+            // the chassis turns at the gimbal's yaw rate minus the yaw joint's rate
+            geometry.update(pitch_enc_angle);
+            float omega[3] = { icm_imu->get_gyro_X(), icm_imu->get_gyro_Y(), icm_imu->get_gyro_Z() };
+            float yaw_enc_rate = yaw_enc_angle - prev_yaw_enc_angle;
+            if (yaw_enc_rate > PI) yaw_enc_rate -= 2 * PI;
+            else if (yaw_enc_rate < -PI) yaw_enc_rate += 2 * PI;
+            yaw_enc_rate /= dt;
+            ekf.update_yaw_rate(__vectorProduct(geometry.yaw_axis, omega, 3) - yaw_enc_rate);
+
+            for (int i = 0; i < NUM_ODOM_PODS; i++) {
+                float speed = odom_enc[i]->get_delta_radians() * odom_wheel_radius / dt;
+                ekf.update_pod(pod_geometry[i][0], pod_geometry[i][1], pod_geometry[i][2], speed);
+            }
+
+            // wheels are found through the motor map, unmapped and offline ones are left out
+            for (int i = 0; i < CHASSIS_NUM_WHEELS; i++) {
+                int slot = can_data->motor_slot[i];
+                if (slot < 0 || !can_data->is_online(i)) continue;
+                uint32_t seq = can_data->seq[slot / NUM_MOTORS_PER_BUS][slot % NUM_MOTORS_PER_BUS];
+                if (seq == prev_seq[i]) continue;
+                prev_seq[i] = seq;
+                float speed = can_data->velocity[slot] * CHASSIS_GEAR_RATIO * CHASSIS_WHEEL_RADIUS;
+                ekf.update_wheel(wheel_rows[i][0], wheel_rows[i][1], wheel_rows[i][2], speed);
+            }
+        }
+        prev_yaw_enc_angle = yaw_enc_angle;
+
+        const float* state = ekf.get_state();
+        float vx, vy;
+        ekf.get_world_velocity(vx, vy);
+        output[0][0] = state[0]; // x pos
+        output[0][1] = vx;
+        output[0][2] = 0;
+        output[1][0] = state[1]; // y pos
+        output[1][1] = vy;
+        output[1][2] = 0;
+        output[2][0] = state[2]; // chassis angle
+        output[2][1] = state[5];
+        output[2][2] = yaw_enc_angle;
+    }
+
+    /// @brief Get the filter, for its covariance
+    /// @return the chassis filter
+    inline const ChassisEKF& get_filter() const { return ekf; }
+
+    /// @brief Get the variance of the pose estimate
+    /// @param variance x (m^2), y (m^2) and heading (rad^2) variance
+    inline void get_pose_variance(float variance[3]) const {
+        for (int i = 0; i < 3; i++) variance[i] = ekf.get_covariance(i, i);
+    }
+};
+
 /// @brief Estimate the state of the flywheels as meters/second of balls exiting the barrel.
 struct FlyWheelEstimator : public Estimator {
 private:
@@ -936,11 +1126,12 @@ public:
     /// @param output array to be updated with the calculated states
     /// @param curr_state current state of the flywheel
     /// @param override override flag
-    void step_states(float output[STATE_LEN][3], float curr_state[STATE_LEN][3], int override) {
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) {
         //can
         float radius = 30 * 0.001; //meters
-        float angular_velocity_l = -can_data->get_motor_attribute(CAN_2, 3, MotorAttribute::SPEED) * (2 * PI) / 60;
-        float angular_velocity_r = can_data->get_motor_attribute(CAN_2, 4, MotorAttribute::SPEED) * (2 * PI) / 60;
+        float angular_velocity_l = -can_data->velocity[can_motor_index(CAN_2, 3)];
+        float angular_velocity_r = can_data->velocity[can_motor_index(CAN_2, 4)];
         float angular_velocity_avg = (angular_velocity_l + angular_velocity_r) / 2;
         linear_velocity = angular_velocity_avg * radius; //m/s
 
@@ -985,9 +1176,10 @@ public:
     /// @param output updated balls per second of feeder
     /// @param curr_state current state of the feeder
     /// @param override override flag
-    void step_states(float output[STATE_LEN][3], float curr_state[STATE_LEN][3], int override) {
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) {
         //can
-        float angular_velocity_motor = can_data->get_motor_attribute(CAN_2, 5, MotorAttribute::SPEED) / 60;
+        float angular_velocity_motor = can_data->velocity[can_motor_index(CAN_2, 5)] / (2 * PI); // rev/s
         float angular_velocity_feeder = angular_velocity_motor / 36;
         balls_per_second_can = angular_velocity_feeder * 8;
 
@@ -1020,9 +1212,6 @@ private:
     /// @brief total motor angle
     float total_motor_angle = 0;
 
-    /// @brief delta time
-    float dt = 0;
-
     /// @brief count to check if dt is valid
     int count = 0;
 public:
@@ -1043,12 +1232,13 @@ public:
     /// @param output updated balls per second of feeder
     /// @param curr_state current state of the barrel switcher
     /// @param override override flag
-    void step_states(float output[STATE_LEN][3], float curr_state[STATE_LEN][3], int override) {
-        dt = time.delta();
-        //read tof sensor (millimeters)
-        float tof_distance = ((float)(time_of_flight->read()) - tof_sensor_offset)/tof_scale;
-        float angular_velocity_motor = -((((can_data->get_motor_attribute(CAN_2, 6, MotorAttribute::SPEED) / 60)*(2*PI))/36.0)*(5.1))/tof_scale;
-        total_motor_angle += (can_data->get_motor_attribute(CAN_2, 6, MotorAttribute::SPEED) * (2*PI/60.0))*dt;
+    /// @param dt time (s) since the last control step
+    void step_states(MacroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) {
+        //latest tof sensor distance (millimeters), the sensor itself is read by a slow scheduler task
+        float tof_distance = ((float)(time_of_flight->get_distance()) - tof_sensor_offset)/tof_scale;
+        float motor_velocity = can_data->velocity[can_motor_index(CAN_2, 6)];
+        float angular_velocity_motor = -((motor_velocity/36.0)*(5.1))/tof_scale;
+        total_motor_angle = can_data->position[can_motor_index(CAN_2, 6)];
         // float rad_per_switch = 315;
         // if(total_motor_angle > rad_per_switch){
         //     total_motor_angle = rad_per_switch;
@@ -1064,7 +1254,6 @@ public:
         // }
         // distance_from_right = distance_from_right*0.99 + tof_distance*0.01;
         output[0][0] = tof_distance;
-        Serial.printf("tof: %f\n",tof_distance);
         output[0][1] = angular_velocity_motor;
     }
 };
@@ -1088,13 +1277,14 @@ public:
 
     /// @brief step through each motor and add to micro state
     /// @param output entire micro state 
-    /// @param curr_state current micro state
+    /// @param curr_state current macro state (unused)
     /// @param override override flag
-    void step_states(float output[NUM_MOTORS][MICRO_STATE_LEN], float curr_state[NUM_MOTORS][MICRO_STATE_LEN], int override) {
-        for (int i = 0; i < NUM_CAN_BUSES; i++) {
-            for (int j = 0; j < NUM_MOTORS_PER_BUS; j++) {
-                output[(i * NUM_MOTORS_PER_BUS) + j][0] = (can_data->get_motor_attribute(i, j + 1, MotorAttribute::SPEED) / 60) * 2 * PI;
-            }
+    /// @param dt time (s) since the last control step
+    void step_states(MicroStateView& output, float curr_state[STATE_LEN][3], int override, float dt) override {
+        // velocities are already decoded to rad/s, the motor map gives each micro state motor's slot on the buses
+        for (int i = 0; i < NUM_MOTORS; i++) {
+            int slot = can_data->motor_slot[i];
+            output[i][0] = slot >= 0 ? can_data->velocity[slot] : 0;
         }
     }
 };
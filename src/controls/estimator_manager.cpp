@@ -38,6 +38,7 @@ void EstimatorManager::init(CANData* _can_data, const Config* _config_data) {
     for (int i = 0;i < config_data->num_sensors[0];i++) {
         buff_sensors[i].init(config_data->encoder_pins[i]);
     }
+    buff_batch.init(buff_sensors, config_data->num_sensors[0]);
 
     // initialize ICMs
     for (int i = 0;i < config_data->num_sensors[1];i++) {
@@ -50,6 +51,21 @@ void EstimatorManager::init(CANData* _can_data, const Config* _config_data) {
         rev_sensors[i].init(REV_ENC_PIN1 + i, true);
     }
 
+    // odometry pods count in hardware, their PWM angle is only needed to home them
+    const uint8_t odom_pins[NUM_ODOM_PODS][2] = { { ODOM_ENC1_PIN_A, ODOM_ENC1_PIN_B }, { ODOM_ENC2_PIN_A, ODOM_ENC2_PIN_B } };
+    // pod 2's pins are CAN3's RX/TX, taking them for XBAR would cut off every motor on CAN3
+    bool can3_used = false;
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        if (can_data->motor_slot[i] >= can_motor_index(CAN_3, 1)) can3_used = true;
+    }
+    for (int i = 0; i < config_data->num_sensors[2] && i < NUM_ODOM_PODS; i++) {
+        if (i == 1 && can3_used) {
+            LOG_ERROR("Odom pod 2 shares pins %d/%d with CAN3, which has motors mapped, the pod is not read", ODOM_ENC2_PIN_A, ODOM_ENC2_PIN_B);
+            continue;
+        }
+        if (odom_sensors[i].init(odom_pins[i][0], odom_pins[i][1], i + 1, &rev_sensors[i])) rev_sensors[i].end();
+    }
+
     // initialize TOFs
     for (int i = 0;i < config_data->num_sensors[3];i++) {
         tof_sensors[i].init();
@@ -77,7 +93,7 @@ void EstimatorManager::init_estimator(int estimator_id, int num_states) {
 
     switch (estimator_id) {
     case 1:
-        estimators[num_estimators] = new GimbalEstimator(*config_data, &rev_sensors[0], &rev_sensors[1], &rev_sensors[2], &buff_sensors[0], &buff_sensors[1], &icm_sensors[0], can_data, num_states);
+        estimators[num_estimators] = new GimbalEstimator(*config_data, &odom_sensors[0], &odom_sensors[1], &buff_sensors[0], &buff_sensors[1], &icm_sensors[0], can_data, num_states);
         break;
 
     case 2:
@@ -95,6 +111,13 @@ void EstimatorManager::init_estimator(int estimator_id, int num_states) {
     case 6:
         estimators[num_estimators] = new GimbalEstimatorNoOdom(*config_data, &buff_sensors[0], &buff_sensors[1], &icm_sensors[0], can_data, num_states);
         break;
+    case 7:
+        estimators[num_estimators] = new GimbalAttitudeEstimator(*config_data, &buff_sensors[0], &buff_sensors[1], &icm_sensors[0], num_states);
+        break;
+    case 8:
+        chassis_estimator = new ChassisEstimator(*config_data, &odom_sensors[0], &odom_sensors[1], &buff_sensors[0], &buff_sensors[1], &icm_sensors[0], can_data, num_states);
+        estimators[num_estimators] = chassis_estimator;
+        break;
     default:
         break;
     }
@@ -102,46 +125,25 @@ void EstimatorManager::init_estimator(int estimator_id, int num_states) {
     num_estimators++;
 }
 
-void EstimatorManager::step(float macro_outputs[STATE_LEN][3], float micro_outputs[NUM_MOTORS][MICRO_STATE_LEN], int override) {
-    // clear output
-    float curr_state[STATE_LEN][3] = { 0 };
+void EstimatorManager::step(float macro_outputs[STATE_LEN][3], float micro_outputs[NUM_MOTORS][MICRO_STATE_LEN], int override, const LoopTime& time) {
+    // estimators write straight into the outputs, so keep the incoming state for the ones that read it
+    float curr_state[STATE_LEN][3];
     memcpy(curr_state, macro_outputs, sizeof(curr_state));
     clear_outputs(macro_outputs, micro_outputs);
 
-    for (int i = 0; i < num_estimators; i++) {
-        int num_states = estimators[i]->get_num_states();
-        float macro_states[STATE_LEN][3] = { 0 };
-        float micro_states[NUM_MOTORS][MICRO_STATE_LEN] = { 0 };
+    if (macro_outputs != bound_macro || micro_outputs != bound_micro) bind_views(macro_outputs, micro_outputs);
 
-        if (!estimators[i]->micro_estimator) {
+    track_gyro_bias(time.dt);
 
-            estimators[i]->step_states(macro_states, curr_state, override);
-            for (int j = 0; j < num_states; j++) {
-                for (int k = 0; k < 3; k++)
-                    macro_outputs[applied_states[i][j]][k] = macro_outputs[applied_states[i][j]][k] + macro_states[j][k];
-            }
-        } else {
-            estimators[i]->step_states(micro_states, curr_state, override);
-            for (int j = 0; j < num_states; j++) {
-                for (int k = 0; k < MICRO_STATE_LEN; k++) {
-                    micro_outputs[applied_states[i][j]][k] = micro_outputs[applied_states[i][j]][k] + micro_states[j][k];
-                }
-            }
-        }
+    for (int i = 0; i < num_estimators; i++) {
+        if (!estimators[i]->micro_estimator) estimators[i]->step_states(macro_views[i], curr_state, override, time.dt);
+        else estimators[i]->step_states(micro_views[i], curr_state, override, time.dt);
     }
 }
 
 void EstimatorManager::clear_outputs(float macro_outputs[STATE_LEN][3], float micro_outputs[NUM_MOTORS][MICRO_STATE_LEN]) {
-    for (int i = 0; i < STATE_LEN; i++) {
-        for (int j = 0; j < 3; j++) {
-            macro_outputs[i][j] = 0;
-        }
-    }
-    for (int i = 0; i < NUM_MOTORS; i++) {
-        for (int j = 0; j < MICRO_STATE_LEN; j++) {
-            micro_outputs[i][j] = 0;
-        }
-    }
+    memset(macro_outputs, 0, sizeof(float) * STATE_LEN * 3);
+    memset(micro_outputs, 0, sizeof(float) * NUM_MOTORS * MICRO_STATE_LEN);
 }
 
 void EstimatorManager::assign_states(const float as[NUM_ESTIMATORS][STATE_LEN]) {
@@ -150,45 +152,241 @@ void EstimatorManager::assign_states(const float as[NUM_ESTIMATORS][STATE_LEN])
             applied_states[i][j] = (int)as[i][j];
         }
     }
+
+    // each state is written by exactly one estimator now that they write in place, outputs are no longer summed.
+    // the first estimator assigned a state keeps it, the writes of any later one are dropped into the scratch row
+    int owner[STATE_LEN];
+    for (int n = 0; n < STATE_LEN; n++) owner[n] = -1;
+    for (int i = 0; i < num_estimators; i++) {
+        if (estimators[i]->micro_estimator) continue;
+        for (int j = 0; j < estimators[i]->get_num_states() && j < STATE_LEN; j++) {
+            int n = applied_states[i][j];
+            if (n < 0 || n >= STATE_LEN) {
+                LOG_WARN("Estimator %d assigned to invalid state %d, its output is dropped", i, n);
+                applied_states[i][j] = -1;
+                continue;
+            }
+            if (owner[n] >= 0) {
+                LOG_WARN("State %d is assigned to estimators %d and %d, the output of %d is dropped", n, owner[n], i, i);
+                applied_states[i][j] = -1;
+                continue;
+            }
+            owner[n] = i;
+        }
+    }
+
+    // rebind the views on the next step
+    bound_macro = nullptr;
+    bound_micro = nullptr;
+}
+
+void EstimatorManager::bind_views(float macro_outputs[STATE_LEN][3], float micro_outputs[NUM_MOTORS][MICRO_STATE_LEN]) {
+    for (int i = 0; i < num_estimators; i++) {
+        int num_states = estimators[i]->get_num_states();
+        if (!estimators[i]->micro_estimator) macro_views[i].bind(macro_outputs, applied_states[i], min(num_states, STATE_LEN), scratch_row);
+        else micro_views[i].bind(micro_outputs, applied_states[i], min(num_states, NUM_MOTORS), scratch_row);
+    }
+    bound_macro = macro_outputs;
+    bound_micro = micro_outputs;
 }
 
 void EstimatorManager::read_sensors() {
     if (!config_data)
         Serial.println("CONFIG DATA IS NULL!!!!!");
 
-    for (int i = 0; i < config_data->num_sensors[0]; i++) {
-        buff_sensors[i].read();
-    }
+    // the encoders transfer on SPI while the IMU reads on SPI1
+    buff_batch.start();
     for (int i = 0; i < config_data->num_sensors[1]; i++) {
         icm_sensors[i].read();
     }
-    for (int i = 0; i < config_data->num_sensors[2]; i++) {
-        rev_sensors[i].read();
+    if (refining_imu_bias && config_data->num_sensors[1] > 0) refine_imu_bias();
+    for (int i = 0; i < config_data->num_sensors[2] && i < NUM_ODOM_PODS; i++) {
+        odom_sensors[i].read();
+    }
+    buff_batch.finish();
+}
+
+void EstimatorManager::read_slow_sensors() {
+    if (!config_data) return;
+
+    for (int i = 0; i < config_data->num_sensors[3]; i++) {
+        tof_sensors[i].read();
     }
 }
 
 void EstimatorManager::calibrate_imus() {
+    float mean[3];
+    float spread[3];
+
+    // a stored calibration only needs a short still window to confirm it
+    float temperature = icm_sensors[0].read_temperature();
+    if (imu_calibration.load()) {
+        Serial.println("Checking stored IMU calibration...");
+        int num_samples = average_imu_samples(IMU_VALIDATION_SAMPLES, mean, spread);
+
+        bool still = num_samples > 0;
+        bool matches = fabsf(temperature - imu_calibration.temperature) < IMU_CALIBRATION_TEMP_TOLERANCE;
+        for (int i = 0; i < 3; i++) {
+            if (spread[i] > IMU_STILL_THRESHOLD) still = false;
+            if (fabsf(mean[i] - imu_calibration.offset[i]) > IMU_BIAS_TOLERANCE) matches = false;
+        }
+
+        if (still && matches) {
+            Serial.printf("Using stored offsets: %f, %f, %f (%f C)\n", imu_calibration.offset[0], imu_calibration.offset[1], imu_calibration.offset[2], imu_calibration.temperature);
+            icm_sensors[0].set_offsets(imu_calibration.offset[0], imu_calibration.offset[1], imu_calibration.offset[2]);
+            imu_calibration.temperature = temperature;
+            refine_count = 0;
+            refining_imu_bias = true;
+            return;
+        }
+        if (!still) Serial.println("IMU moved while checking the stored calibration");
+        else Serial.printf("Stored IMU calibration doesn't match (%f C now, %f C stored)\n", temperature, imu_calibration.temperature);
+    }
+
     Serial.println("Calibrating IMU's...");
-    float sum_x = 0;
-    float sum_y = 0;
-    float sum_z = 0;
+    int num_samples = average_imu_samples(NUM_IMU_CALIBRATION, mean, spread);
+    if (num_samples == 0) {
+        Serial.println("No IMU samples to calibrate with");
+        return;
+    }
+
+    Serial.printf("Calibrated offsets: %f, %f, %f", mean[0], mean[1], mean[2]);
+    Serial.println();
+    icm_sensors[0].set_offsets(mean[0], mean[1], mean[2]);
+    start_gyro_bias_tracking();
+
+    // offsets from a moving IMU would fail every later boot check, so they're used but not kept
+    if (spread[0] > IMU_STILL_THRESHOLD || spread[1] > IMU_STILL_THRESHOLD || spread[2] > IMU_STILL_THRESHOLD) {
+        Serial.println("IMU moved while calibrating, offsets not stored");
+        return;
+    }
+    for (int i = 0; i < 3; i++) imu_calibration.offset[i] = mean[i];
+    imu_calibration.temperature = temperature;
+    imu_calibration.store();
+}
 
-    float sum_accel_x = 0;
-    float sum_accel_y = 0;
-    float sum_accel_z = 0;
+int EstimatorManager::average_imu_samples(int count, float mean[3], float spread[3]) {
+    float sum[3] = { 0 };
+    float low[3] = { 0 };
+    float high[3] = { 0 };
+    for (int i = 0; i < 3; i++) mean[i] = spread[i] = 0;
 
-    for (int i = 0; i < NUM_IMU_CALIBRATION; i++) {
+    // average every sample the IMU produces, the FIFO gives several per read and none while a burst is running
+    int num_samples = 0;
+    uint32_t start_ms = millis();
+    while (num_samples < count && millis() - start_ms < IMU_CALIBRATION_TIMEOUT_MS) {
         icm_sensors[0].read();
-        sum_x += icm_sensors[0].get_gyro_X();
-        sum_y += icm_sensors[0].get_gyro_Y();
-        sum_z += icm_sensors[0].get_gyro_Z();
+        for (int k = 0; k < icm_sensors[0].get_num_samples(); k++) {
+            const IMUSample& sample = icm_sensors[0].get_sample(k);
+            for (int i = 0; i < 3; i++) {
+                sum[i] += sample.gyro[i];
+                low[i] = (num_samples + k == 0) ? sample.gyro[i] : min(low[i], sample.gyro[i]);
+                high[i] = (num_samples + k == 0) ? sample.gyro[i] : max(high[i], sample.gyro[i]);
+            }
+        }
+        num_samples += icm_sensors[0].get_num_samples();
+    }
+    if (num_samples == 0) return 0;
 
-        sum_accel_x += icm_sensors[0].get_accel_X();
-        sum_accel_y += icm_sensors[0].get_accel_Y();
-        sum_accel_z += icm_sensors[0].get_accel_Z();
+    for (int i = 0; i < 3; i++) {
+        mean[i] = sum[i] / num_samples;
+        spread[i] = high[i] - low[i];
     }
+    return num_samples;
+}
 
-    Serial.printf("Calibrated offsets: %f, %f, %f", sum_x / NUM_IMU_CALIBRATION, sum_y / NUM_IMU_CALIBRATION, sum_z / NUM_IMU_CALIBRATION);
-    Serial.println();
-    icm_sensors[0].set_offsets(sum_x / NUM_IMU_CALIBRATION, sum_y / NUM_IMU_CALIBRATION, sum_z / NUM_IMU_CALIBRATION);
+void EstimatorManager::refine_imu_bias() {
+    float offset[3];
+    icm_sensors[0].get_offsets(offset[0], offset[1], offset[2]);
+
+    for (int k = 0; k < icm_sensors[0].get_num_samples(); k++) {
+        const IMUSample& sample = icm_sensors[0].get_sample(k);
+        float raw[3] = { sample.gyro[0] + offset[0], sample.gyro[1] + offset[1], sample.gyro[2] + offset[2] };
+
+        // any movement restarts the window from this sample
+        bool moved = false;
+        for (int i = 0; i < 3; i++) {
+            if (refine_count > 0 && (max(refine_max[i], raw[i]) - min(refine_min[i], raw[i])) > IMU_STILL_THRESHOLD) moved = true;
+        }
+        if (refine_count == 0 || moved) {
+            refine_count = 0;
+            for (int i = 0; i < 3; i++) refine_sum[i] = 0, refine_min[i] = refine_max[i] = raw[i];
+        }
+
+        for (int i = 0; i < 3; i++) {
+            refine_sum[i] += raw[i];
+            refine_min[i] = min(refine_min[i], raw[i]);
+            refine_max[i] = max(refine_max[i], raw[i]);
+        }
+        refine_count++;
+    }
+    if (refine_count < NUM_IMU_CALIBRATION) return;
+
+    float mean[3];
+    bool changed = false;
+    for (int i = 0; i < 3; i++) {
+        mean[i] = refine_sum[i] / refine_count;
+        if (fabsf(mean[i] - imu_calibration.offset[i]) > IMU_REFINE_STORE_THRESHOLD) changed = true;
+    }
+    icm_sensors[0].set_offsets(mean[0], mean[1], mean[2]);
+    refining_imu_bias = false;
+    start_gyro_bias_tracking();
+
+    // the temperature is from the boot check, reading it now would stall the running burst.
+    // this runs in the control step, so the EEPROM write is left to save_imu_calibration() while the motors are off
+    if (changed) {
+        for (int i = 0; i < 3; i++) imu_calibration.offset[i] = mean[i];
+        imu_calibration_unsaved = true;
+    }
+    LOG_INFO("Refined offsets: %f, %f, %f%s", mean[0], mean[1], mean[2], changed ? " (saved when disabled)" : "");
+}
+
+void EstimatorManager::save_imu_calibration() {
+    if (!imu_calibration_unsaved) return;
+    imu_calibration.store();
+    imu_calibration_unsaved = false;
+    LOG_INFO("Saved refined IMU offsets");
+}
+
+void EstimatorManager::start_gyro_bias_tracking() {
+    float offset[3];
+    icm_sensors[0].get_offsets(offset[0], offset[1], offset[2]);
+    gyro_bias.reset(offset);
+    for (int i = 0; i < config_data->num_sensors[0]; i++) prev_encoder_angle[i] = buff_sensors[i].get_angle();
+    tracking_gyro_bias = true;
+}
+
+void EstimatorManager::track_gyro_bias(float dt) {
+    if (!tracking_gyro_bias || refining_imu_bias || config_data->num_sensors[1] == 0 || dt <= 0) return;
+
+    float motor_speed = 0;
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        int slot = can_data->motor_slot[i];
+        if (slot >= 0 && can_data->is_online(i)) motor_speed = max(motor_speed, fabsf(can_data->velocity[slot]));
+    }
+
+    float encoder_rate = 0;
+    for (int i = 0; i < config_data->num_sensors[0]; i++) {
+        float angle = buff_sensors[i].get_angle();
+        float delta = angle - prev_encoder_angle[i];
+        if (delta > PI) delta -= 2 * PI;
+        if (delta < -PI) delta += 2 * PI;
+        encoder_rate = max(encoder_rate, fabsf(delta) / dt);
+        prev_encoder_angle[i] = angle;
+    }
+    gyro_bias.set_motion(motor_speed, encoder_rate);
+
+    // samples have the current offsets removed, add them back so the filter sees the raw gyro
+    int num_samples = icm_sensors[0].get_num_samples();
+    if (num_samples == 0) return;
+    float offset[3];
+    icm_sensors[0].get_offsets(offset[0], offset[1], offset[2]);
+    for (int k = 0; k < num_samples; k++) {
+        const IMUSample& sample = icm_sensors[0].get_sample(k);
+        float raw[3] = { sample.gyro[0] + offset[0], sample.gyro[1] + offset[1], sample.gyro[2] + offset[2] };
+        gyro_bias.update(raw, sample.accel, dt / num_samples);
+    }
+
+    const float* bias = gyro_bias.get_bias();
+    icm_sensors[0].set_offsets(bias[0], bias[1], bias[2]);
 }
\ No newline at end of file
@@ -4,20 +4,29 @@
 #include "./state.hpp"
 #include "../sensors/dr16.hpp"
 #include "../sensors/ICM20649.hpp"
+#include "../sensors/IMUCalibration.hpp"
 #include "../sensors/IMUSensor.hpp"
 #include "../sensors/LSM6DSOX.hpp"
 #include "../sensors/rev_encoder.hpp"
+#include "../sensors/odom_encoder.hpp"
 #include "../sensors/TOFSensor.hpp"
 #include "../sensors/buff_encoder.hpp"
 #include "../sensors/RefSystem.hpp"
 #include "estimator.hpp"
+#include "../filters/gyro_bias_filter.hpp"
 #include "../comms/rm_can.hpp"
 #include <SPI.h>
 
 // maximum number of each sensor (arbitrary)
 #define NUM_SENSOR_TYPE 16
 
-#define NUM_IMU_CALIBRATION 50000
+#define NUM_IMU_CALIBRATION 2000 // IMU samples averaged for the gyro offsets (~1.8s of FIFO samples)
+#define IMU_CALIBRATION_TIMEOUT_MS 5000 // give up calibrating if the IMU stops producing samples
+#define IMU_VALIDATION_SAMPLES 220 // IMU samples checked against the stored calibration on boot (~0.2s)
+#define IMU_STILL_THRESHOLD 0.05f // max spread (rad/s) of the gyro samples on any axis for the IMU to count as still
+#define IMU_BIAS_TOLERANCE 0.01f // max difference (rad/s) between the measured and stored gyro offsets to keep the stored ones
+#define IMU_CALIBRATION_TEMP_TOLERANCE 10.0f // max temperature change (C) since the stored calibration
+#define IMU_REFINE_STORE_THRESHOLD 0.002f // refined offsets are only written back if they moved this much (rad/s), saves EEPROM wear
 
 
 // Rev encoder pins
@@ -25,6 +34,14 @@
 #define REV_ENC_PIN2 3
 #define REV_ENC_PIN3 4
 
+// Odometry pod quadrature pins (A, B), each pod's PWM pin above is only used to home it.
+// Pins 0/1 are CAN2's, so pod 1 uses the free XBAR pins 5/33. Pod 2 shares 30/31 with CAN3 and is only
+// used while no motor is mapped to CAN3
+#define ODOM_ENC1_PIN_A 5
+#define ODOM_ENC1_PIN_B 33
+#define ODOM_ENC2_PIN_A 30
+#define ODOM_ENC2_PIN_B 31
+
 /// @brief Manage all estimators for macro and micro state
 class EstimatorManager {
 private:
@@ -34,8 +51,12 @@ private:
     ICM20649 icm_sensors[NUM_SENSOR_TYPE];
     /// @brief array to store robot buff encoders
     BuffEncoder buff_sensors[NUM_SENSOR_TYPE];
+    /// @brief reads every buff encoder in one DMA sequence
+    BuffEncoderBatch buff_batch;
     /// @brief array to store robot rev encoders
     RevEncoder rev_sensors[NUM_SENSOR_TYPE];
+    /// @brief quadrature odometry of the first NUM_ODOM_PODS rev encoders
+    OdomEncoder odom_sensors[NUM_ODOM_PODS];
     /// @brief array to store tof sensors
     TOFSensor tof_sensors[NUM_SENSOR_TYPE];
 
@@ -46,6 +67,21 @@ private:
     /// the values inside the matrix tell the estimator stepper which states to write to for each estimator
     int applied_states[NUM_ESTIMATORS][STATE_LEN];
 
+    /// @brief macro rows each macro estimator writes to, prepared in assign_states()
+    MacroStateView macro_views[NUM_ESTIMATORS];
+
+    /// @brief micro rows each micro estimator writes to, prepared in assign_states()
+    MicroStateView micro_views[NUM_ESTIMATORS];
+
+    /// @brief macro output matrix the views point into
+    float (*bound_macro)[3] = nullptr;
+
+    /// @brief micro output matrix the views point into
+    float (*bound_micro)[MICRO_STATE_LEN] = nullptr;
+
+    /// @brief catches writes to rows past an estimator's assigned states
+    float scratch_row[3] = { 0 };
+
     /// @brief can data pointer to pass to each estimator so they can use can to estimate state when needed (usually used for micro state).
     CANData* can_data;
 
@@ -56,6 +92,39 @@ private:
     /// @brief current number of estimators
     int num_estimators = 0;
 
+    /// @brief the chassis estimator if one is configured, its pose variance is sent to the Khadas
+    ChassisEstimator* chassis_estimator = nullptr;
+
+    /// @brief gyro offsets of the first IMU and the temperature they were measured at, stored in EEPROM
+    IMUCalibration imu_calibration;
+
+    /// @brief whether the gyro offsets are still being refined in the background after a short boot check
+    bool refining_imu_bias = false;
+
+    /// @brief whether imu_calibration holds refined offsets that haven't been written to EEPROM yet
+    bool imu_calibration_unsaved = false;
+
+    /// @brief number of still samples in the current refinement window
+    int refine_count = 0;
+
+    /// @brief sum of the raw gyro samples in the current refinement window
+    float refine_sum[3] = { 0 };
+
+    /// @brief smallest raw gyro sample in the current refinement window
+    float refine_min[3] = { 0 };
+
+    /// @brief largest raw gyro sample in the current refinement window
+    float refine_max[3] = { 0 };
+
+    /// @brief online gyro bias of the first IMU, updated whenever the robot is stationary
+    GyroBiasFilter gyro_bias;
+
+    /// @brief whether the online gyro bias is running, it starts once the calibration is done
+    bool tracking_gyro_bias = false;
+
+    /// @brief buff encoder angles from the previous step, for the encoder rates
+    float prev_encoder_angle[NUM_SENSOR_TYPE] = { 0 };
+
 public:
     /// @brief Default constructor, does nothing
     EstimatorManager() = default;
@@ -72,20 +141,67 @@ public:
     /// @param state macro state array pointer to be updated.
     /// @param micro_state micro state array pointer to be updated.
     /// @param override true if we want to override the current state with the new state.
-    void step(float state[STATE_LEN][3], float micro_state[NUM_MOTORS][MICRO_STATE_LEN], int override);
+    /// @param time time of this control step, every estimator gets the same dt.
+    void step(float state[STATE_LEN][3], float micro_state[NUM_MOTORS][MICRO_STATE_LEN], int override, const LoopTime& time);
 
     /// @brief read all sensor arrays besides can and dr16(they are in main).
     void read_sensors();
 
+    /// @brief read the slow sensors (TOFs) that update far below the control rate.
+    /// @note this is run as a scheduler task outside the control step, estimators use the cached values
+    void read_slow_sensors();
+
+    /// @brief Write refined gyro offsets to EEPROM if there are any waiting.
+    /// @note Flash writes and erases run with interrupts off for up to tens of milliseconds, which stalls the control tick
+    /// and the CAN receive interrupt. Only call this while the motors are disabled (safety on)
+    void save_imu_calibration();
+
+    /// @brief Get the online gyro bias of the first IMU
+    /// @return the bias filter, its bias and stationary flag are sent to the Khadas
+    inline const GyroBiasFilter& get_gyro_bias() const { return gyro_bias; }
+
+    /// @brief Get a buff encoder, for its error count and status
+    /// @param index encoder index, as in the config encoder pins
+    /// @return the encoder
+    inline const BuffEncoder& get_buff_encoder(int index) const { return buff_sensors[index]; }
+
+    /// @brief Get the variance of the chassis pose estimate
+    /// @param variance x (m^2), y (m^2) and heading (rad^2) variance, all 0 if no chassis estimator is configured
+    inline void get_chassis_variance(float variance[3]) const {
+        if (chassis_estimator) chassis_estimator->get_pose_variance(variance);
+        else variance[0] = variance[1] = variance[2] = 0;
+    }
+
     /// @brief sets both input arrays to all 0's
     /// @param macro_outputs input 1
     /// @param micro_outputs input 2
     void clear_outputs(float macro_outputs[STATE_LEN][3], float micro_outputs[NUM_MOTORS][MICRO_STATE_LEN]);
 
 private:
-    /// @brief call read for imu's NUM_IMU_CALIBRATION times and then averages returns to calculate offset.
+    /// @brief Set the gyro offsets of the first IMU. A stored calibration is used when a short still window agrees with it
+    /// (and it was measured at a similar temperature), then refined in the background. Otherwise NUM_IMU_CALIBRATION samples
+    /// are averaged right away and stored.
     void calibrate_imus();
 
+    /// @brief Average the gyro samples of the first IMU
+    /// @param count number of samples to average
+    /// @param mean mean of the samples in x, y, z
+    /// @param spread largest minus smallest sample in x, y, z
+    /// @return number of samples averaged, less than count if the IMU timed out
+    int average_imu_samples(int count, float mean[3], float spread[3]);
+
+    /// @brief Add the samples from the last read to the background gyro offset estimate, restarting whenever the IMU moves.
+    /// Once NUM_IMU_CALIBRATION still samples are in, the offsets are applied, and marked to be saved by save_imu_calibration() if they changed
+    void refine_imu_bias();
+
+    /// @brief Start the online gyro bias from the current offsets
+    void start_gyro_bias_tracking();
+
+    /// @brief Feed the IMU samples from the last read to the online gyro bias, along with the fastest motor and
+    /// encoder rates, and apply the bias as the gyro offsets
+    /// @param dt time since the last step (s)
+    void track_gyro_bias(float dt);
+
     /// @brief Populates the corresponding index of the "estimators" array attribute with an estimator object.
     /// @param estimator_id id of estimator to init
     /// @param num_states number of states this estimator should estimate
@@ -94,6 +210,11 @@ private:
     /// @brief sets the assigned states array use for telling which estimators estimate which states
     /// @param as assigned array
     void assign_states(const float as[NUM_ESTIMATORS][STATE_LEN]);
+
+    /// @brief Point every estimator's view at the output matrices, only needed when they move
+    /// @param macro_outputs macro state matrix
+    /// @param micro_outputs micro state matrix
+    void bind_views(float macro_outputs[STATE_LEN][3], float micro_outputs[NUM_MOTORS][MICRO_STATE_LEN]);
 };
 
 
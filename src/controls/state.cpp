@@ -1,112 +1,113 @@
 #include "state.hpp"
+#include "../utils/logger.hpp"
 
 void State::set_reference(float reference[STATE_LEN][3]) {
     memcpy(this->reference, reference, sizeof(this->reference));
-    Serial.println("Don't use this, bitch 'one time is ok :)'");
+    clear_inactive_reference();
+    LOG_WARN("Don't use this, bitch 'one time is ok :)'");
 }
 
 void State::get_reference(float reference[STATE_LEN][3]) {
     memcpy(reference, this->reference, sizeof(this->reference));
 }
 
-void State::step_reference(float ungoverned_reference[STATE_LEN][3], const float governor_type[STATE_LEN]) {
+void State::step_reference(float ungoverned_reference[STATE_LEN][3], const float governor_type[STATE_LEN], const LoopTime& time) {
     float threshold = 0.0005;
-    float dt = governor_timer.delta();
+    float dt = time.dt;
     if (count == 0){
         dt = 0; // first dt loop generates huge time so check for that
         count++;    
     }
-    for (int n = 0; n < STATE_LEN; n++) {
-        bool is_wrap = (((int)(reference_limits[n][0][1] * 100) == 314) && ((int)(reference_limits[n][0][0] * 100) == -314));
+    for (int i = 0; i < num_governed; i++) {
+        const GovernorEntry& entry = governor_plan[i];
+        int n = entry.n;
+        float* target = ungoverned_reference[n];
+        float* ref = reference[n];
+
         // Keep new target values within absolute limits
-        if (is_wrap) {
-            while (ungoverned_reference[n][0] >= PI) ungoverned_reference[n][0] -= 2 * PI;
-            while (ungoverned_reference[n][0] <= -PI) ungoverned_reference[n][0] += 2 * PI;
-            for (int p = 1; p < 3; p++) {
-                if (ungoverned_reference[n][p] < reference_limits[n][p][0]) ungoverned_reference[n][p] = reference_limits[n][p][0];
-                if (ungoverned_reference[n][p] > reference_limits[n][p][1]) ungoverned_reference[n][p] = reference_limits[n][p][1];
-            }
+        if (entry.wrap) {
+            while (target[0] >= PI) target[0] -= 2 * PI;
+            while (target[0] <= -PI) target[0] += 2 * PI;
         } else {
-            for (int p = 0; p < 3; p++) {
-                if (ungoverned_reference[n][p] < reference_limits[n][p][0]) ungoverned_reference[n][p] = reference_limits[n][p][0];
-                if (ungoverned_reference[n][p] > reference_limits[n][p][1]) ungoverned_reference[n][p] = reference_limits[n][p][1];
-            }
+            if (target[0] < entry.low[0]) target[0] = entry.low[0];
+            if (target[0] > entry.high[0]) target[0] = entry.high[0];
+        }
+        for (int p = 1; p < 3; p++) {
+            if (target[p] < entry.low[p]) target[p] = entry.low[p];
+            if (target[p] > entry.high[p]) target[p] = entry.high[p];
         }
 
         if ((int) governor_type[n] == 1) { // position based governor
-            float pos_error = ungoverned_reference[n][0] - reference[n][0];
-            if (pos_error > PI && is_wrap) pos_error -= 2 * PI;
-            if (pos_error < -PI && is_wrap) pos_error += 2 * PI;
-            float vel_error = ungoverned_reference[n][1] - reference[n][1];
+            float pos_error = target[0] - ref[0];
+            if (pos_error > PI && entry.wrap) pos_error -= 2 * PI;
+            if (pos_error < -PI && entry.wrap) pos_error += 2 * PI;
+            float vel_error = target[1] - ref[1];
             // Set the accel refrence to the max or min based on which direction it needs to go
-            if (pos_error > threshold) reference[n][2] = reference_limits[n][2][1];
-            else if (pos_error < -threshold) reference[n][2] = reference_limits[n][2][0];
+            if (pos_error > threshold) ref[2] = entry.high[2];
+            else if (pos_error < -threshold) ref[2] = entry.low[2];
             else {
-                reference[n][2] = 0;
-                reference[n][1] = ungoverned_reference[n][1];
+                ref[2] = 0;
+                ref[1] = target[1];
             }
 
-            if (reference[n][2] != 0) {
+            if (ref[2] != 0) {
+                // squares are taken in double, same as pow() did, so the braking decision doesn't move
+                double vel_sq_diff = (double)target[1] * target[1] - (double)ref[1] * ref[1];
                 if (pos_error > 0) {
                     // check how far it will travel when braking
-                    float dist_to_deccel = (pow(ungoverned_reference[n][1], 2) - pow(reference[n][1], 2)) / (2 * (reference_limits[n][2][0]));
+                    float dist_to_deccel = vel_sq_diff / entry.two_accel_low;
 
                     // if the minimum stopping distance is greater than the remaining distance start braking
                     if (dist_to_deccel > pos_error) {
-                        if (vel_error > 0) reference[n][2] = reference_limits[n][2][1];
-                        else reference[n][2] = reference_limits[n][2][0];
+                        if (vel_error > 0) ref[2] = entry.high[2];
+                        else ref[2] = entry.low[2];
                     }
                 } else {
                     // check how far it will travel when braking
-                    float dist_to_deccel = (pow(ungoverned_reference[n][1], 2) - pow(reference[n][1], 2)) / (2 * (reference_limits[n][2][1]));
+                    float dist_to_deccel = vel_sq_diff / entry.two_accel_high;
 
                     // if the minimum stopping distance is greater than the remaining distance start braking
                     if (dist_to_deccel < pos_error) {
-                        if (vel_error > 0) reference[n][2] = reference_limits[n][2][1];
-                        else reference[n][2] = reference_limits[n][2][0];
+                        if (vel_error > 0) ref[2] = entry.high[2];
+                        else ref[2] = entry.low[2];
                     }
                 }
             }
 
             // step the references by higher order reference
-            reference[n][1] += reference[n][2] * dt;
-            reference[n][0] += reference[n][1] * dt;
+            ref[1] += ref[2] * dt;
+            ref[0] += ref[1] * dt;
 
         } else if ((int) governor_type[n] == 2) { // velocity based governor
-            float vel_error = ungoverned_reference[n][1] - reference[n][1];
+            float vel_error = target[1] - ref[1];
             // check which direction the target is and set acceleration
             // if the velocity error is less the max acceleration 
-            if (vel_error > (reference_limits[n][2][1] * dt)) {
-                if (vel_error * reference[n][1] > 0) reference[n][2] = reference_limits[n][2][1];
-                else reference[n][2] = reference_limits[n][2][1];
-            } else if (vel_error < (reference_limits[n][2][0] * dt)) {
-                if (vel_error * reference[n][1] > 0) reference[n][2] = reference_limits[n][2][0];
-                else reference[n][2] = reference_limits[n][2][0];
-            } else {
-                reference[n][1] = ungoverned_reference[n][1];
-                reference[n][2] = 0;
+            if (vel_error > (entry.high[2] * dt)) ref[2] = entry.high[2];
+            else if (vel_error < (entry.low[2] * dt)) ref[2] = entry.low[2];
+            else {
+                ref[1] = target[1];
+                ref[2] = 0;
             }
             // step the reference by the higher order reference
-            reference[n][1] += reference[n][2] * dt;
+            ref[1] += ref[2] * dt;
 
         } else { // no governor (set the reference equal to the target)
-            reference[n][2] = ungoverned_reference[n][2];
-            reference[n][1] = ungoverned_reference[n][1];
-            reference[n][0] = ungoverned_reference[n][0];
+            ref[2] = target[2];
+            ref[1] = target[1];
+            ref[0] = target[0];
         }
-        if (is_wrap) {
-            while (reference[n][0] >= PI) reference[n][0] -= 2 * PI;
-            while (reference[n][0] <= -PI) reference[n][0] += 2 * PI;
-            for (int p = 1; p < 3; p++) {
-                if (reference[n][p] < reference_limits[n][p][0]) reference[n][p] = reference_limits[n][p][0];
-                if (reference[n][p] > reference_limits[n][p][1]) reference[n][p] = reference_limits[n][p][1];
-            }
+
+        // Keep values within absolute limits
+        if (entry.wrap) {
+            while (ref[0] >= PI) ref[0] -= 2 * PI;
+            while (ref[0] <= -PI) ref[0] += 2 * PI;
         } else {
-            for (int p = 0; p < 3; p++) {
-                // Keep values within absolute limits
-                if (reference[n][p] < reference_limits[n][p][0]) reference[n][p] = reference_limits[n][p][0];
-                if (reference[n][p] > reference_limits[n][p][1]) reference[n][p] = reference_limits[n][p][1];
-            }
+            if (ref[0] < entry.low[0]) ref[0] = entry.low[0];
+            if (ref[0] > entry.high[0]) ref[0] = entry.high[0];
+        }
+        for (int p = 1; p < 3; p++) {
+            if (ref[p] < entry.low[p]) ref[p] = entry.low[p];
+            if (ref[p] > entry.high[p]) ref[p] = entry.high[p];
         }
     }
 }
@@ -136,4 +137,37 @@ void State::set_reference_limits(const float reference_limits[STATE_LEN][3][2])
             this->reference_limits[n][p][1] = reference_limits[n][p][1];
         }
     }
+
+    // compile the governor plan, states with all zero limits are always clamped to zero so they're left out
+    num_governed = 0;
+    for (int n = 0; n < STATE_LEN; n++) {
+        wrap[n] = (((int)(reference_limits[n][0][1] * 100) == 314) && ((int)(reference_limits[n][0][0] * 100) == -314));
+
+        bool active = false;
+        for (int p = 0; p < 3; p++) {
+            if (reference_limits[n][p][0] != 0 || reference_limits[n][p][1] != 0) active = true;
+        }
+        governed[n] = active;
+        if (!active) continue;
+
+        GovernorEntry& entry = governor_plan[num_governed++];
+        entry.n = n;
+        entry.wrap = wrap[n];
+        for (int p = 0; p < 3; p++) {
+            entry.low[p] = reference_limits[n][p][0];
+            entry.high[p] = reference_limits[n][p][1];
+        }
+        entry.two_accel_low = 2 * entry.low[2];
+        entry.two_accel_high = 2 * entry.high[2];
+    }
+    clear_inactive_reference();
+}
+
+void State::clear_inactive_reference() {
+    for (int n = 0; n < STATE_LEN; n++) {
+        if (governed[n]) continue;
+        reference[n][0] = 0;
+        reference[n][1] = 0;
+        reference[n][2] = 0;
+    }
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#include "../utils/timing.hpp"
+#include "../utils/control_tick.hpp"
 
 #ifndef STATE_H
 #define STATE_H
@@ -11,6 +11,22 @@
 
 #define NUM_ESTIMATORS 16
 
+/// @brief Reference governor settings of one state, compiled from the reference limits
+struct GovernorEntry {
+    /// @brief state index
+    uint8_t n;
+    /// @brief whether the position wraps at +-pi (limits of +-3.14)
+    bool wrap;
+    /// @brief low bound of position, velocity and acceleration
+    float low[3];
+    /// @brief high bound of position, velocity and acceleration
+    float high[3];
+    /// @brief twice the low acceleration bound, the braking denominator when moving in the positive direction
+    float two_accel_low;
+    /// @brief twice the high acceleration bound, the braking denominator when moving in the negative direction
+    float two_accel_high;
+};
+
 /// @brief Use state estimate and ungoverned reference to generated governed references to be sent to controllers.
 class State {
 private:
@@ -30,12 +46,24 @@ private:
     /// @brief where [n][m][0] is the low bound and [n][m][1] is the high bound.
     float reference_limits[STATE_LEN][3][2];
 
-    /// @brief Timer for the reference governor
-    Timer governor_timer;
-
     /// @brief counter so dt isnt big in the first loop
     int count = 0;
 
+    /// @brief governor settings of every active state (a state with any non-zero limit)
+    GovernorEntry governor_plan[STATE_LEN];
+
+    /// @brief number of active states in governor_plan
+    int num_governed = 0;
+
+    /// @brief whether each state is in governor_plan
+    bool governed[STATE_LEN] = { false };
+
+    /// @brief whether the position of each state wraps at +-pi (limits of +-3.14)
+    bool wrap[STATE_LEN] = { false };
+
+    /// @brief Zero the reference of every inactive state, which is where their all zero limits would clamp it
+    void clear_inactive_reference();
+
 public:
     /// @brief Only use one time!!!!!! Use step reference
     /// @param reference start reference at the beginning(should equal current estimate)
@@ -46,9 +74,11 @@ public:
     void get_reference(float reference[STATE_LEN][3]);
 
     /// @brief Steps the reference matrix towards a goal, applying a reference governor to prevent impossible motion
+    /// @note Only the active states from set_reference_limits() are stepped, the rows of inactive states in ungoverned_reference are left untouched
     /// @param ungoverned_reference The desired robot state to step towards in the form of a matrix; Must be of shape [STATE_LEN][3]
     /// @param governor_type position based governor (1) or velocity based governor (2)
-    void step_reference(float ungoverned_reference[STATE_LEN][3], const float governor_type[STATE_LEN]);
+    /// @param time time of this control step
+    void step_reference(float ungoverned_reference[STATE_LEN][3], const float governor_type[STATE_LEN], const LoopTime& time);
 
     /// @brief Gives the instantaneous state estimate matrix
     /// @param estimate The array to override with the estimate matrix; Must be of shape [STATE_LEN][3]
@@ -64,9 +94,13 @@ public:
     /// @param col The column of the matrix in which to write to; Corresponds to the derivative order
     void set_estimate_at_location(float estimate, int row, int col);
 
-    /// @brief Sets the reference limits matrix which is used by the reference governor
+    /// @brief Sets the reference limits matrix which is used by the reference governor, and compiles the governor plan from it
     /// @param reference_limits Reference limits, in the form of a 3D tensor; Must be of shape [STATE_LEN][3][2]
     void set_reference_limits(const float reference_limits[STATE_LEN][3][2]);
+
+    /// @brief Get which states wrap at +-pi, as compiled by set_reference_limits()
+    /// @return array of STATE_LEN flags, true if the position of that state wraps
+    inline const bool* get_wrap() const { return wrap; }
 };
 
 #endif
\ No newline at end of file
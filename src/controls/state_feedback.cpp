@@ -0,0 +1,93 @@
+#include "state_feedback.hpp"
+#include "../utils/logger.hpp"
+
+// CMSIS-DSP on the Teensy, a plain loop everywhere else (host builds)
+#if defined(__IMXRT1062__)
+#include <arm_math.h>
+#endif
+
+void StateFeedbackBank::clear() {
+    num_rows = 0;
+    num_states = 0;
+    memset(gain_p, 0, sizeof(gain_p));
+    memset(gain_v, 0, sizeof(gain_v));
+}
+
+int StateFeedbackBank::find_state(int state_index, bool wrap_state) {
+    for (int s = 0; s < num_states; s++) {
+        if (state[s] == state_index) return s;
+    }
+    if (num_states >= STATE_FEEDBACK_MAX_STATES) return -1;
+
+    state[num_states] = state_index;
+    wrap[num_states] = wrap_state;
+    return num_states++;
+}
+
+int StateFeedbackBank::add_motor(int motor, const float gains[NUM_GAINS], const uint8_t* states, int count, const bool wrap_states[STATE_LEN]) {
+    if (num_rows >= NUM_MOTORS) return -1;
+    int row = num_rows++;
+    this->motor[row] = motor;
+
+    if (count > STATE_FEEDBACK_STATES_PER_MOTOR) {
+        LOG_WARN("State feedback: motor %d couples to %d states, only the first %d are used", motor, count, STATE_FEEDBACK_STATES_PER_MOTOR);
+        count = STATE_FEEDBACK_STATES_PER_MOTOR;
+    }
+
+    for (int k = 0; k < count; k++) {
+        int s = find_state(states[k], wrap_states[states[k]]);
+        if (s < 0) {
+            LOG_WARN("State feedback: more than %d states in use, state %d is ignored", STATE_FEEDBACK_MAX_STATES, states[k]);
+            continue;
+        }
+        gain_p[row][s] = gains[k];
+        gain_v[row][s] = gains[STATE_FEEDBACK_STATES_PER_MOTOR + k];
+    }
+    return row;
+}
+
+void StateFeedbackBank::step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN]) {
+    if (num_rows == 0) return;
+    int cols = 2 * num_states;
+
+    // stacked error vector, position errors take the short way around for wrapping states
+    for (int s = 0; s < num_states; s++) {
+        int n = state[s];
+        float pos_error = macro_reference[n][0] - macro_estimate[n][0];
+        if (wrap[s]) {
+            if (pos_error > PI) pos_error -= 2 * PI;
+            if (pos_error < -PI) pos_error += 2 * PI;
+        }
+        error[s] = pos_error;
+        error[num_states + s] = macro_reference[n][1] - macro_estimate[n][1];
+    }
+
+    // scale the gains by the kinematics so rotating chassis kinematics are followed every tick
+    for (int r = 0; r < num_rows; r++) {
+        float* row = &K[r * cols];
+        int m = motor[r];
+        for (int s = 0; s < num_states; s++) {
+            row[s] = gain_p[r][s] * kinematics_p[m][state[s]];
+            row[num_states + s] = gain_v[r][s] * kinematics_v[m][state[s]];
+        }
+    }
+
+    // u = K e
+#if defined(__IMXRT1062__)
+    arm_matrix_instance_f32 K_mat;
+    arm_matrix_instance_f32 e_mat;
+    arm_matrix_instance_f32 u_mat;
+    arm_mat_init_f32(&K_mat, num_rows, cols, K);
+    arm_mat_init_f32(&e_mat, cols, 1, error);
+    arm_mat_init_f32(&u_mat, num_rows, 1, output);
+    arm_mat_mult_f32(&K_mat, &e_mat, &u_mat);
+#else
+    for (int r = 0; r < num_rows; r++) {
+        float sum = 0;
+        for (int c = 0; c < cols; c++) sum += K[r * cols + c] * error[c];
+        output[r] = sum;
+    }
+#endif
+
+    for (int r = 0; r < num_rows; r++) output[r] = constrain(output[r], -1.0f, 1.0f);
+}
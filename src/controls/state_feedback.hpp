@@ -0,0 +1,75 @@
+#ifndef STATE_FEEDBACK_H
+#define STATE_FEEDBACK_H
+
+#include "state.hpp"
+#include "../comms/rm_can.hpp"
+#include "controller.hpp"
+
+#define STATE_FEEDBACK_MAX_STATES 8                           // max number of distinct states across every motor in the bank
+#define STATE_FEEDBACK_STATES_PER_MOTOR (NUM_GAINS / 2)       // position and velocity gain per state, from one gains row
+
+/// @brief Full state feedback (LQR style) for every motor using controller type 8.
+/// Each motor's output is one row of u = K e, where e stacks the position and velocity errors of every coupled state
+/// and K is the config gain matrix scaled by the current kinematics. The product runs through arm_mat_mult_f32 on the Teensy.
+class StateFeedbackBank {
+public:
+    /// @brief default constructor, the bank starts empty
+    StateFeedbackBank() = default;
+
+    /// @brief Remove every motor
+    void clear();
+
+    /// @brief Add a motor to the bank
+    /// @param motor motor index
+    /// @param gains gains row of the motor: position gains of its states in 0-5, velocity gains in 6-11
+    /// @param states state indices the motor couples to (the states with a kinematics entry), in order
+    /// @param count number of states, only the first STATE_FEEDBACK_STATES_PER_MOTOR are used
+    /// @param wrap_states whether the position error of each state (indexed by state) wraps at 2*pi
+    /// @return row of the motor in the bank, or -1 if the bank is full
+    int add_motor(int motor, const float gains[NUM_GAINS], const uint8_t* states, int count, const bool wrap_states[STATE_LEN]);
+
+    /// @brief Compute the output of every motor in the bank
+    /// @param macro_reference State reference (governed target state)
+    /// @param macro_estimate estimated current joint states
+    /// @param kinematics_p position kinematics matrix, read every step since some entries change at runtime
+    /// @param kinematics_v velocity kinematics matrix, read every step since some entries change at runtime
+    void step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN]);
+
+    /// @brief Get the number of motors in the bank
+    /// @return number of motors
+    inline int get_num_rows() const { return num_rows; }
+
+    /// @brief output of each row from the last step(), bounded from -1 to 1
+    float output[NUM_MOTORS] = { 0 };
+
+private:
+    /// @brief motor index of each row
+    uint8_t motor[NUM_MOTORS] = { 0 };
+    /// @brief configured position gain of each row for each bank state
+    float gain_p[NUM_MOTORS][STATE_FEEDBACK_MAX_STATES] = { { 0 } };
+    /// @brief configured velocity gain of each row for each bank state
+    float gain_v[NUM_MOTORS][STATE_FEEDBACK_MAX_STATES] = { { 0 } };
+
+    /// @brief state index of each bank state
+    uint8_t state[STATE_FEEDBACK_MAX_STATES] = { 0 };
+    /// @brief whether the position error of each bank state wraps at 2*pi
+    bool wrap[STATE_FEEDBACK_MAX_STATES] = { false };
+
+    /// @brief effective gain matrix (rows x 2 * states), row major: position columns then velocity columns
+    float K[NUM_MOTORS * 2 * STATE_FEEDBACK_MAX_STATES] = { 0 };
+    /// @brief error vector (2 * states): position errors then velocity errors
+    float error[2 * STATE_FEEDBACK_MAX_STATES] = { 0 };
+
+    /// @brief number of motors in the bank
+    int num_rows = 0;
+    /// @brief number of distinct states in the bank
+    int num_states = 0;
+
+    /// @brief Find or add a bank state
+    /// @param state_index state index
+    /// @param wrap_state whether its position error wraps
+    /// @return bank state, or -1 if there's no room
+    int find_state(int state_index, bool wrap_state);
+};
+
+#endif // STATE_FEEDBACK_H
@@ -0,0 +1,60 @@
+#include "state_history.hpp"
+
+void StateHistory::clear() {
+    head = 0;
+    count = 0;
+}
+
+void StateHistory::set_wrap(const bool wrap_states[STATE_LEN]) {
+    memcpy(wrap, wrap_states, sizeof(wrap));
+}
+
+void StateHistory::record(uint32_t time_us, uint16_t packet_id, const float estimate[STATE_LEN][3], const float reference[STATE_LEN][3]) {
+    StateSnapshot& snapshot = snapshots[head];
+    snapshot.time_us = time_us;
+    snapshot.packet_id = packet_id;
+    memcpy(snapshot.estimate, estimate, sizeof(snapshot.estimate));
+    memcpy(snapshot.reference, reference, sizeof(snapshot.reference));
+
+    head = (head + 1) % STATE_HISTORY_LEN;
+    if (count < STATE_HISTORY_LEN) count++;
+}
+
+const StateSnapshot* StateHistory::find_packet(uint16_t packet_id) const {
+    for (int age = 0; age < count; age++) {
+        const StateSnapshot& snapshot = at_age(age);
+        if (snapshot.packet_id == packet_id) return &snapshot;
+    }
+    return nullptr;
+}
+
+const StateSnapshot* StateHistory::find_time(uint32_t time_us) const {
+    if (count == 0) return nullptr;
+    // compare ages rather than raw times so micros() rolling over doesn't break the search
+    uint32_t newest = at_age(0).time_us;
+    uint32_t wanted_age = newest - time_us;
+    if ((int32_t)wanted_age < 0) return &at_age(0);
+
+    for (int age = 0; age < count; age++) {
+        const StateSnapshot& snapshot = at_age(age);
+        if (newest - snapshot.time_us >= wanted_age) return &snapshot;
+    }
+    return nullptr;
+}
+
+const StateSnapshot* StateHistory::latest() const {
+    if (count == 0) return nullptr;
+    return &at_age(0);
+}
+
+void StateHistory::repropagate(const StateSnapshot* past, const float measured[STATE_LEN][3], float current[STATE_LEN][3]) const {
+    for (int n = 0; n < STATE_LEN; n++) {
+        for (int p = 0; p < 3; p++) {
+            current[n][p] += measured[n][p] - past->estimate[n][p];
+        }
+        if (wrap[n]) {
+            while (current[n][0] >= PI) current[n][0] -= 2 * PI;
+            while (current[n][0] < -PI) current[n][0] += 2 * PI;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef STATE_HISTORY_H
+#define STATE_HISTORY_H
+
+#include "state.hpp"
+
+#define STATE_HISTORY_LEN 64 // number of control steps kept, 64ms at 1kHz
+
+/// @brief Estimate and reference of one control step
+struct StateSnapshot {
+    /// @brief Time (us) the step began
+    uint32_t time_us = 0;
+    /// @brief ID of the Teensy packet that sent this estimate
+    uint16_t packet_id = 0;
+    /// @brief State estimate at the end of the step
+    float estimate[STATE_LEN][3] = { { 0 } };
+    /// @brief Governed reference at the end of the step
+    float reference[STATE_LEN][3] = { { 0 } };
+};
+
+/// @brief Ring buffer of past state estimates and references, keyed by loop time and outgoing packet ID.
+/// Measurements that describe the robot some time ago (hive overrides, vision) are applied at the step they were taken in,
+/// and the current estimate is re-propagated from there by the motion the estimators measured since
+/// @note Only depends on state.hpp and Arduino.h, so it is built and unit tested on the host (see test/test_state_history.cpp)
+class StateHistory {
+public:
+    /// @brief default constructor, the history starts empty
+    StateHistory() = default;
+
+    /// @brief Remove every snapshot
+    void clear();
+
+    /// @brief Set which states wrap at +-pi
+    /// @param wrap_states STATE_LEN flags, true if the position of that state wraps (see State::get_wrap())
+    void set_wrap(const bool wrap_states[STATE_LEN]);
+
+    /// @brief Record the result of a control step, overwriting the oldest snapshot when full
+    /// @param time_us time (us) the step began
+    /// @param packet_id ID of the Teensy packet the estimate is sent in
+    /// @param estimate state estimate
+    /// @param reference governed reference
+    void record(uint32_t time_us, uint16_t packet_id, const float estimate[STATE_LEN][3], const float reference[STATE_LEN][3]);
+
+    /// @brief Find the snapshot sent in a packet
+    /// @param packet_id Teensy packet ID
+    /// @return the snapshot, or nullptr if it's not in the history (too old or never sent)
+    const StateSnapshot* find_packet(uint16_t packet_id) const;
+
+    /// @brief Find the latest snapshot taken at or before a time
+    /// @param time_us time (us)
+    /// @return the snapshot, or nullptr if the time is older than the history
+    const StateSnapshot* find_time(uint32_t time_us) const;
+
+    /// @brief Get the most recent snapshot
+    /// @return the snapshot, or nullptr if the history is empty
+    const StateSnapshot* latest() const;
+
+    /// @brief Apply a measurement of a past step to the current estimate.
+    /// The correction (measured - past estimate) is added to the current estimate, which re-propagates the measurement
+    /// by the motion the estimators have integrated since
+    /// @param past snapshot of the step the measurement describes
+    /// @param measured measured state at that step
+    /// @param current current estimate, corrected in place
+    void repropagate(const StateSnapshot* past, const float measured[STATE_LEN][3], float current[STATE_LEN][3]) const;
+
+    /// @brief Get the number of snapshots held
+    /// @return number of snapshots
+    inline int size() const { return count; }
+
+private:
+    /// @brief snapshots, oldest overwritten first
+    StateSnapshot snapshots[STATE_HISTORY_LEN];
+    /// @brief index the next snapshot is written to
+    int head = 0;
+    /// @brief number of snapshots held
+    int count = 0;
+    /// @brief whether the position of each state wraps at +-pi
+    bool wrap[STATE_LEN] = { false };
+
+    /// @brief Get a snapshot by age
+    /// @param age 0 for the newest, count - 1 for the oldest
+    /// @return the snapshot
+    inline const StateSnapshot& at_age(int age) const { return snapshots[(head - 1 - age + STATE_HISTORY_LEN) % STATE_HISTORY_LEN]; }
+};
+
+#endif // STATE_HISTORY_H
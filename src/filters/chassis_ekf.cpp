@@ -0,0 +1,110 @@
+#include "chassis_ekf.hpp"
+
+void ChassisEKF::reset(float x, float y, float psi) {
+    for (int i = 0; i < CHASSIS_EKF_STATES; i++) {
+        state[i] = 0;
+        for (int j = 0; j < CHASSIS_EKF_STATES; j++) P[i][j] = (i == j) ? CHASSIS_EKF_INITIAL_VARIANCE : 0;
+    }
+    set_pose(x, y, psi);
+}
+
+void ChassisEKF::set_pose(float x, float y, float psi) {
+    state[0] = x;
+    state[1] = y;
+    state[2] = psi;
+}
+
+void ChassisEKF::predict(float dt) {
+    if (dt <= 0) return;
+
+    float c = cosf(state[2]);
+    float s = sinf(state[2]);
+    float vx = state[3];
+    float vy = state[4];
+
+    // F = I except for the pose rows, which depend on psi and the velocity
+    float F[3][CHASSIS_EKF_STATES] = {
+        { 1, 0, (-vx * s - vy * c) * dt, c * dt, -s * dt, 0 },
+        { 0, 1, (vx * c - vy * s) * dt, s * dt, c * dt, 0 },
+        { 0, 0, 1, 0, 0, dt },
+    };
+
+    state[0] += (vx * c - vy * s) * dt;
+    state[1] += (vx * s + vy * c) * dt;
+    state[2] += state[5] * dt;
+    if (state[2] >= (float)M_PI) state[2] -= 2 * (float)M_PI;
+    if (state[2] < -(float)M_PI) state[2] += 2 * (float)M_PI;
+
+    // FP, only the first 3 rows change
+    float FP[3][CHASSIS_EKF_STATES];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < CHASSIS_EKF_STATES; j++) {
+            float sum = 0;
+            for (int k = 0; k < CHASSIS_EKF_STATES; k++) sum += F[i][k] * P[k][j];
+            FP[i][j] = sum;
+        }
+    }
+
+    // P = FPF' + Q, the velocity block is unchanged by F
+    float pose[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            float sum = 0;
+            for (int k = 0; k < CHASSIS_EKF_STATES; k++) sum += FP[i][k] * F[j][k];
+            pose[i][j] = sum;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) P[i][j] = 0.5f * (pose[i][j] + pose[j][i]);
+        for (int j = 3; j < CHASSIS_EKF_STATES; j++) {
+            P[i][j] = FP[i][j];
+            P[j][i] = FP[i][j];
+        }
+    }
+
+    P[3][3] += CHASSIS_EKF_ACCEL_NOISE * dt;
+    P[4][4] += CHASSIS_EKF_ACCEL_NOISE * dt;
+    P[5][5] += CHASSIS_EKF_YAW_ACCEL_NOISE * dt;
+}
+
+bool ChassisEKF::update_velocity(const float h[3], float z, float r, float gate) {
+    // PH' only needs the velocity columns
+    float PH[CHASSIS_EKF_STATES];
+    for (int i = 0; i < CHASSIS_EKF_STATES; i++) PH[i] = P[i][3] * h[0] + P[i][4] * h[1] + P[i][5] * h[2];
+
+    float S = h[0] * PH[3] + h[1] * PH[4] + h[2] * PH[5] + r;
+    float innovation = z - (h[0] * state[3] + h[1] * state[4] + h[2] * state[5]);
+    if (gate > 0 && innovation * innovation > gate * S) return false;
+
+    float inv_S = 1.0f / S;
+    for (int i = 0; i < CHASSIS_EKF_STATES; i++) state[i] += PH[i] * inv_S * innovation;
+
+    // P -= K H P = PH PH' / S, symmetric by construction
+    for (int i = 0; i < CHASSIS_EKF_STATES; i++) {
+        float k = PH[i] * inv_S;
+        for (int j = 0; j < CHASSIS_EKF_STATES; j++) P[i][j] -= k * PH[j];
+    }
+    return true;
+}
+
+void ChassisEKF::update_yaw_rate(float omega) {
+    const float h[3] = { 0, 0, 1 };
+    update_velocity(h, omega, CHASSIS_EKF_YAW_RATE_NOISE, 0);
+}
+
+void ChassisEKF::update_pod(float dir_x, float dir_y, float lever, float speed) {
+    const float h[3] = { dir_x, dir_y, lever };
+    update_velocity(h, speed, CHASSIS_EKF_POD_NOISE, 0);
+}
+
+bool ChassisEKF::update_wheel(float hx, float hy, float hw, float speed) {
+    const float h[3] = { hx, hy, hw };
+    return update_velocity(h, speed, CHASSIS_EKF_WHEEL_NOISE, CHASSIS_EKF_WHEEL_GATE);
+}
+
+void ChassisEKF::get_world_velocity(float& vx, float& vy) const {
+    float c = cosf(state[2]);
+    float s = sinf(state[2]);
+    vx = state[3] * c - state[4] * s;
+    vy = state[3] * s + state[4] * c;
+}
@@ -0,0 +1,92 @@
+#include <math.h>
+#include <stdint.h>
+
+#ifndef CHASSIS_EKF_H
+#define CHASSIS_EKF_H
+
+#define CHASSIS_EKF_STATES 6                // x, y, psi (world), vx, vy (chassis frame), omega
+#define CHASSIS_EKF_ACCEL_NOISE 20.0f       // chassis acceleration noise density ((m/s^2)^2 s)
+#define CHASSIS_EKF_YAW_ACCEL_NOISE 50.0f   // chassis yaw acceleration noise density ((rad/s^2)^2 s)
+#define CHASSIS_EKF_YAW_RATE_NOISE 4e-4f    // gyro yaw rate measurement variance ((rad/s)^2)
+#define CHASSIS_EKF_POD_NOISE 1e-4f         // odometry pod speed measurement variance ((m/s)^2)
+#define CHASSIS_EKF_WHEEL_NOISE 4e-2f       // wheel speed measurement variance ((m/s)^2), they slip so they're trusted less
+#define CHASSIS_EKF_WHEEL_GATE 9.0f         // wheel readings whose squared innovation is over this many variances are taken as slip
+#define CHASSIS_EKF_INITIAL_VARIANCE 1e-4f  // variance of every state after reset()
+
+/// @brief Extended Kalman filter for the chassis pose and velocity.
+/// The state is the world pose (x, y, psi) and the chassis frame velocity (vx, vy, omega), so every measurement
+/// (odometry pod speeds, wheel speeds, gyro yaw rate) is a linear function of the velocity and the only nonlinearity
+/// is rotating the velocity into the world in predict(). Measurements are applied one at a time as scalar updates,
+/// so there's no matrix inverse and the cost of a step is fixed by the number of measurements.
+/// @note Only uses plain floats (no hardware), so it can be run on the host against a simulated chassis
+class ChassisEKF {
+public:
+    /// @brief default constructor, starts at the origin
+    ChassisEKF() { reset(0, 0, 0); }
+
+    /// @brief Start over at rest
+    /// @param x x position (m)
+    /// @param y y position (m)
+    /// @param psi heading (rad)
+    void reset(float x, float y, float psi);
+
+    /// @brief Move the pose without touching the velocity, for overrides
+    /// @param x x position (m)
+    /// @param y y position (m)
+    /// @param psi heading (rad)
+    void set_pose(float x, float y, float psi);
+
+    /// @brief Propagate the state and covariance
+    /// @param dt time step (s)
+    void predict(float dt);
+
+    /// @brief Fuse a measured chassis yaw rate
+    /// @param omega yaw rate (rad/s)
+    void update_yaw_rate(float omega);
+
+    /// @brief Fuse the speed of an odometry pod wheel
+    /// @param dir_x x of the pod's rolling direction in the chassis frame
+    /// @param dir_y y of the pod's rolling direction in the chassis frame
+    /// @param lever speed the pod measures per rad/s of chassis rotation (m)
+    /// @param speed measured speed (m/s)
+    void update_pod(float dir_x, float dir_y, float lever, float speed);
+
+    /// @brief Fuse the surface speed of a drive wheel, readings that disagree too much are dropped as slip
+    /// @param hx surface speed per m/s of chassis vx
+    /// @param hy surface speed per m/s of chassis vy
+    /// @param hw surface speed per rad/s of chassis rotation (m)
+    /// @param speed measured surface speed (m/s)
+    /// @return false if the reading was dropped
+    bool update_wheel(float hx, float hy, float hw, float speed);
+
+    /// @brief Get the state
+    /// @return x, y, psi, vx, vy, omega
+    inline const float* get_state() const { return state; }
+
+    /// @brief Get the velocity in the world frame
+    /// @param vx x velocity (m/s)
+    /// @param vy y velocity (m/s)
+    void get_world_velocity(float& vx, float& vy) const;
+
+    /// @brief Get the covariance between two states
+    /// @param i state index
+    /// @param j state index
+    /// @return covariance
+    inline float get_covariance(int i, int j) const { return P[i][j]; }
+
+private:
+    /// @brief x, y, psi, vx, vy, omega
+    float state[CHASSIS_EKF_STATES] = { 0 };
+    /// @brief state covariance
+    float P[CHASSIS_EKF_STATES][CHASSIS_EKF_STATES] = { { 0 } };
+
+    /// @brief Scalar update with a measurement of the velocity states
+    /// @param h measurement row for vx, vy, omega (the pose columns are 0)
+    /// @param z measurement
+    /// @param r measurement variance
+    /// @param gate squared innovation limit in variances, 0 for none
+    /// @return false if the measurement was gated out
+    bool update_velocity(const float h[3], float z, float r, float gate);
+};
+
+#endif // CHASSIS_EKF_H
@@ -0,0 +1,22 @@
+#include "gimbal_geometry.hpp"
+
+void GimbalGeometry::init(const float yaw_axis_vector[3], const float pitch_axis_vector[3], float starting_pitch_angle) {
+    // yaw axis in spherical coordinates, theta is fixed and phi follows the pitch
+    float theta;
+    if (yaw_axis_vector[0] == 0)
+        theta = 1.57;
+    else if (yaw_axis_vector[0] < 0)
+        theta = M_PI + atanf(yaw_axis_vector[1] / yaw_axis_vector[0]);
+    else
+        theta = atanf(yaw_axis_vector[1] / yaw_axis_vector[0]);
+    cos_theta = cosf(theta);
+    sin_theta = sinf(theta);
+
+    float yaw_mag = sqrtf(yaw_axis_vector[0] * yaw_axis_vector[0] + yaw_axis_vector[1] * yaw_axis_vector[1] + yaw_axis_vector[2] * yaw_axis_vector[2]);
+    phi_offset = acosf(yaw_axis_vector[2] / yaw_mag) - starting_pitch_angle;
+
+    float pitch_mag = sqrtf(pitch_axis_vector[0] * pitch_axis_vector[0] + pitch_axis_vector[1] * pitch_axis_vector[1] + pitch_axis_vector[2] * pitch_axis_vector[2]);
+    for (int i = 0; i < 3; i++) pitch_axis[i] = pitch_axis_vector[i] / pitch_mag;
+
+    valid = false;
+}
@@ -0,0 +1,58 @@
+#include <math.h>
+
+#ifndef GIMBAL_GEOMETRY_H
+#define GIMBAL_GEOMETRY_H
+
+#define GIMBAL_GEOMETRY_PITCH_THRESHOLD 0.001f // pitch change (rad) before the gimbal axes are recomputed
+
+/// @brief Yaw, pitch and roll axes of the gimbal in the IMU frame.
+/// The pitch axis and the direction of the yaw axis only depend on config so they're computed once,
+/// the yaw axis tilts with the pitch encoder so it (and the roll axis) is recomputed when the pitch moves past GIMBAL_GEOMETRY_PITCH_THRESHOLD
+struct GimbalGeometry {
+    /// @brief yaw axis unit vector
+    float yaw_axis[3] = { 0 };
+    /// @brief pitch axis unit vector
+    float pitch_axis[3] = { 0 };
+    /// @brief roll axis unit vector
+    float roll_axis[3] = { 0 };
+
+    /// @brief Compute the constant part of the geometry
+    /// @param yaw_axis_vector yaw axis in the IMU frame at calibration
+    /// @param pitch_axis_vector pitch axis in the IMU frame
+    /// @param starting_pitch_angle pitch encoder angle the yaw axis was calibrated at
+    void init(const float yaw_axis_vector[3], const float pitch_axis_vector[3], float starting_pitch_angle);
+
+    /// @brief Recompute the yaw and roll axes if the pitch has moved past the threshold since they were last computed
+    /// @param pitch_enc_angle current pitch encoder angle
+    inline void update(float pitch_enc_angle) {
+        if (valid && fabsf(pitch_enc_angle - cached_pitch) < GIMBAL_GEOMETRY_PITCH_THRESHOLD) return;
+        cached_pitch = pitch_enc_angle;
+        valid = true;
+
+        // phi = acos(z) - (starting pitch - pitch)
+        float phi = phi_offset + pitch_enc_angle;
+        float sin_phi = sinf(phi);
+        yaw_axis[0] = cos_theta * sin_phi;
+        yaw_axis[1] = sin_theta * sin_phi;
+        yaw_axis[2] = cosf(phi);
+
+        // roll = pitch x yaw
+        roll_axis[0] = pitch_axis[1] * yaw_axis[2] - pitch_axis[2] * yaw_axis[1];
+        roll_axis[1] = -(pitch_axis[0] * yaw_axis[2] - pitch_axis[2] * yaw_axis[0]);
+        roll_axis[2] = pitch_axis[0] * yaw_axis[1] - pitch_axis[1] * yaw_axis[0];
+    }
+
+private:
+    /// @brief cos of the yaw axis theta
+    float cos_theta = 1;
+    /// @brief sin of the yaw axis theta
+    float sin_theta = 0;
+    /// @brief yaw axis phi minus the pitch encoder angle
+    float phi_offset = 0;
+    /// @brief pitch encoder angle the axes were last computed at
+    float cached_pitch = 0;
+    /// @brief whether the axes have been computed since init
+    bool valid = false;
+};
+
+#endif // GIMBAL_GEOMETRY_H
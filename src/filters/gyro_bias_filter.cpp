@@ -0,0 +1,47 @@
+#include "gyro_bias_filter.hpp"
+
+void GyroBiasFilter::reset(const float bias[3]) {
+    for (int i = 0; i < 3; i++) this->bias[i] = bias[i];
+    accel_variance = 0;
+    accel_started = false;
+    still_time = 0;
+    stationary = false;
+}
+
+void GyroBiasFilter::update(const float gyro[3], const float accel[3], float dt) {
+    if (dt <= 0) return;
+
+    // accel variance around its own low passed mean, gravity drops out wherever the IMU points
+    if (!accel_started) {
+        for (int i = 0; i < 3; i++) accel_mean[i] = accel[i];
+        accel_variance = 0;
+        accel_started = true;
+    }
+    float alpha = dt / (GYRO_BIAS_ACCEL_TIME_CONSTANT + dt);
+    float deviation = 0;
+    for (int i = 0; i < 3; i++) {
+        accel_mean[i] += alpha * (accel[i] - accel_mean[i]);
+        float d = accel[i] - accel_mean[i];
+        deviation += d * d;
+    }
+    accel_variance += alpha * (deviation - accel_variance);
+
+    bool still = motor_speed < GYRO_BIAS_MOTOR_SPEED_THRESHOLD
+        && encoder_rate < GYRO_BIAS_ENCODER_RATE_THRESHOLD
+        && accel_variance < GYRO_BIAS_ACCEL_VARIANCE_THRESHOLD;
+    for (int i = 0; i < 3; i++) {
+        if (fabsf(gyro[i] - bias[i]) > GYRO_BIAS_GYRO_THRESHOLD) still = false;
+    }
+
+    still_time = still ? still_time + dt : 0;
+    stationary = still_time >= GYRO_BIAS_HOLD_TIME;
+    if (!stationary) return;
+
+    // low pass towards the raw gyro, each step bounded so a slow turn can't drag the bias far
+    float gain = dt / (GYRO_BIAS_TIME_CONSTANT + dt);
+    float max_step = GYRO_BIAS_MAX_RATE * dt;
+    for (int i = 0; i < 3; i++) {
+        float step = gain * (gyro[i] - bias[i]);
+        bias[i] += fminf(fmaxf(step, -max_step), max_step);
+    }
+}
@@ -0,0 +1,75 @@
+#include <math.h>
+#include <stdint.h>
+
+#ifndef GYRO_BIAS_FILTER_H
+#define GYRO_BIAS_FILTER_H
+
+#define GYRO_BIAS_MOTOR_SPEED_THRESHOLD 5.0f    // fastest motor rotor speed (rad/s) that still counts as stationary
+#define GYRO_BIAS_ENCODER_RATE_THRESHOLD 0.05f  // fastest joint encoder rate (rad/s) that still counts as stationary
+#define GYRO_BIAS_ACCEL_VARIANCE_THRESHOLD 0.05f // largest accel variance ((m/s^2)^2, summed over the axes) that still counts as stationary
+#define GYRO_BIAS_GYRO_THRESHOLD 0.05f          // largest bias corrected gyro rate (rad/s) on any axis that still counts as stationary
+#define GYRO_BIAS_ACCEL_TIME_CONSTANT 0.2f      // time constant (s) of the accel mean and variance
+#define GYRO_BIAS_HOLD_TIME 0.5f                // time (s) every check has to pass before the bias is updated
+#define GYRO_BIAS_TIME_CONSTANT 5.0f            // time constant (s) the bias follows the gyro with while stationary
+#define GYRO_BIAS_MAX_RATE 0.002f               // fastest the bias can move (rad/s per s), bounds the damage of a missed motion
+
+/// @brief Tracks the gyro bias while the robot is stationary, so warm up drift is removed during a match.
+/// Stationary means the motors and joint encoders are (nearly) stopped, the accelerometer is quiet and the gyro
+/// is close to the current bias, all for GYRO_BIAS_HOLD_TIME. The bias then follows the raw gyro through a
+/// low pass whose step is also rate limited.
+/// @note Only uses plain floats (no hardware), so the detection can be replayed on the host from recorded or synthetic traces
+class GyroBiasFilter {
+public:
+    /// @brief default constructor, starts with no bias and not stationary
+    GyroBiasFilter() = default;
+
+    /// @brief Start over from a bias, usually the boot calibration
+    /// @param bias gyro bias (rad/s) in x, y, z
+    void reset(const float bias[3]);
+
+    /// @brief Set how much the rest of the robot is moving, checked by every following update()
+    /// @param motor_speed fastest motor rotor speed (rad/s)
+    /// @param encoder_rate fastest joint encoder rate (rad/s)
+    inline void set_motion(float motor_speed, float encoder_rate) {
+        this->motor_speed = motor_speed;
+        this->encoder_rate = encoder_rate;
+    }
+
+    /// @brief Step the filter with one IMU sample
+    /// @param gyro raw gyro (rad/s) in x, y, z, without any offsets removed
+    /// @param accel accel (m/s^2) in x, y, z
+    /// @param dt time since the previous sample (s)
+    void update(const float gyro[3], const float accel[3], float dt);
+
+    /// @brief Get the bias estimate
+    /// @return bias (rad/s) in x, y, z
+    inline const float* get_bias() const { return bias; }
+
+    /// @brief Whether the robot is currently detected as stationary (and the bias is being updated)
+    /// @return true if stationary
+    inline bool is_stationary() const { return stationary; }
+
+    /// @brief Get the accel variance used for detection
+    /// @return variance ((m/s^2)^2) summed over the axes
+    inline float get_accel_variance() const { return accel_variance; }
+
+private:
+    /// @brief gyro bias (rad/s)
+    float bias[3] = { 0 };
+    /// @brief low passed accel (m/s^2)
+    float accel_mean[3] = { 0 };
+    /// @brief low passed accel variance summed over the axes ((m/s^2)^2)
+    float accel_variance = 0;
+    /// @brief whether accel_mean has been started from a sample
+    bool accel_started = false;
+    /// @brief fastest motor rotor speed from set_motion() (rad/s)
+    float motor_speed = 0;
+    /// @brief fastest joint encoder rate from set_motion() (rad/s)
+    float encoder_rate = 0;
+    /// @brief time (s) every check has passed for
+    float still_time = 0;
+    /// @brief whether the robot is stationary
+    bool stationary = false;
+};
+
+#endif // GYRO_BIAS_FILTER_H
@@ -0,0 +1,116 @@
+#include "mahony_filter.hpp"
+
+void MahonyFilter::set_gains(float kp, float ki) {
+    this->kp = kp;
+    this->ki = ki;
+}
+
+void MahonyFilter::reset() {
+    q[0] = 1;
+    q[1] = 0;
+    q[2] = 0;
+    q[3] = 0;
+    integral[0] = 0;
+    integral[1] = 0;
+    integral[2] = 0;
+    aligned = false;
+}
+
+void MahonyFilter::align(float ax, float ay, float az) {
+    // at rest the accelerometer reads (-cos(p)sin(r), sin(p), cos(p)cos(r)) * g
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+    float pitch = asinf(constrain(ay / norm, -1.0f, 1.0f));
+    float roll = atan2f(-ax, az);
+
+    // q = qx(pitch) * qy(roll)
+    float cp = cosf(pitch * 0.5f);
+    float sp = sinf(pitch * 0.5f);
+    float cr = cosf(roll * 0.5f);
+    float sr = sinf(roll * 0.5f);
+    q[0] = cp * cr;
+    q[1] = sp * cr;
+    q[2] = cp * sr;
+    q[3] = sp * sr;
+    aligned = true;
+}
+
+void MahonyFilter::update(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+    float accel_sq = ax * ax + ay * ay + az * az;
+    float low = MAHONY_GRAVITY * (1 - MAHONY_ACCEL_TOLERANCE);
+    float high = MAHONY_GRAVITY * (1 + MAHONY_ACCEL_TOLERANCE);
+    // the accelerometer only measures gravity when the gimbal isn't being shaken
+    bool accel_valid = accel_sq > low * low && accel_sq < high * high;
+
+    if (!aligned) {
+        if (accel_valid) align(ax, ay, az);
+        return;
+    }
+
+    if (accel_valid) {
+        float inv_norm = 1.0f / sqrtf(accel_sq);
+        ax *= inv_norm;
+        ay *= inv_norm;
+        az *= inv_norm;
+
+        // gravity direction predicted by the attitude, the third row of the rotation matrix
+        float vx = 2 * (q[1] * q[3] - q[0] * q[2]);
+        float vy = 2 * (q[0] * q[1] + q[2] * q[3]);
+        float vz = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+
+        // error is the rotation from the predicted to the measured gravity
+        float ex = ay * vz - az * vy;
+        float ey = az * vx - ax * vz;
+        float ez = ax * vy - ay * vx;
+
+        integral[0] += ki * ex * dt;
+        integral[1] += ki * ey * dt;
+        integral[2] += ki * ez * dt;
+
+        gx += kp * ex;
+        gy += kp * ey;
+        gz += kp * ez;
+    }
+    gx += integral[0];
+    gy += integral[1];
+    gz += integral[2];
+
+    // q += 0.5 * q * (0, g) * dt
+    float hx = 0.5f * gx * dt;
+    float hy = 0.5f * gy * dt;
+    float hz = 0.5f * gz * dt;
+    float q0 = q[0];
+    float q1 = q[1];
+    float q2 = q[2];
+    float q3 = q[3];
+    q[0] = q0 - q1 * hx - q2 * hy - q3 * hz;
+    q[1] = q1 + q0 * hx + q2 * hz - q3 * hy;
+    q[2] = q2 + q0 * hy - q1 * hz + q3 * hx;
+    q[3] = q3 + q0 * hz + q1 * hy - q2 * hx;
+
+    float inv_q_norm = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    q[0] *= inv_q_norm;
+    q[1] *= inv_q_norm;
+    q[2] *= inv_q_norm;
+    q[3] *= inv_q_norm;
+}
+
+void MahonyFilter::get_euler(float& yaw, float& pitch, float& roll) const {
+    float r01 = 2 * (q[1] * q[2] - q[0] * q[3]);
+    float r11 = 1 - 2 * (q[1] * q[1] + q[3] * q[3]);
+    float r20 = 2 * (q[1] * q[3] - q[0] * q[2]);
+    float r21 = 2 * (q[2] * q[3] + q[0] * q[1]);
+    float r22 = 1 - 2 * (q[1] * q[1] + q[2] * q[2]);
+
+    yaw = atan2f(-r01, r11);
+    pitch = asinf(constrain(r21, -1.0f, 1.0f));
+    roll = atan2f(-r20, r22);
+}
+
+void MahonyFilter::body_to_world(const float body[3], float world[3]) const {
+    float r[3][3] = {
+        { 1 - 2 * (q[2] * q[2] + q[3] * q[3]), 2 * (q[1] * q[2] - q[0] * q[3]), 2 * (q[1] * q[3] + q[0] * q[2]) },
+        { 2 * (q[1] * q[2] + q[0] * q[3]), 1 - 2 * (q[1] * q[1] + q[3] * q[3]), 2 * (q[2] * q[3] - q[0] * q[1]) },
+        { 2 * (q[1] * q[3] - q[0] * q[2]), 2 * (q[2] * q[3] + q[0] * q[1]), 1 - 2 * (q[1] * q[1] + q[2] * q[2]) }
+    };
+    for (int i = 0; i < 3; i++) world[i] = r[i][0] * body[0] + r[i][1] * body[1] + r[i][2] * body[2];
+}
@@ -0,0 +1,77 @@
+#include <Arduino.h>
+
+#ifndef MAHONY_FILTER_H
+#define MAHONY_FILTER_H
+
+#define MAHONY_DEFAULT_KP 1.0f          // proportional gain pulling the attitude towards gravity (1/s)
+#define MAHONY_DEFAULT_KI 0.05f         // integral gain estimating the gyro bias (1/s^2)
+#define MAHONY_GRAVITY 9.80665f         // accelerometer magnitude at rest (m/s^2)
+#define MAHONY_ACCEL_TOLERANCE 0.1f     // accelerometer is only trusted within this fraction of gravity
+
+/// @brief Mahony complementary attitude filter. Integrates gyro rates into a quaternion and pulls it towards the
+/// gravity direction measured by the accelerometer, while the integral term learns the gyro bias.
+/// Every update costs the same handful of multiplies and two square roots.
+/// @note Frame is the gimbal's: X is the pitch axis, Y the roll axis and Z the yaw axis when level.
+/// IMU samples have to be rotated into it first when the IMU isn't mounted that way (see GimbalAttitudeEstimator)
+class MahonyFilter {
+public:
+    /// @brief default constructor, starts level with default gains
+    MahonyFilter() = default;
+
+    /// @brief Set the gains
+    /// @param kp proportional gain (1/s)
+    /// @param ki integral gain (1/s^2), 0 to disable bias estimation
+    void set_gains(float kp, float ki);
+
+    /// @brief Go back to level with no bias estimate, the next update aligns to the accelerometer
+    void reset();
+
+    /// @brief Step the filter
+    /// @param gx gyro X (rad/s)
+    /// @param gy gyro Y (rad/s)
+    /// @param gz gyro Z (rad/s)
+    /// @param ax accel X (m/s^2)
+    /// @param ay accel Y (m/s^2)
+    /// @param az accel Z (m/s^2)
+    /// @param dt delta time (s)
+    void update(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+    /// @brief Get the attitude as Euler angles: yaw about Z, then pitch about X, then roll about Y
+    /// @param yaw yaw (rad), positive left
+    /// @param pitch pitch (rad), positive up
+    /// @param roll roll (rad), positive right
+    void get_euler(float& yaw, float& pitch, float& roll) const;
+
+    /// @brief Rotate a vector from the IMU frame to the world frame
+    /// @param body vector in the IMU frame
+    /// @param world vector in the world frame
+    void body_to_world(const float body[3], float world[3]) const;
+
+    /// @brief Get the attitude quaternion
+    /// @return quaternion (w, x, y, z), IMU to world
+    inline const float* get_quaternion() const { return q; }
+
+    /// @brief Get the learned gyro bias correction, added to the raw gyro rates
+    /// @return correction (rad/s) for X, Y, Z
+    inline const float* get_bias_correction() const { return integral; }
+
+private:
+    /// @brief attitude quaternion (w, x, y, z)
+    float q[4] = { 1, 0, 0, 0 };
+    /// @brief integrated error, the negative of the gyro bias
+    float integral[3] = { 0 };
+    /// @brief proportional gain
+    float kp = MAHONY_DEFAULT_KP;
+    /// @brief integral gain
+    float ki = MAHONY_DEFAULT_KI;
+    /// @brief whether the attitude has been aligned to the accelerometer yet
+    bool aligned = false;
+
+    /// @brief Set roll and pitch straight from the gravity direction, yaw is 0
+    /// @param ax accel X
+    /// @param ay accel Y
+    /// @param az accel Z
+    void align(float ax, float ay, float az);
+};
+
+#endif // MAHONY_FILTER_H
@@ -0,0 +1,40 @@
+#include "pid_bank.hpp"
+
+int PIDBank::add_channel(const float K[4], bool bound, bool wrap) {
+    if (num_channels >= PID_BANK_SIZE) return -1;
+
+    int channel = num_channels++;
+    set_gains(channel, K);
+    this->bound[channel] = bound;
+    this->wrap[channel] = wrap;
+    setpoint[channel] = 0;
+    measurement[channel] = 0;
+    output[channel] = 0;
+    sum_error[channel] = 0;
+    prev_error[channel] = 0;
+    return channel;
+}
+
+void PIDBank::set_gains(int channel, const float K[4]) {
+    kp[channel] = K[0];
+    ki[channel] = K[1];
+    kd[channel] = K[2];
+    kf[channel] = K[3];
+}
+
+void PIDBank::step(float dt) {
+    for (int i = 0; i < num_channels; i++) {
+        float error = setpoint[i] - measurement[i];
+        // one 2*pi correction towards zero where wrapping is on, same as PIDFilter
+        float wrapped = error - (float)(2 * PI) * ((float)(error > (float)PI) - (float)(error < (float)-PI));
+        error = wrap[i] ? wrapped : error;
+
+        sum_error[i] += error * dt;
+        float out = (kp[i] * error) + (kd[i] * ((error - prev_error[i]) / dt)) + kf[i];
+        prev_error[i] = error;
+
+        // clamping is the same as dividing by the magnitude when it's over 1, the select compiles to vsel rather than a branch
+        float bounded = fminf(fmaxf(out, -1.0f), 1.0f);
+        output[i] = bound[i] ? bounded : out;
+    }
+}
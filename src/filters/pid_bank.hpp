@@ -0,0 +1,72 @@
+#include <Arduino.h>
+
+#ifndef PID_BANK_H
+#define PID_BANK_H
+
+#define PID_BANK_SIZE 32 // max number of channels in a bank
+
+/// @brief Many PID filters stored as struct-of-arrays and evaluated together in one loop.
+/// Each channel computes exactly what PIDFilter::filter() does, with bounding and wrapping done without branches
+/// @note Gains are set once when a channel is added instead of being copied in every step
+class PIDBank {
+public:
+    /// @brief default constructor, the bank starts empty
+    PIDBank() = default;
+
+    /// @brief Add a channel
+    /// @param K gains (P, I, D, F)
+    /// @param bound bound the output from -1 to 1
+    /// @param wrap wrap the error at 2*pi
+    /// @return channel index, or -1 if the bank is full
+    int add_channel(const float K[4], bool bound, bool wrap);
+
+    /// @brief Remove every channel
+    void clear() { num_channels = 0; }
+
+    /// @brief Set the gains of a channel
+    /// @param channel channel index
+    /// @param K gains (P, I, D, F)
+    void set_gains(int channel, const float K[4]);
+
+    /// @brief Zero the integrated error of a channel
+    /// @param channel channel index
+    void reset(int channel) { sum_error[channel] = 0; }
+
+    /// @brief Run every channel on its current setpoint and measurement
+    /// @param dt delta time (s)
+    void step(float dt);
+
+    /// @brief Get the number of channels
+    /// @return number of channels
+    inline int get_num_channels() const { return num_channels; }
+
+    /// @brief target of each channel
+    float setpoint[PID_BANK_SIZE] = { 0 };
+    /// @brief estimate of each channel
+    float measurement[PID_BANK_SIZE] = { 0 };
+    /// @brief output of each channel from the last step()
+    float output[PID_BANK_SIZE] = { 0 };
+
+private:
+    /// @brief proportional gains
+    float kp[PID_BANK_SIZE] = { 0 };
+    /// @brief integral gains (unused, the I term is disabled in PIDFilter too)
+    float ki[PID_BANK_SIZE] = { 0 };
+    /// @brief derivative gains
+    float kd[PID_BANK_SIZE] = { 0 };
+    /// @brief feedforward terms
+    float kf[PID_BANK_SIZE] = { 0 };
+    /// @brief integrated error
+    float sum_error[PID_BANK_SIZE] = { 0 };
+    /// @brief previous error
+    float prev_error[PID_BANK_SIZE] = { 0 };
+    /// @brief whether the output of each channel is bounded
+    bool bound[PID_BANK_SIZE] = { false };
+    /// @brief whether the error of each channel wraps at 2*pi
+    bool wrap[PID_BANK_SIZE] = { false };
+
+    /// @brief number of channels in use
+    int num_channels = 0;
+};
+
+#endif // PID_BANK_H
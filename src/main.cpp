@@ -3,9 +3,13 @@
 #include "git_info.h"
 
 #include "utils/profiler.hpp"
+#include "utils/control_tick.hpp"
+#include "utils/scheduler.hpp"
+#include "utils/logger.hpp"
 #include "sensors/d200.hpp"
 #include "controls/estimator_manager.hpp"
 #include "controls/controller_manager.hpp"
+#include "controls/state_history.hpp"
 
 #include <TeensyDebug.h>
 #include "sensors/LEDBoard.hpp"
@@ -14,6 +18,9 @@
 #define LOOP_FREQ 1000
 #define HEARTBEAT_FREQ 2
 
+// Use this flag to step everything with a fixed dt (us) instead of the measured one, for deterministic replay
+// #define FIXED_DT_US (1000000 / LOOP_FREQ)
+
 // Declare global objects
 DR16 dr16;
 rm_CAN can;
@@ -27,14 +34,22 @@ ConfigLayer config_layer;
 
 Profiler prof;
 
-Timer loop_timer;
-Timer stall_timer;
-Timer control_input_timer;
+Logger logger;
+
+// Hardware timer that paces the control loop
+IntervalTimer control_timer;
+ControlTick control_tick;
+
+// Runs slow sensor and comms work in the idle time between control ticks
+Scheduler scheduler;
 
 EstimatorManager estimator_manager;
 ControllerManager controller_manager;
 State state;
 
+// past estimates and references, so hive overrides are applied at the step they describe
+StateHistory state_history;
+
 LEDBoard led;
 
 // DONT put anything else in this function. It is not a setup function
@@ -72,6 +87,33 @@ void print_logo() {
     }
 }
 
+// Control tick ISR, only marks the tick so the main loop runs the step at a fixed phase
+void control_tick_isr() {
+    control_tick.tick(micros());
+}
+
+// Scheduler tasks, kept tiny so they fit between control ticks
+void lidar_task() {
+    lidar1.read();
+    lidar2.read();
+}
+
+void dr16_task() {
+    dr16.read();
+}
+
+void ref_task() {
+    ref.read();
+}
+
+void tof_task() {
+    estimator_manager.read_slow_sensors();
+}
+
+void log_task() {
+    logger.drain();
+}
+
 // Master loop
 int main() {
     long long loopc = 0; // Loop counter for heartbeat
@@ -99,14 +141,40 @@ int main() {
     const Config* config = config_layer.configure(&comms);
     Serial.println("Configured!");
 
+    // map each motor index to its place on the CAN buses, before the estimators which check what CAN3 is used for
+    MotorInfo motor_map[NUM_MOTORS];
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        if (config->has_motor_info) {
+            motor_map[i].can_id = (int)config->motor_info[i][0] - 1;
+            motor_map[i].motor_id = (int)config->motor_info[i][1];
+            motor_map[i].controller_type = (int)config->motor_info[i][2];
+        } else if (i < NUM_DEFAULT_MOTORS) {
+            // older configs: CAN 1 and CAN 2 in order, all C620s except the C610 on CAN 2 motor 5
+            motor_map[i].can_id = i / NUM_MOTORS_PER_BUS;
+            motor_map[i].motor_id = i % NUM_MOTORS_PER_BUS + 1;
+            motor_map[i].controller_type = i == can_motor_index(CAN_2, 5) ? C610 : C620;
+        }
+    }
+    can.set_motor_map(motor_map);
+
     //estimate micro and macro state
     estimator_manager.init(can_data, config);
 
-    //generate controller outputs based on governed references and estimated state
-    controller_manager.init(config);
-
     //set reference limits in the reference governor
     state.set_reference_limits(config->set_reference_limits);
+    state_history.set_wrap(state.get_wrap());
+
+    //generate controller outputs based on governed references and estimated state
+    controller_manager.init(config, state.get_wrap());
+
+    // only send CAN message groups that have a motor with a controller on them
+    bool active_motors[NUM_MOTORS] = { false };
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        for (int j = 0; j < NUM_CONTROLLER_LEVELS; j++) {
+            if (config->controller_types[i][j] != 0) active_motors[i] = true;
+        }
+    }
+    can.set_active_motors(active_motors);
 
     // variables for use in main
     float temp_state[STATE_LEN][3] = { 0 }; // Temp state array
@@ -125,6 +193,27 @@ int main() {
     // used in the kinematics matrix
     float chassis_pos_to_motor_error = config->drive_conversion_factors[1];
 
+    // drive motors are the mapped motors with an x,y velocity kinematics entry in the config. The config gives the direction
+    // of each wheel at chassis angle 0, which is rotated with the chassis angle every loop
+    int drive_motors[NUM_MOTORS];
+    float drive_directions[NUM_MOTORS][2];
+    int num_drive_motors = 0;
+    for (int i = 0; i < NUM_MOTORS; i++) {
+        float x = config->kinematics_v[i][0];
+        float y = config->kinematics_v[i][1];
+        float length = sqrtf(x * x + y * y);
+        if (motor_map[i].can_id < 0 || length == 0) continue;
+
+        drive_motors[num_drive_motors] = i;
+        drive_directions[num_drive_motors][0] = x / length;
+        drive_directions[num_drive_motors][1] = y / length;
+        num_drive_motors++;
+
+        // the rotated entries pass through zero, make sure the controller plan steps them
+        controller_manager.add_kinematics_entry(i, 0);
+        controller_manager.add_kinematics_entry(i, 1);
+    }
+
     // manual controls variables
     int vtm_pos_x = 0;
     int vtm_pos_y = 0;
@@ -139,14 +228,52 @@ int main() {
     // whether we are in hive mode or not
     bool hive_toggle = false;
 
+    // teensy packet ID of the last hive override that was applied, so a tagged override is only applied once
+    uint16_t last_override_id = 0;
+
+    // motors that were online last loop, used to report motors dropping off the bus
+    uint32_t prev_online_mask = 0;
+
+    // register background tasks: name, function, rate (Hz), priority (lower runs first), budget (us)
+    // a task only starts if its budget fits before the next tick, deadline misses of the first TEENSY_PACKET_NUM_TASKS tasks are sent to the Khadas
+    // lidars have a 64 byte serial buffer that fills in ~2.8ms at 230400 baud so they are polled every tick
+    scheduler.add_task("lidar", lidar_task, 1000, 0, 50);
+    // dr16 sends an 18 byte packet every ~14ms, polling at 4ms always lands in the gap between packets
+    scheduler.add_task("dr16", dr16_task, 250, 1, 50);
+    scheduler.add_task("ref", ref_task, 500, 2, 100);
+    // the TOF alternates clearing and reading (one I2C register access each), so 10Hz gets a new result every 200ms timing budget
+    scheduler.add_task("tof", tof_task, 10, 3, 200);
+    // deferred log output goes last so it never delays sensor reads
+    scheduler.add_task("log", log_task, 200, 4, 100);
+
+    // start the control tick
+#ifdef FIXED_DT_US
+    control_tick.set_fixed_dt(FIXED_DT_US);
+#endif
+    control_tick.init((uint32_t)(1E6 / (float)(LOOP_FREQ)), micros());
+    control_timer.begin(control_tick_isr, (uint32_t)(1E6 / (float)(LOOP_FREQ)));
+
     // Main loop
     while (true) {
+        // fill the idle time until the next control tick with background work
+        while (!control_tick.begin_step(micros())) {
+            scheduler.run_next(control_tick.time_until_tick(micros()));
+        }
+
+        // one timestamp and dt for everything in this step
+        const LoopTime& loop_time = control_tick.get_loop_time();
+
         // read main sensors
         can.read();
-        dr16.read();
-        ref.read();
-        lidar1.read();
-        lidar2.read();
+
+        // motors that stopped reporting get a zero command from rm_CAN, keep their controllers reset so they
+        // don't wind up while the motor is gone and start cleanly when it comes back
+        for (int i = 0; i < NUM_MOTORS; i++) {
+            if (active_motors[i] && !can_data->is_online(i)) controller_manager.reset_motor(i);
+        }
+        uint32_t lost_motors = prev_online_mask & ~can_data->online_mask;
+        if (lost_motors) LOG_WARN("CAN motors offline: %x", lost_motors);
+        prev_online_mask = can_data->online_mask;
 
         // read and write comms packets
         comms.ping();
@@ -154,7 +281,7 @@ int main() {
         CommsPacket* outgoing = comms.get_outgoing_packet();
 
         // manual controls on firmware
-        float delta = control_input_timer.delta();
+        float delta = loop_time.dt;
         dr16_pos_x += dr16.get_mouse_x() * 0.05 * delta;
         dr16_pos_y += dr16.get_mouse_y() * 0.05 * delta;
 
@@ -227,11 +354,21 @@ int main() {
         // override temp state if needed
         if (incoming->get_hive_override_request() == 1) {
             incoming->get_hive_override_state(hive_state_offset);
-            memcpy(temp_state, hive_state_offset, sizeof(hive_state_offset));
+            uint16_t override_id = incoming->get_hive_override_packet_id();
+            if (override_id == 0) {
+                // untagged, apply it as the current state
+                memcpy(temp_state, hive_state_offset, sizeof(hive_state_offset));
+            } else if (override_id != last_override_id) {
+                // the override describes the robot when hive sampled our packet, correct the estimate of that step and carry the correction to now
+                const StateSnapshot* past = state_history.find_packet(override_id);
+                if (past) state_history.repropagate(past, hive_state_offset, temp_state);
+                else memcpy(temp_state, hive_state_offset, sizeof(hive_state_offset));
+                last_override_id = override_id;
+            }
         }
 
         // step estimates and construct estimated state
-        estimator_manager.step(temp_state, temp_micro_state, incoming->get_hive_override_request());
+        estimator_manager.step(temp_state, temp_micro_state, incoming->get_hive_override_request(), loop_time);
 
         // if first loop set target state to estimated state
         if (count_one == 0) {
@@ -242,46 +379,27 @@ int main() {
 
         // reference govern
         state.set_estimate(temp_state);
-        state.step_reference(target_state, config->governor_types);
+        state.step_reference(target_state, config->governor_types, loop_time);
         state.get_reference(temp_reference);
 
         // Update the kinematics of x,y states, as the kinematics change when chassis angle changes
-        kinematics_vel[0][0] = -sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_vel[0][1] = cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        // motor 2 back right
-        kinematics_vel[1][0] = cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_vel[1][1] = sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-        // motor 3 back left
-        kinematics_vel[2][0] = sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_vel[2][1] = -cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        // motor 4 front left
-        kinematics_vel[3][0] = -cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_vel[3][1] = -sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-
-        // Update the kinematics of x,y states, as the kinematics change when chassis angle changes
-        kinematics_pos[0][0] = -sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_pos[0][1] = cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        // motor 2 back right
-        kinematics_pos[1][0] = cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_pos[1][1] = sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-        // motor 3 back left
-        kinematics_pos[2][0] = sin(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_pos[2][1] = -cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        // motor 4 front left
-        kinematics_pos[3][0] = -cos(temp_state[2][0]) * chassis_pos_to_motor_error;
-        kinematics_pos[3][1] = -sin(temp_state[2][0]) * chassis_pos_to_motor_error;
+        float chassis_cos = cosf(temp_state[2][0]);
+        float chassis_sin = sinf(temp_state[2][0]);
+        for (int i = 0; i < num_drive_motors; i++) {
+            int motor = drive_motors[i];
+            float x = drive_directions[i][0];
+            float y = drive_directions[i][1];
+            kinematics_vel[motor][0] = (x * chassis_cos - y * chassis_sin) * chassis_pos_to_motor_error;
+            kinematics_vel[motor][1] = (x * chassis_sin + y * chassis_cos) * chassis_pos_to_motor_error;
+            kinematics_pos[motor][0] = kinematics_vel[motor][0];
+            kinematics_pos[motor][1] = kinematics_vel[motor][1];
+        }
 
         // generate motor outputs from controls
-        controller_manager.step(temp_reference, temp_state, temp_micro_state, kinematics_pos, kinematics_vel, motor_inputs);
+        controller_manager.step(temp_reference, temp_state, temp_micro_state, kinematics_pos, kinematics_vel, motor_inputs, loop_time);
 
         // set motor outputs from motor_inputs
-        for (int j = 0; j < 2; j++) {
-            for (int i = 0; i < NUM_MOTORS_PER_BUS; i++) {
-                can.write_motor_norm(j, i + 1, C620, motor_inputs[(j * NUM_MOTORS_PER_BUS) + i]);
-                if (j == 1 && i == 4)
-                    can.write_motor_norm(j, i + 1, C610, motor_inputs[(j * NUM_MOTORS_PER_BUS) + i]);
-            }
-        }
+        can.write_motors(motor_inputs);
 
         // construct sensor data packet
         SensorData sensor_data;
@@ -293,18 +411,33 @@ int main() {
         memcpy(sensor_data.raw + SENSOR_LIDAR1_OFFSET, lidar_data, D200_NUM_PACKETS_CACHED * D200_PAYLOAD_SIZE);
         lidar2.export_data(lidar_data);
         memcpy(sensor_data.raw + SENSOR_LIDAR2_OFFSET, lidar_data, D200_NUM_PACKETS_CACHED * D200_PAYLOAD_SIZE);
+        // set buff encoder error counts and status
+        for (int i = 0; i < SENSOR_NUM_BUFF_ENC; i++) {
+            estimator_manager.get_buff_encoder(i).export_data((uint8_t*)sensor_data.raw + SENSOR_BUFF_ENC_OFFSET + i * BUFF_ENCODER_EXPORT_SIZE);
+        }
+        // set chassis pose variance
+        float chassis_variance[3];
+        estimator_manager.get_chassis_variance(chassis_variance);
+        memcpy(sensor_data.raw + SENSOR_CHASSIS_VARIANCE_OFFSET, chassis_variance, sizeof(chassis_variance));
 
         // construct ref data packet
         uint8_t ref_data_raw[180] = { 0 };
         ref.get_data_for_comms(ref_data_raw);
 
-        // set the outgoing packet
-        outgoing->set_id((uint16_t)loopc);
+        // set the outgoing packet, IDs skip 0 since hive tags an override with 0 when it isn't tied to a packet
+        uint16_t packet_id = (uint16_t)(loopc % UINT16_MAX) + 1;
+        outgoing->set_id(packet_id);
         outgoing->set_info(0x0000);
         outgoing->set_time(millis() / 1000.0);
         outgoing->set_sensor_data(&sensor_data);
         outgoing->set_ref_data(ref_data_raw);
         outgoing->set_estimated_state(temp_state);
+        state_history.record(loop_time.now_us, packet_id, temp_state, temp_reference);
+        outgoing->set_loop_stats(&control_tick.get_stats());
+        outgoing->set_task_misses(&scheduler);
+        outgoing->set_can_stats(can.get_bus_stats());
+        outgoing->set_motor_online(can_data->online_mask);
+        outgoing->set_gyro_bias(estimator_manager.get_gyro_bias().get_bias(), estimator_manager.get_gyro_bias().is_stationary());
 
         //  SAFETY MODE
         if (dr16.is_connected() && (dr16.get_l_switch() == 2 || dr16.get_l_switch() == 3) && config_layer.is_configured()) {
@@ -314,16 +447,18 @@ int main() {
             // SAFETY ON
             // TODO: Reset all controller integrators here
             can.zero();
+            // flash writes block interrupts for milliseconds, so refined IMU offsets are only saved while the motors are off
+            estimator_manager.save_imu_calibration();
         }
 
         // LED heartbeat -- linked to loop count to reveal slowdowns and freezes.
         loopc % (int)(1E3 / float(HEARTBEAT_FREQ)) < (int)(1E3 / float(5 * HEARTBEAT_FREQ)) ? digitalWrite(13, HIGH) : digitalWrite(13, LOW);
         loopc++;
 
-        // Keep the loop running at the desired rate
-        loop_timer.delay_micros((int)(1E6 / (float)(LOOP_FREQ)));
-        float dt = stall_timer.delta();
-        if (dt > 0.002) Serial.printf("Slow loop with dt: %f\n", dt);
+        // record step timing, overruns are reported over comms
+        if (control_tick.end_step(micros())) {
+            LOG_WARN("Slow loop: %u us", control_tick.get_stats().last_exec_us);
+        }
     }
     
     return 0;
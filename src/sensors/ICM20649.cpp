@@ -1,6 +1,38 @@
 #include "ICM20649.hpp"
 #include <cassert>
 
+// register map, the bank is given where each register is used
+constexpr uint8_t ICM_REG_WHO_AM_I = 0x00;          // bank 0
+constexpr uint8_t ICM_REG_USER_CTRL = 0x03;         // bank 0
+constexpr uint8_t ICM_REG_PWR_MGMT_1 = 0x06;        // bank 0
+constexpr uint8_t ICM_REG_PWR_MGMT_2 = 0x07;        // bank 0
+constexpr uint8_t ICM_REG_TEMP_OUT_H = 0x39;        // bank 0
+constexpr uint8_t ICM_REG_FIFO_EN_1 = 0x66;         // bank 0
+constexpr uint8_t ICM_REG_FIFO_EN_2 = 0x67;         // bank 0
+constexpr uint8_t ICM_REG_FIFO_RST = 0x68;          // bank 0
+constexpr uint8_t ICM_REG_FIFO_MODE = 0x69;         // bank 0
+constexpr uint8_t ICM_REG_FIFO_COUNTH = 0x70;       // bank 0
+constexpr uint8_t ICM_REG_FIFO_R_W = 0x72;          // bank 0
+constexpr uint8_t ICM_REG_GYRO_SMPLRT_DIV = 0x00;   // bank 2
+constexpr uint8_t ICM_REG_GYRO_CONFIG_1 = 0x01;     // bank 2
+constexpr uint8_t ICM_REG_ODR_ALIGN_EN = 0x09;      // bank 2
+constexpr uint8_t ICM_REG_ACCEL_SMPLRT_DIV_1 = 0x10;// bank 2
+constexpr uint8_t ICM_REG_ACCEL_SMPLRT_DIV_2 = 0x11;// bank 2
+constexpr uint8_t ICM_REG_ACCEL_CONFIG = 0x14;      // bank 2
+constexpr uint8_t ICM_REG_BANK_SEL = 0x7F;          // every bank
+
+constexpr uint8_t ICM_WHO_AM_I = 0xE1;
+constexpr uint8_t ICM_READ = 0x80;
+constexpr uint8_t ICM_USER_CTRL_FIFO_EN = 0x40;
+constexpr uint8_t ICM_USER_CTRL_I2C_IF_DIS = 0x10;
+constexpr uint8_t ICM_FIFO_EN_2_ACCEL_GYRO = 0x1E;  // accel and gyro X, Y, Z
+constexpr uint8_t ICM_ACCEL_FS_30G = 3;
+constexpr float ICM_ACCEL_LSB_PER_G = 1024.0f;      // at +-30g
+constexpr float ICM_GRAVITY = 9.80665f;
+constexpr float ICM_TEMP_LSB_PER_C = 333.87f;
+constexpr float ICM_TEMP_OFFSET_C = 21.0f;
+constexpr float ICM_GYRO_LSB_PER_DPS[4] = { 65.5f, 32.8f, 16.4f, 8.2f };
+
 // empty constructor
 ICM20649::ICM20649() {}
 
@@ -20,12 +52,14 @@ void ICM20649::init(CommunicationProtocol protocol) {
     }
     case SPI:
     {
-        // start SPI communication
-        int a = sensor.begin_SPI(ICM_CS, ICM_SCK, ICM_MISO, ICM_MOSI);
-        Serial.println(a);
-        if (!a) {
-            Serial.println("Failed to begin SPI");
-        }
+        // the ICM pins are SPI1's, drive the registers directly instead of through the adafruit library
+        pinMode(ICM_CS, OUTPUT);
+        digitalWriteFast(ICM_CS, HIGH);
+        SPI1.setMOSI(ICM_MOSI);
+        SPI1.setMISO(ICM_MISO);
+        SPI1.setSCK(ICM_SCK);
+        SPI1.begin();
+        init_registers();
         break;
     }
     default:
@@ -50,6 +84,17 @@ void ICM20649::init(CommunicationProtocol protocol) {
 }
 
 void ICM20649::read() {
+    if (protocol == SPI) {
+        num_samples = 0;
+        if (burst_pending) {
+            // the last burst is still going, its frames will be collected next time
+            if (!burst_done) return;
+            finish_burst();
+        }
+        start_burst();
+        return;
+    }
+
     // get the event data from the sensor class
     sensor.getEvent(&accel, &gyro, &temp);
 
@@ -65,6 +110,168 @@ void ICM20649::read() {
     gyro_Z = gyro.gyro.z;
 
     temperature = temp.temperature;
+
+    // one sample per read without the FIFO
+    samples[0].time_us = micros();
+    samples[0].accel[0] = accel_X;
+    samples[0].accel[1] = accel_Y;
+    samples[0].accel[2] = accel_Z;
+    samples[0].gyro[0] = get_gyro_X();
+    samples[0].gyro[1] = get_gyro_Y();
+    samples[0].gyro[2] = get_gyro_Z();
+    num_samples = 1;
+}
+
+float ICM20649::read_temperature() {
+    if (protocol == SPI) {
+        int16_t raw = (int16_t)((read_register(0, ICM_REG_TEMP_OUT_H) << 8) | read_register(0, ICM_REG_TEMP_OUT_H + 1));
+        temperature = raw / ICM_TEMP_LSB_PER_C + ICM_TEMP_OFFSET_C;
+        return temperature;
+    }
+
+    sensor.getEvent(&accel, &gyro, &temp);
+    temperature = temp.temperature;
+    return temperature;
+}
+
+void ICM20649::init_registers() {
+    // reset, which also selects bank 0
+    transfer_register(ICM_REG_BANK_SEL, 0);
+    transfer_register(ICM_REG_PWR_MGMT_1, 0x80);
+    delay(10);
+    current_bank = 0;
+
+    // wake up with the best available clock
+    write_register(0, ICM_REG_PWR_MGMT_1, 0x01);
+    delay(1);
+    uint8_t who_am_i = read_register(0, ICM_REG_WHO_AM_I);
+    if (who_am_i != ICM_WHO_AM_I) {
+        Serial.printf("ICM20649 WHO_AM_I is 0x%02x, expected 0x%02x\n", who_am_i, ICM_WHO_AM_I);
+    }
+    write_register(0, ICM_REG_USER_CTRL, ICM_USER_CTRL_I2C_IF_DIS);
+    write_register(0, ICM_REG_PWR_MGMT_2, 0x00);
+
+    // full rate with the DLPF on (1.1kHz gyro, 1.125kHz accel), accel at +-30g
+    write_register(2, ICM_REG_ODR_ALIGN_EN, 0x01);
+    write_register(2, ICM_REG_GYRO_SMPLRT_DIV, 0);
+    write_register(2, ICM_REG_GYRO_CONFIG_1, (1 << 3) | (gyro_fs << 1) | 1);
+    write_register(2, ICM_REG_ACCEL_SMPLRT_DIV_1, 0);
+    write_register(2, ICM_REG_ACCEL_SMPLRT_DIV_2, 0);
+    write_register(2, ICM_REG_ACCEL_CONFIG, (1 << 3) | (ICM_ACCEL_FS_30G << 1) | 1);
+    accel_rate = 1125;
+    gyro_rate = ICM_GYRO_RATE;
+
+    parser.set_scales(ICM_GRAVITY / ICM_ACCEL_LSB_PER_G, DEG_TO_RAD / ICM_GYRO_LSB_PER_DPS[gyro_fs]);
+    parser.set_sample_period(1e6f / ICM_GYRO_RATE);
+
+    // stream accel and gyro (no temperature) into the FIFO
+    write_register(0, ICM_REG_FIFO_EN_1, 0x00);
+    write_register(0, ICM_REG_FIFO_EN_2, ICM_FIFO_EN_2_ACCEL_GYRO);
+    write_register(0, ICM_REG_FIFO_MODE, 0x00);
+    reset_fifo();
+    write_register(0, ICM_REG_USER_CTRL, ICM_USER_CTRL_I2C_IF_DIS | ICM_USER_CTRL_FIFO_EN);
+
+    burst_tx[0] = ICM_REG_FIFO_R_W | ICM_READ;
+    burst_event.setContext(this);
+    burst_event.attachImmediate(burst_complete);
+}
+
+uint8_t ICM20649::transfer_register(uint8_t address, uint8_t value) {
+    // register access can't share the bus with a running burst
+    if (burst_pending) {
+        while (!burst_done) {}
+        finish_burst();
+    }
+
+    SPI1.beginTransaction(spi_settings);
+    digitalWriteFast(ICM_CS, LOW);
+    SPI1.transfer(address);
+    uint8_t result = SPI1.transfer(value);
+    digitalWriteFast(ICM_CS, HIGH);
+    SPI1.endTransaction();
+    return result;
+}
+
+void ICM20649::select_bank(uint8_t bank) {
+    if (bank == current_bank) return;
+    transfer_register(ICM_REG_BANK_SEL, bank << 4);
+    current_bank = bank;
+}
+
+void ICM20649::write_register(uint8_t bank, uint8_t reg, uint8_t value) {
+    select_bank(bank);
+    transfer_register(reg, value);
+}
+
+uint8_t ICM20649::read_register(uint8_t bank, uint8_t reg) {
+    select_bank(bank);
+    return transfer_register(reg | ICM_READ, 0);
+}
+
+void ICM20649::reset_fifo() {
+    write_register(0, ICM_REG_FIFO_RST, 0x1F);
+    write_register(0, ICM_REG_FIFO_RST, 0x00);
+    parser.reset();
+}
+
+void ICM20649::start_burst() {
+    select_bank(0);
+
+    // FIFO count is 13 bits, high byte first
+    uint8_t count_bytes[3] = { ICM_REG_FIFO_COUNTH | ICM_READ, 0, 0 };
+    SPI1.beginTransaction(spi_settings);
+    digitalWriteFast(ICM_CS, LOW);
+    SPI1.transfer(count_bytes, 3);
+    digitalWriteFast(ICM_CS, HIGH);
+    SPI1.endTransaction();
+    burst_time_us = micros();
+
+    int fifo_count = ((count_bytes[1] & 0x1F) << 8) | count_bytes[2];
+    if (fifo_count >= ICM_FIFO_SIZE - ICM_FIFO_FRAME_SIZE) {
+        // the FIFO may have overwritten frames, which breaks the frame alignment
+        reset_fifo();
+        return;
+    }
+
+    // only whole frames are taken, the rest stays in the FIFO for next time
+    int frames = min(fifo_count / ICM_FIFO_FRAME_SIZE, ICM_FIFO_MAX_FRAMES);
+    if (frames == 0) return;
+
+    burst_length = frames * ICM_FIFO_FRAME_SIZE;
+    burst_done = false;
+    burst_pending = true;
+    SPI1.beginTransaction(spi_settings);
+    digitalWriteFast(ICM_CS, LOW);
+    SPI1.transfer(burst_tx, burst_rx, burst_length + 1, burst_event);
+}
+
+void ICM20649::burst_complete(EventResponderRef event) {
+    ICM20649* icm = (ICM20649*)event.getContext();
+    digitalWriteFast(ICM_CS, HIGH);
+    icm->burst_done = true;
+}
+
+void ICM20649::finish_burst() {
+    SPI1.endTransaction();
+    burst_pending = false;
+
+    num_samples = parser.parse(burst_rx + 1, burst_length, burst_time_us, samples, ICM_FIFO_MAX_FRAMES);
+    if (num_samples == 0) return;
+
+    // the getters return the newest sample
+    const IMUSample& newest = samples[num_samples - 1];
+    accel_X = newest.accel[0];
+    accel_Y = newest.accel[1];
+    accel_Z = newest.accel[2];
+    gyro_X = newest.gyro[0];
+    gyro_Y = newest.gyro[1];
+    gyro_Z = newest.gyro[2];
+
+    for (int i = 0; i < num_samples; i++) {
+        samples[i].gyro[0] -= offset_X;
+        samples[i].gyro[1] -= offset_Y;
+        samples[i].gyro[2] -= offset_Z;
+    }
 }
 
 // calculate the approximate acceleration data rate (Hz) from the divisor.
@@ -80,6 +287,18 @@ float ICM20649::get_gyro_data_rate() {
 }
 
 void ICM20649::set_gyro_range(int gyro_rate_range) {
+    if (protocol == SPI) {
+        switch (gyro_rate_range) {
+        case (1000): gyro_fs = 1; break;
+        case (2000): gyro_fs = 2; break;
+        case (4000): gyro_fs = 3; break;
+        default: gyro_fs = 0; break;
+        }
+        write_register(2, ICM_REG_GYRO_CONFIG_1, (1 << 3) | (gyro_fs << 1) | 1);
+        parser.set_scales(ICM_GRAVITY / ICM_ACCEL_LSB_PER_G, DEG_TO_RAD / ICM_GYRO_LSB_PER_DPS[gyro_fs]);
+        return;
+    }
+
     switch (gyro_rate_range) {
     default:
         sensor.setGyroRange(ICM20649_GYRO_RANGE_500_DPS);
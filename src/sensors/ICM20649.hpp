@@ -3,8 +3,10 @@
 
 // adafruit library specific to ICM20(...) hardware
 #include <Adafruit_ICM20649.h> 
+#include <SPI.h>
 
 #include "IMUSensor.hpp"
+#include "ICM20649FIFO.hpp"
 
 // Configure pin numbers used for SPI communication on the teensy
 
@@ -17,7 +19,16 @@
 /// @brief SCL/SCK (SPI Clock) pin for software-SPI mode
 #define ICM_SCK 27
 
+/// @brief SPI clock for direct register access (the ICM20649 supports up to 7MHz)
+#define ICM_SPI_CLOCK 7000000
+/// @brief size of the on-chip FIFO in bytes, the FIFO is reset if it gets this full
+#define ICM_FIFO_SIZE 512
+/// @brief gyro output data rate (Hz) with a divisor of 0, the FIFO is filled at this rate
+#define ICM_GYRO_RATE 1100.0f
+
 /// @brief Sensor access for an ICM20649 IMU Sensor. Child of the abstract IMUSensor class.
+/// In SPI mode the sensor is driven by register on SPI1: accel and gyro go through the on-chip FIFO and every read()
+/// takes all the frames since the last one in a single DMA burst, so the loop never waits on the IMU.
 /// @note supports I2C and SPI communication. 
 /// @see Adafruit library this class utilizes: https://adafruit.github.io/Adafruit_ICM20X/html/class_adafruit___i_c_m20_x.html
 class ICM20649 : public IMUSensor {
@@ -36,17 +47,110 @@ public:
     /// @param protocol Which communication protocol to use for this sensor.
     void init(CommunicationProtocol protocol);
 
-    /// @copydoc IMUSensor::read()    
+    /// @copydoc IMUSensor::read()
+    /// @note In SPI mode this collects the burst started by the previous read() and starts the next one,
+    /// so the samples are up to a tick old. The temperature isn't read in SPI mode
     void read() override;
 
+    /// @brief Read the die temperature right away, outside of read()
+    /// @return temperature in Celcius
+    /// @note in SPI mode this waits for any running burst, so it's meant for calibration rather than every tick
+    float read_temperature();
+
     /// @brief set teh gyro rate range of the sensor
     /// @param gyro_rate_range new rate range
     void set_gyro_range(int gyro_rate_range);
 
+    /// @brief Get the number of new samples from the last read()
+    /// @return number of samples, 0 if the burst hadn't finished yet
+    inline int get_num_samples() const { return num_samples; }
+
+    /// @brief Get a sample from the last read(), oldest first, with the gyro offsets removed
+    /// @param i sample index
+    /// @return the sample
+    inline const IMUSample& get_sample(int i) const { return samples[i]; }
+
 private:
     /// @brief sensor object from adafruit libraries.
     Adafruit_ICM20649 sensor;
 
+    /// @brief SPI settings for direct register access
+    SPISettings spi_settings = SPISettings(ICM_SPI_CLOCK, MSBFIRST, SPI_MODE3);
+
+    /// @brief fires when a FIFO burst finishes
+    EventResponder burst_event;
+
+    /// @brief whether a burst has been started and not collected
+    bool burst_pending = false;
+
+    /// @brief set from the DMA completion interrupt
+    volatile bool burst_done = false;
+
+    /// @brief number of FIFO bytes in the pending burst
+    int burst_length = 0;
+
+    /// @brief time (us) the FIFO count of the pending burst was read, the newest frame is at most a period older
+    uint32_t burst_time_us = 0;
+
+    /// @brief register bank currently selected
+    uint8_t current_bank = 0xff;
+
+    /// @brief burst transmit buffer, the FIFO read address followed by zeros
+    uint8_t burst_tx[ICM_FIFO_MAX_FRAMES * ICM_FIFO_FRAME_SIZE + 1] __attribute__((aligned(32))) = { 0 };
+
+    /// @brief burst receive buffer, one status byte followed by the FIFO bytes
+    uint8_t burst_rx[ICM_FIFO_MAX_FRAMES * ICM_FIFO_FRAME_SIZE + 1] __attribute__((aligned(32))) = { 0 };
+
+    /// @brief frame parser
+    ICM20649FIFOParser parser;
+
+    /// @brief samples from the last read()
+    IMUSample samples[ICM_FIFO_MAX_FRAMES];
+
+    /// @brief number of samples from the last read()
+    int num_samples = 0;
+
+    /// @brief gyro full scale select (0: 500, 1: 1000, 2: 2000, 3: 4000 dps)
+    uint8_t gyro_fs = 0;
+
+    /// @brief Configure the sensor registers and start the FIFO (SPI mode)
+    void init_registers();
+
+    /// @brief Send a register address and a data byte in one transaction
+    /// @param address register address, with the read bit set for reads
+    /// @param value byte to write, 0 for reads
+    /// @return byte clocked in with the data byte (the register value for reads)
+    uint8_t transfer_register(uint8_t address, uint8_t value);
+
+    /// @brief Select a register bank, skipped if it's already selected
+    /// @param bank bank 0-3
+    void select_bank(uint8_t bank);
+
+    /// @brief Write a register (SPI mode)
+    /// @param bank register bank
+    /// @param reg register address
+    /// @param value value to write
+    void write_register(uint8_t bank, uint8_t reg, uint8_t value);
+
+    /// @brief Read a register (SPI mode)
+    /// @param bank register bank
+    /// @param reg register address
+    /// @return register value
+    uint8_t read_register(uint8_t bank, uint8_t reg);
+
+    /// @brief Read the FIFO count and start a DMA burst of every complete frame in it
+    void start_burst();
+
+    /// @brief Parse a finished burst into samples
+    void finish_burst();
+
+    /// @brief Reset the FIFO and drop any partial frame
+    void reset_fifo();
+
+    /// @brief DMA completion handler, releases chip select
+    /// @param event the burst event, its context is the sensor
+    static void burst_complete(EventResponderRef event);
+
     /// @brief calculate the approximate acceleration rates in Hz from the divisor.
     /// @return acceleration data rate in Hz
     float get_accel_data_rate();
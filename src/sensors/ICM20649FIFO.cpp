@@ -0,0 +1,50 @@
+#include "ICM20649FIFO.hpp"
+
+void ICM20649FIFOParser::set_scales(float accel_scale, float gyro_scale) {
+    this->accel_scale = accel_scale;
+    this->gyro_scale = gyro_scale;
+}
+
+void ICM20649FIFOParser::decode(const uint8_t* frame, IMUSample& sample) const {
+    for (int axis = 0; axis < 3; axis++) {
+        int16_t accel_raw = (int16_t)((frame[2 * axis] << 8) | frame[2 * axis + 1]);
+        int16_t gyro_raw = (int16_t)((frame[6 + 2 * axis] << 8) | frame[6 + 2 * axis + 1]);
+        sample.accel[axis] = accel_raw * accel_scale;
+        sample.gyro[axis] = gyro_raw * gyro_scale;
+    }
+}
+
+int ICM20649FIFOParser::parse(const uint8_t* data, int length, uint32_t newest_time_us, IMUSample* samples, int max_samples) {
+    // frames completed by this data, so the timestamps can count back from the newest
+    int num_frames = (partial_len + length) / ICM_FIFO_FRAME_SIZE;
+    int count = 0;
+    int i = 0;
+
+    // finish the frame left over from the last call
+    if (partial_len > 0 && partial_len + length >= ICM_FIFO_FRAME_SIZE) {
+        int needed = ICM_FIFO_FRAME_SIZE - partial_len;
+        memcpy(partial + partial_len, data, needed);
+        i = needed;
+        partial_len = 0;
+        if (count < max_samples) {
+            decode(partial, samples[count]);
+            samples[count].time_us = newest_time_us - (uint32_t)((num_frames - 1 - count) * period_us);
+            count++;
+        }
+    }
+
+    for (; i + ICM_FIFO_FRAME_SIZE <= length; i += ICM_FIFO_FRAME_SIZE) {
+        if (count >= max_samples) continue;
+        decode(data + i, samples[count]);
+        samples[count].time_us = newest_time_us - (uint32_t)((num_frames - 1 - count) * period_us);
+        count++;
+    }
+
+    // keep the start of a frame that's still being written
+    int leftover = length - i;
+    if (leftover > 0) {
+        memcpy(partial + partial_len, data + i, leftover);
+        partial_len += leftover;
+    }
+    return count;
+}
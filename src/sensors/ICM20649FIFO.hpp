@@ -0,0 +1,68 @@
+#ifndef ICM20649_FIFO_H
+#define ICM20649_FIFO_H
+
+#include <Arduino.h>
+
+/// @brief Bytes in one FIFO frame: accel X, Y, Z then gyro X, Y, Z, each 16 bit big endian
+#define ICM_FIFO_FRAME_SIZE 12
+/// @brief Most frames taken from the FIFO in one burst (~44ms at 1.1kHz)
+#define ICM_FIFO_MAX_FRAMES 48
+
+/// @brief One timestamped IMU sample
+struct IMUSample {
+    /// @brief time (us) the sample was taken
+    uint32_t time_us = 0;
+    /// @brief acceleration (m/s^2) in x, y, z
+    float accel[3] = { 0 };
+    /// @brief angular velocity (rad/s) in x, y, z
+    float gyro[3] = { 0 };
+};
+
+/// @brief Turns a stream of ICM20649 FIFO bytes into timestamped samples.
+/// Bytes of a frame split across two reads are carried over to the next call.
+/// @note Only depends on Arduino types so recorded FIFO streams can be parsed on the host
+class ICM20649FIFOParser {
+public:
+    /// @brief default constructor, the scales must be set before parsing
+    ICM20649FIFOParser() = default;
+
+    /// @brief Set the unit conversions
+    /// @param accel_scale m/s^2 per accel LSB
+    /// @param gyro_scale rad/s per gyro LSB
+    void set_scales(float accel_scale, float gyro_scale);
+
+    /// @brief Set the time between frames
+    /// @param period_us time (us) between frames
+    void set_sample_period(float period_us) { this->period_us = period_us; }
+
+    /// @brief Drop a partially received frame, call this whenever the FIFO is reset
+    void reset() { partial_len = 0; }
+
+    /// @brief Parse bytes read from the FIFO
+    /// @param data bytes in the order they were read
+    /// @param length number of bytes
+    /// @param newest_time_us time (us) of the newest frame in the data, older frames are spaced one period apart before it
+    /// @param samples array to write samples to
+    /// @param max_samples size of the samples array, frames past it are dropped
+    /// @return number of samples written
+    int parse(const uint8_t* data, int length, uint32_t newest_time_us, IMUSample* samples, int max_samples);
+
+private:
+    /// @brief bytes of a frame that hasn't been completed yet
+    uint8_t partial[ICM_FIFO_FRAME_SIZE] = { 0 };
+    /// @brief number of bytes in partial
+    int partial_len = 0;
+    /// @brief m/s^2 per accel LSB
+    float accel_scale = 0;
+    /// @brief rad/s per gyro LSB
+    float gyro_scale = 0;
+    /// @brief time (us) between frames
+    float period_us = 1e6f / 1100.0f;
+
+    /// @brief Convert one complete frame
+    /// @param frame ICM_FIFO_FRAME_SIZE bytes
+    /// @param sample sample to write
+    void decode(const uint8_t* frame, IMUSample& sample) const;
+};
+
+#endif // ICM20649_FIFO_H
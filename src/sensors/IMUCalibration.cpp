@@ -0,0 +1,41 @@
+#include "IMUCalibration.hpp"
+#include <avr/eeprom.h>
+
+/// @brief Layout of the calibration in EEPROM
+struct StoredIMUCalibration {
+    /// @brief IMU_CALIBRATION_MAGIC if a calibration has been stored
+    uint32_t magic;
+    /// @brief the calibration
+    IMUCalibration calibration;
+    /// @brief sum of the calibration bytes, catches a half written calibration
+    uint32_t checksum;
+};
+
+/// @brief Sum the bytes of a calibration
+/// @param calibration calibration to sum
+/// @return byte sum
+static uint32_t calibration_checksum(const IMUCalibration& calibration) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&calibration);
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < sizeof(IMUCalibration); i++) sum = (sum << 1 | sum >> 31) + bytes[i];
+    return sum;
+}
+
+bool IMUCalibration::load() {
+    StoredIMUCalibration stored;
+    eeprom_read_block(&stored, (const void*)IMU_CALIBRATION_EEPROM_ADDR, sizeof(stored));
+    if (stored.magic != IMU_CALIBRATION_MAGIC) return false;
+    if (stored.checksum != calibration_checksum(stored.calibration)) return false;
+
+    *this = stored.calibration;
+    return true;
+}
+
+void IMUCalibration::store() const {
+    StoredIMUCalibration stored;
+    stored.magic = IMU_CALIBRATION_MAGIC;
+    stored.calibration = *this;
+    stored.checksum = calibration_checksum(*this);
+    // eeprom_write_block skips bytes that already hold the value, so storing the same calibration again costs no flash wear
+    eeprom_write_block(&stored, (void*)IMU_CALIBRATION_EEPROM_ADDR, sizeof(stored));
+}
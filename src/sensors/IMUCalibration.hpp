@@ -0,0 +1,26 @@
+#ifndef IMU_CALIBRATION_H
+#define IMU_CALIBRATION_H
+
+#include <Arduino.h>
+
+/// @brief EEPROM address of the stored IMU calibration
+#define IMU_CALIBRATION_EEPROM_ADDR 0
+/// @brief marks a stored calibration, change it when the layout of IMUCalibration changes
+#define IMU_CALIBRATION_MAGIC 0x49434D31 // "ICM1"
+
+/// @brief Gyro offsets and the temperature they were measured at, kept in EEPROM across power cycles
+struct IMUCalibration {
+    /// @brief gyro offsets (rad/s) in x, y, z
+    float offset[3] = { 0 };
+    /// @brief sensor temperature (C) when the offsets were measured
+    float temperature = 0;
+
+    /// @brief Load the stored calibration
+    /// @return true if a valid calibration was stored, false leaves this unchanged
+    bool load();
+
+    /// @brief Store this calibration
+    void store() const;
+};
+
+#endif // IMU_CALIBRATION_H
@@ -50,6 +50,16 @@ public:
         offset_Z = z;
     }
 
+    /// @brief Get the offsets set by set_offsets()
+    /// @param x offset in x
+    /// @param y offset in y
+    /// @param z offset in z
+    inline void get_offsets(float& x, float& y, float& z) {
+        x = offset_X;
+        y = offset_Y;
+        z = offset_Z;
+    }
+
     /// @brief Print out all IMU data to Serial for debugging purposes
     void print();
 
@@ -0,0 +1,18 @@
+#include "MT6835Frame.hpp"
+
+uint8_t mt6835_crc8(const uint8_t* data, int length) {
+    uint8_t crc = 0;
+    for (int i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+bool mt6835_decode(const uint8_t frame[MT6835_FRAME_SIZE], MT6835Reading& reading) {
+    // angle[20:13], angle[12:5], angle[4:0] | status[2:0], then the CRC of those 24 bits
+    reading.raw_angle = ((uint32_t)frame[2] << 13) | ((uint32_t)frame[3] << 5) | (frame[4] >> 3);
+    reading.status = frame[4] & 0x07;
+    reading.crc_ok = mt6835_crc8(frame + 2, 3) == frame[5];
+    return reading.crc_ok;
+}
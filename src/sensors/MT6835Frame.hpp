@@ -0,0 +1,32 @@
+#ifndef MT6835_FRAME_H
+#define MT6835_FRAME_H
+
+#include <Arduino.h>
+
+/// @brief Bytes in an MT6835 burst angle read: command, address, 3 angle/status bytes and the CRC
+#define MT6835_FRAME_SIZE 6
+
+/// @brief One decoded burst angle read
+struct MT6835Reading {
+    /// @brief 21 bit angle, MT6835_CPR counts per revolution
+    uint32_t raw_angle = 0;
+    /// @brief status bits (overspeed, weak field, under voltage)
+    uint8_t status = 0;
+    /// @brief whether the CRC matched
+    bool crc_ok = false;
+};
+
+/// @brief CRC-8 the MT6835 appends to the angle (polynomial x^8 + x^2 + x + 1, initial value 0)
+/// @param data bytes to check
+/// @param length number of bytes
+/// @return CRC
+uint8_t mt6835_crc8(const uint8_t* data, int length);
+
+/// @brief Decode the bytes clocked in during a burst angle read
+/// @param frame MT6835_FRAME_SIZE bytes received, the first two are clocked in with the command
+/// @param reading decoded angle, status and CRC check
+/// @return true if the CRC matched
+/// @note Only depends on Arduino types so recorded frames can be decoded on the host
+bool mt6835_decode(const uint8_t frame[MT6835_FRAME_SIZE], MT6835Reading& reading);
+
+#endif // MT6835_FRAME_H
@@ -1,4 +1,5 @@
 #include "RefSystem.hpp"
+#include "../utils/logger.hpp"
 
 uint8_t generateCRC8(uint8_t* data, uint32_t len) {
     uint8_t CRC8 = 0xFF;
@@ -130,13 +131,13 @@ void RefSystem::read() {
 void RefSystem::write(uint8_t* packet, uint8_t length) {
     // return if over baud rate
     if (bytes_sent >= REF_MAX_BAUD_RATE) {
-        Serial.println("Too many bytes");
+        LOG_WARN("Ref: too many bytes");
         return;
     }
 
     // return if writing too many bytes
     if (length > REF_MAX_PACKET_SIZE) {
-        Serial.println("Packet Too Long to Send!");
+        LOG_WARN("Ref: packet too long to send");
         return;
     }
 
@@ -162,7 +163,7 @@ void RefSystem::write(uint8_t* packet, uint8_t length) {
         packets_sent++;
         bytes_sent += length;
     } else
-        Serial.println("Failed to write");
+        LOG_WARN("Ref: failed to write");
 }
 
 void RefSystem::get_data_for_comms(uint8_t output_array[180]) {
@@ -201,7 +202,7 @@ bool RefSystem::read_frame_header(HardwareSerial* serial, uint8_t raw_buffer[REF
     // read and verify header
     int bytes_read = serial->readBytes(raw_buffer, FrameHeader::packet_size);
     if (bytes_read != FrameHeader::packet_size) {
-        Serial.println("Couldnt read enough bytes for Header");
+        LOG_DEBUG("Ref: couldnt read enough bytes for header");
         packets_failed++;
         return false;
     }
@@ -209,7 +210,7 @@ bool RefSystem::read_frame_header(HardwareSerial* serial, uint8_t raw_buffer[REF
     // set read data
     frame.header.SOF = raw_buffer[buffer_index + 0];
     if (frame.header.SOF != 0xA5) {
-        Serial.println("Not a valid frame");
+        LOG_DEBUG("Ref: not a valid frame");
         return false;
     }
 
@@ -219,7 +220,7 @@ bool RefSystem::read_frame_header(HardwareSerial* serial, uint8_t raw_buffer[REF
 
     // verify the CRC is correct
     if (frame.header.CRC != generateCRC8(raw_buffer, 4)) {
-        Serial.println("Header failed CRC");
+        LOG_WARN("Ref: header failed CRC");
         packets_failed++;
         return false;
     }
@@ -238,7 +239,7 @@ bool RefSystem::read_frame_command_ID(HardwareSerial* serial, uint8_t raw_buffer
     // read and verify command ID
     int bytes_read = serial->readBytes(raw_buffer + buffer_index, 2);
     if (bytes_read != 2) {
-        Serial.println("Couldnt read enough bytes for ID");
+        LOG_DEBUG("Ref: couldnt read enough bytes for ID");
         packets_failed++;
         return false;
     }
@@ -248,7 +249,7 @@ bool RefSystem::read_frame_command_ID(HardwareSerial* serial, uint8_t raw_buffer
 
     // sanity check, verify the ID is valid
     if (frame.commandID > REF_MAX_COMMAND_ID) {
-        Serial.println("Invalid Command ID");
+        LOG_WARN("Ref: invalid command ID %u", frame.commandID);
         packets_failed++;
         return false;
     }
@@ -267,7 +268,7 @@ bool RefSystem::read_frame_data(HardwareSerial* serial, uint8_t raw_buffer[REF_M
     // read and verify data
     int bytes_read = serial->readBytes(raw_buffer + buffer_index, frame.header.data_length);
     if (bytes_read != frame.header.data_length) {
-        Serial.println("Couldnt read enough bytes for Data");
+        LOG_DEBUG("Ref: couldnt read enough bytes for data");
         packets_failed++;
         return false;
     }
@@ -289,7 +290,7 @@ bool RefSystem::read_frame_tail(HardwareSerial* serial, uint8_t raw_buffer[REF_M
     // read and verify tail
     int bytes_read = serial->readBytes(raw_buffer + buffer_index, 2);
     if (bytes_read != 2) {
-        Serial.println("Couldnt read enough bytes for CRC");
+        LOG_DEBUG("Ref: couldnt read enough bytes for CRC");
         packets_failed++;
         return false;
     }
@@ -298,7 +299,7 @@ bool RefSystem::read_frame_tail(HardwareSerial* serial, uint8_t raw_buffer[REF_M
     frame.CRC = (raw_buffer[buffer_index + 1] << 8) | raw_buffer[buffer_index + 0];
 
     if (frame.CRC != generateCRC16(raw_buffer, buffer_index)) {
-        Serial.println("Tail failed CRC");
+        LOG_WARN("Ref: tail failed CRC");
         packets_failed++;
         return false;
     }
@@ -419,7 +420,7 @@ void RefSystem::set_ref_data(Frame& frame, uint8_t raw_buffer[REF_MAX_PACKET_SIZ
         ref_data.small_map_robot_data.set_data(frame.data);
         break;
     default:
-        Serial.println("Unknown Frame Type");
+        LOG_DEBUG("Ref: unknown frame type");
         break;
     }
 }
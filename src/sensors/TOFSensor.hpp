@@ -10,6 +10,8 @@
 constexpr TwoWire* TOF_DEFAULT_I2C_BUS = &Wire2;
 /// @brief Default pin to turn off and on the sensor (-1 to disable this feature)
 constexpr int TOF_DEFAULT_SHUTOFF_PIN = -1;
+/// @brief I2C clock (Hz) for the TOF sensor, fast mode (400kHz) so one register access takes ~150us instead of ~600us at the default 100kHz
+constexpr uint32_t TOF_I2C_CLOCK = 400000;
 
 /// @brief A time of flight sensor to measure distance in millimeters
 class TOFSensor
@@ -46,6 +48,7 @@ public:
     void init() {
         // initalize the wire 
         i2c_bus->begin();
+        i2c_bus->setClock(TOF_I2C_CLOCK);
 
         // configure the sensor
         sensor.begin();
@@ -92,6 +95,10 @@ public:
         // return the results
         return latest_distance;
     }
+
+    /// @brief Get the most recent distance without talking to the sensor
+    /// @return distance (mm) from the last call to read()
+    inline uint16_t get_distance() const { return latest_distance; }
 };
 
 #endif
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "buff_encoder.hpp"
 
-const SPISettings BuffEncoder::m_settings = SPISettings(1000000, MT6835_BITORDER, SPI_MODE3);
+#include "../utils/logger.hpp"
+
+const SPISettings BuffEncoder::m_settings = SPISettings(MT6835_SPI_CLOCK, MT6835_BITORDER, SPI_MODE3);
 
 float BuffEncoder::read() {
 
-    uint8_t data[6] = { 0 }; // transact 48 bits
+    uint8_t data[MT6835_FRAME_SIZE] = { 0 }; // transact 48 bits
 
     // set the operation
     data[0] = (MT6835_OP_ANGLE << 4);
@@ -13,16 +15,92 @@ float BuffEncoder::read() {
     // do the SPI transfer
     SPI.beginTransaction(m_settings);
     digitalWrite(m_CS, LOW);
-    SPI.transfer(data, 6);
+    SPI.transfer(data, MT6835_FRAME_SIZE);
     digitalWrite(m_CS, HIGH);
     SPI.endTransaction();
 
+    decode(data);
+    return m_angle;
+}
+
+bool BuffEncoder::decode(const uint8_t frame[MT6835_FRAME_SIZE]) {
+    MT6835Reading reading;
+    // an all zero frame passes the CRC, but it's what a missing encoder reads as
+    bool responded = frame[2] | frame[3] | frame[4] | frame[5];
+    if (!mt6835_decode(frame, reading) || !responded) {
+        fail();
+        return false;
+    }
+    m_valid = true;
 
     // convert received angle into radians
-    int raw_angle = (data[2] << 13) | (data[3] << 5) | (data[4] >> 3);
-    float radians = raw_angle / (float)MT6835_CPR * (3.14159265 * 2.0);
+    m_angle = reading.raw_angle / (float)MT6835_CPR * (3.14159265 * 2.0);
+    m_status = reading.status;
+    return true;
+}
+
+void BuffEncoder::export_data(uint8_t bytes[BUFF_ENCODER_EXPORT_SIZE]) const {
+    memcpy(bytes, &m_errors, sizeof(m_errors));
+    bytes[4] = m_status;
+    bytes[5] = m_valid;
+}
+
+void BuffEncoder::fail() {
+    // only the first error and each good to bad transition are logged, a missing encoder would otherwise warn every loop
+    if (m_valid || m_errors == 0) LOG_WARN("Buff encoder (CS %d): bad frame, holding the last angle (%lu errors)", m_CS, (unsigned long)(m_errors + 1));
+    m_valid = false;
+    m_errors++;
+}
+
+void BuffEncoderBatch::init(BuffEncoder* encoders, int count) {
+    this->encoders = encoders;
+    this->count = min(count, BUFF_ENCODER_MAX_BATCH);
+    tx[0] = (MT6835_OP_ANGLE << 4);
+    tx[1] = MT6835_REG_ANGLE1;
+    event.setContext(this);
+    event.attachImmediate(transfer_complete);
+}
+
+void BuffEncoderBatch::start() {
+    if (pending || count == 0) return;
+
+    current = 0;
+    done = false;
+    pending = true;
+    SPI.beginTransaction(BuffEncoder::m_settings);
+    begin_transfer(0);
+}
+
+void BuffEncoderBatch::finish() {
+    if (!pending) return;
+
+    uint32_t wait_start = micros();
+    while (!done) {
+        if (micros() - wait_start > BUFF_ENCODER_BATCH_TIMEOUT_US) {
+            for (int i = 0; i < count; i++) encoders[i].fail();
+            return;
+        }
+    }
+    SPI.endTransaction();
+    pending = false;
+
+    for (int i = 0; i < count; i++) encoders[i].decode(rx[i]);
+}
+
+void BuffEncoderBatch::begin_transfer(int i) {
+    digitalWriteFast(encoders[i].get_cs(), LOW);
+    SPI.transfer(tx, rx[i], MT6835_FRAME_SIZE, event);
+}
+
+void BuffEncoderBatch::transfer_complete(EventResponderRef event) {
+    BuffEncoderBatch* batch = (BuffEncoderBatch*)event.getContext();
+    digitalWriteFast(batch->encoders[batch->current].get_cs(), HIGH);
 
-    // assign and return angle
-    m_angle = radians;
-    return radians;
+    int next = batch->current + 1;
+    if (next < batch->count) {
+        batch->current = next;
+        batch->begin_transfer(next);
+        return;
+    }
+    batch->done = true;
 }
\ No newline at end of file
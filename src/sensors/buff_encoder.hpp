@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <SPI.h>
 
+#include "MT6835Frame.hpp"
+
 // Encoder Registers and Config
 constexpr uint32_t MT6835_OP_READ = 0b0011;
 constexpr uint32_t MT6835_OP_WRITE = 0b0110;
@@ -37,6 +39,10 @@ constexpr uint32_t MT6835_REG_OPTS5 = 0x011;
 constexpr uint32_t MT6835_REG_NLC_BASE = 0x013;
 constexpr uint32_t MT6835_REG_CAL_STATUS = 0x113;
 constexpr uint32_t MT6835_BITORDER = MSBFIRST;
+constexpr uint32_t MT6835_SPI_CLOCK = 16000000;  // fastest SPI clock the MT6835 supports
+constexpr int BUFF_ENCODER_MAX_BATCH = 4;        // most encoders read in one BuffEncoderBatch
+constexpr uint32_t BUFF_ENCODER_BATCH_TIMEOUT_US = 200; // longest BuffEncoderBatch::finish() waits for the DMA sequence (us)
+constexpr int BUFF_ENCODER_EXPORT_SIZE = 6;      // bytes written by BuffEncoder::export_data
 
 // Chip Select pins for the two encoders
 constexpr int YAW_BUFF_CS = 37;
@@ -59,13 +65,50 @@ public:
 
     /// @brief Read via SPI the current angle of the encoder
     /// @return Read angle (radians)
-    /// @note Returns and sets m_angle when it reads
+    /// @note Returns and sets m_angle when it reads, blocks for the transfer. Use a BuffEncoderBatch in the control loop
     float read();
 
+    /// @brief Update the angle and status from a received burst angle frame.
+    /// The angle is kept from the last good frame if the CRC doesn't match or the encoder didn't respond
+    /// @param frame MT6835_FRAME_SIZE bytes received
+    /// @return true if the frame was good
+    bool decode(const uint8_t frame[MT6835_FRAME_SIZE]);
+
     /// @brief Get the angle of the last read function
     /// @return Read angle (radians)
     inline float get_angle() const { return m_angle; }
 
+    /// @brief Get the Chip Select pin
+    /// @return Chip Select pin
+    inline int get_cs() const { return m_CS; }
+
+    /// @brief Whether the last frame was good, if not the angle is from an older frame
+    /// @return true if the last frame passed its CRC
+    inline bool is_valid() const { return m_valid; }
+
+    /// @brief Get the status bits of the last good frame
+    /// @return MT6835_STATUS_* bits
+    inline uint8_t get_status() const { return m_status; }
+
+    /// @brief Whether the magnet was spinning too fast for the encoder in the last good frame
+    /// @return true if overspeed
+    inline bool is_overspeed() const { return m_status & MT6835_STATUS_OVERSPEED; }
+
+    /// @brief Whether the magnetic field was too weak in the last good frame
+    /// @return true if the field is weak
+    inline bool is_weak_field() const { return m_status & MT6835_STATUS_WEAKFIELD; }
+
+    /// @brief Whether the supply voltage was too low in the last good frame
+    /// @return true if under voltage
+    inline bool is_undervoltage() const { return m_status & MT6835_STATUS_UNDERVOLT; }
+
+    /// @brief Get the number of bad frames (CRC mismatch or no response) since startup
+    /// @return error count
+    inline uint32_t get_error_count() const { return m_errors; }
+
+    /// @brief Write the error count and status for comms
+    /// @param bytes error count (uint32, little endian), status bits of the last good frame, then 1 if the last frame was good
+    void export_data(uint8_t bytes[BUFF_ENCODER_EXPORT_SIZE]) const;
 
 private:
     /// @brief Stored Chip Select pin
@@ -74,9 +117,78 @@ private:
     /// @brief Read angle from the encoder
     float m_angle = 0.f;
 
+    /// @brief status bits of the last good frame
+    uint8_t m_status = 0;
+
+    /// @brief whether the last frame was good
+    bool m_valid = false;
+
+    /// @brief number of bad frames
+    uint32_t m_errors = 0;
+
     /// @brief The SPI settings of the buff encoders
     static const SPISettings m_settings;
 
+    /// @brief Count a bad or missing frame, warns when the encoder goes from good to bad
+    void fail();
+
+    // the batch reads with the same settings
+    friend class BuffEncoderBatch;
+
+};
+
+/// @brief Reads several buff encoders on SPI in one queued DMA sequence. Each transfer's completion interrupt
+/// raises its CS and starts the next encoder, so the loop only pays for starting the sequence and decoding it.
+class BuffEncoderBatch {
+public:
+    /// @brief default constructor, the batch starts empty
+    BuffEncoderBatch() = default;
+
+    /// @brief Set the encoders to read
+    /// @param encoders encoder array
+    /// @param count number of encoders, only the first BUFF_ENCODER_MAX_BATCH are read
+    void init(BuffEncoder* encoders, int count);
+
+    /// @brief Start reading every encoder, skipped if the last sequence hasn't been collected
+    void start();
+
+    /// @brief Wait for the sequence started by start() and update every encoder from it.
+    /// If it doesn't finish within BUFF_ENCODER_BATCH_TIMEOUT_US every encoder counts an error and keeps its angle,
+    /// the sequence stays pending so it isn't restarted on top of a live transfer, and a later finish() collects it
+    void finish();
+
+private:
+    /// @brief encoders to read
+    BuffEncoder* encoders = nullptr;
+
+    /// @brief number of encoders to read
+    int count = 0;
+
+    /// @brief encoder currently being transferred
+    volatile int current = 0;
+
+    /// @brief set from the completion interrupt once the last encoder is done
+    volatile bool done = false;
+
+    /// @brief whether a sequence has been started and not collected
+    bool pending = false;
+
+    /// @brief fires when each transfer finishes
+    EventResponder event;
+
+    /// @brief burst angle read command, the same for every encoder
+    uint8_t tx[32] __attribute__((aligned(32))) = { 0 };
+
+    /// @brief received frame of each encoder, each in its own cache line
+    uint8_t rx[BUFF_ENCODER_MAX_BATCH][32] __attribute__((aligned(32))) = { { 0 } };
+
+    /// @brief Lower an encoder's CS and start its transfer
+    /// @param i encoder index
+    void begin_transfer(int i);
+
+    /// @brief DMA completion handler, raises CS and moves on to the next encoder
+    /// @param event the batch event, its context is the batch
+    static void transfer_complete(EventResponderRef event);
 };
 
 #endif
\ No newline at end of file
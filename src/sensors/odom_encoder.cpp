@@ -0,0 +1,105 @@
+#include "odom_encoder.hpp"
+
+#if defined(__IMXRT1062__)
+// ENC registers (i.MXRT1060 reference manual chapter 56)
+constexpr uint16_t ENC_CTRL_SWIP = 1 << 12;     // load the init registers into the position counter
+constexpr uint16_t ENC_CTRL_REV = 1 << 2;       // count in reverse
+constexpr uint16_t ENC_FILT_COUNT = 3 << 8;     // phase must be stable for 3 + 3 samples
+constexpr uint16_t ENC_FILT_PERIOD = 2;         // sampled every 2 IPG clocks (150MHz), rejects glitches under ~80ns
+
+/// @brief XBAR routing of a pin
+struct OdomEncoderPin {
+    uint8_t pin;
+    uint8_t xbar_input;
+    uint8_t mux;
+    volatile uint32_t* select_input;
+    uint8_t select;
+};
+
+// Teensy 4.1 pins with an XBAR1 INOUT function, pins sharing an INOUT can't be used together
+static const OdomEncoderPin odom_encoder_pins[] = {
+    { 0, 17, 1, &IOMUXC_XBAR1_IN17_SELECT_INPUT, 1 },
+    { 1, 16, 1, &IOMUXC_XBAR1_IN16_SELECT_INPUT, 0 },
+    { 2, 6, 3, &IOMUXC_XBAR1_IN06_SELECT_INPUT, 0 },
+    { 3, 7, 3, &IOMUXC_XBAR1_IN07_SELECT_INPUT, 0 },
+    { 4, 8, 3, &IOMUXC_XBAR1_IN08_SELECT_INPUT, 0 },
+    { 5, 17, 3, &IOMUXC_XBAR1_IN17_SELECT_INPUT, 0 },
+    { 7, 15, 1, &IOMUXC_XBAR1_IN15_SELECT_INPUT, 1 },
+    { 8, 14, 1, &IOMUXC_XBAR1_IN14_SELECT_INPUT, 1 },
+    { 30, 23, 1, &IOMUXC_XBAR1_IN23_SELECT_INPUT, 0 },
+    { 31, 22, 1, &IOMUXC_XBAR1_IN22_SELECT_INPUT, 0 },
+    { 33, 9, 3, &IOMUXC_XBAR1_IN09_SELECT_INPUT, 0 },
+};
+
+/// @brief registers, XBAR outputs and clock gate of each decoder
+static IMXRT_ENC_t* const odom_encoder_modules[ODOM_ENCODER_NUM_MODULES] = { &IMXRT_ENC1, &IMXRT_ENC2, &IMXRT_ENC3, &IMXRT_ENC4 };
+static const int odom_encoder_phase_a[ODOM_ENCODER_NUM_MODULES] = { XBARA1_OUT_ENC1_PHASEA_INPUT, XBARA1_OUT_ENC2_PHASEA_INPUT, XBARA1_OUT_ENC3_PHASEA_INPUT, XBARA1_OUT_ENC4_PHASEA_INPUT };
+static const int odom_encoder_phase_b[ODOM_ENCODER_NUM_MODULES] = { XBARA1_OUT_ENC1_PHASEB_INPUT, XBARA1_OUT_ENC2_PHASEB_INPUT, XBARA1_OUT_ENC3_PHASEB_INPUT, XBARA1_OUT_ENC4_PHASEB_INPUT };
+static const uint32_t odom_encoder_clocks[ODOM_ENCODER_NUM_MODULES] = { CCM_CCGR4_ENC1(CCM_CCGR_ON), CCM_CCGR4_ENC2(CCM_CCGR_ON), CCM_CCGR4_ENC3(CCM_CCGR_ON), CCM_CCGR4_ENC4(CCM_CCGR_ON) };
+
+extern "C" void xbar_connect(unsigned int input, unsigned int output);
+#endif
+
+bool OdomEncoder::connect_pin(uint8_t pin, int xbar_output) {
+#if defined(__IMXRT1062__)
+    for (const OdomEncoderPin& p : odom_encoder_pins) {
+        if (p.pin != pin) continue;
+        *portConfigRegister(pin) = p.mux;
+        *portControlRegister(pin) = IOMUXC_PAD_PKE | IOMUXC_PAD_PUE | IOMUXC_PAD_PUS(3) | IOMUXC_PAD_HYS;
+        if (p.select_input) *p.select_input = p.select;
+        xbar_connect(p.xbar_input, xbar_output);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool OdomEncoder::init(uint8_t pin_a, uint8_t pin_b, int module, RevEncoder* absolute, bool reverse) {
+    if (module < 1 || module > ODOM_ENCODER_NUM_MODULES) {
+        Serial.printf("Odom encoder: no quadrature decoder %d\n", module);
+        return false;
+    }
+    home_angle = absolute ? absolute->get_angle_radians() : 0;
+    count = 0;
+    delta = 0;
+
+#if defined(__IMXRT1062__)
+    int m = module - 1;
+    CCM_CCGR2 |= CCM_CCGR2_XBAR1(CCM_CCGR_ON);
+    CCM_CCGR4 |= odom_encoder_clocks[m];
+    if (!connect_pin(pin_a, odom_encoder_phase_a[m]) || !connect_pin(pin_b, odom_encoder_phase_b[m])) {
+        Serial.printf("Odom encoder: pins %d and %d aren't both XBAR pins\n", pin_a, pin_b);
+        return false;
+    }
+
+    IMXRT_ENC_t* regs = odom_encoder_modules[m];
+    regs->CTRL = 0;
+    regs->CTRL2 = 0;
+    regs->FILT = ENC_FILT_COUNT | ENC_FILT_PERIOD;
+    regs->UINIT = 0;
+    regs->LINIT = 0;
+    regs->CTRL = ENC_CTRL_SWIP | (reverse ? ENC_CTRL_REV : 0);
+    this->module = m;
+    return true;
+#else
+    (void)pin_a;
+    (void)pin_b;
+    (void)reverse;
+    return false;
+#endif
+}
+
+void OdomEncoder::read() {
+    if (module < 0) return;
+
+#if defined(__IMXRT1062__)
+    // reading UPOS latches LPOS into LPOSH, so the two halves are from the same instant
+    IMXRT_ENC_t* regs = odom_encoder_modules[module];
+    uint16_t upper = regs->UPOS;
+    uint16_t lower = regs->LPOSH;
+    int32_t now = (int32_t)(((uint32_t)upper << 16) | lower);
+    // the difference is right across the 32 bit wrap too
+    delta = (int32_t)((uint32_t)now - (uint32_t)count);
+    count = now;
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef ODOM_ENCODER_H
+#define ODOM_ENCODER_H
+
+#include <Arduino.h>
+
+#include "rev_encoder.hpp"
+
+/// @brief quadrature counts per revolution of the Rev Through Bore (2048 cycles, counted on every edge)
+constexpr int ODOM_ENCODER_COUNTS_PER_REV = 8192;
+/// @brief number of hardware quadrature decoders (ENC1-ENC4)
+constexpr int ODOM_ENCODER_NUM_MODULES = 4;
+/// @brief odometry pods read by quadrature, the Teensy only has free XBAR pins for two
+constexpr int NUM_ODOM_PODS = 2;
+
+/// @brief Odometry pod encoder read from the A/B outputs of a Rev Through Bore by one of the i.MXRT1062's
+/// hardware quadrature decoders (ENC). The pins are routed to the decoder through XBAR1, so edges are counted
+/// in hardware with no interrupts, and a read is two register loads.
+/// The PWM absolute angle is only used once to home the count.
+class OdomEncoder {
+public:
+    /// @brief Construct a new odom encoder without initializing it
+    OdomEncoder() {};
+
+    /// @brief Route the pins to a decoder and start counting
+    /// @param pin_a pin of the A phase, must be XBAR capable
+    /// @param pin_b pin of the B phase, must be XBAR capable
+    /// @param module decoder to use, 1-4
+    /// @param absolute PWM encoder on the same shaft to home the angle from, nullptr to start at 0
+    /// @param reverse count the other way
+    /// @return true if the pins and module could be used
+    bool init(uint8_t pin_a, uint8_t pin_b, int module, RevEncoder* absolute, bool reverse = false);
+
+    /// @brief Take the current count from the decoder
+    void read();
+
+    /// @brief Get the count from the last read
+    /// @return counts since homing
+    inline int32_t get_count() const { return count; }
+
+    /// @brief Get the change in count between the last two reads
+    /// @return counts
+    inline int32_t get_delta() const { return delta; }
+
+    /// @brief Get the change in angle between the last two reads
+    /// @return radians
+    inline float get_delta_radians() const { return delta * (float)(2 * PI / ODOM_ENCODER_COUNTS_PER_REV); }
+
+    /// @brief Get the angle from the last read, not wrapped
+    /// @return radians, from the homed angle
+    inline float get_angle_radians() const { return home_angle + count * (float)(2 * PI / ODOM_ENCODER_COUNTS_PER_REV); }
+
+private:
+    /// @brief decoder index (0-3), -1 if init failed
+    int module = -1;
+
+    /// @brief count from the last read
+    int32_t count = 0;
+
+    /// @brief change in count between the last two reads
+    int32_t delta = 0;
+
+    /// @brief angle (rad) the count was started at
+    float home_angle = 0;
+
+    /// @brief Route a pin to a decoder input through XBAR1
+    /// @param pin pin number
+    /// @param xbar_output XBAR1 output of the decoder input
+    /// @return true if the pin is XBAR capable
+    static bool connect_pin(uint8_t pin, int xbar_output);
+};
+
+#endif // ODOM_ENCODER_H
@@ -11,14 +11,18 @@ void RevEncoder::init(uint8_t encoder_pin, bool is_relative) {
     pinMode(this->in_pin, INPUT);  // Set the pin used to measure the encoder to be an input
     freq.begin(this->in_pin, FREQMEASUREMULTI_MARK_ONLY);
     if(is_relative){
-        for(int i=0;i<500;i++){
-            this->read();
-            delayMicroseconds(5);
-        }
+        // one full PWM period is enough to zero from
+        uint32_t start_us = micros();
+        while (!freq.available() && micros() - start_us < REV_ENCODER_INIT_TIMEOUT_US) {}
+        this->read();
         starting_value = this->radians;
     }
 }
 
+void RevEncoder::end() {
+    freq.end();
+}
+
 void RevEncoder::read() {
     while (this->freq.available() > 1) {
         this->freq.read();
@@ -4,6 +4,9 @@
 #ifndef REV_ENCODER_H
 #define REV_ENCODER_H
 
+/// @brief longest wait (us) for the first PWM period when zeroing a relative encoder, a period is ~1ms
+#define REV_ENCODER_INIT_TIMEOUT_US 5000
+
 /// @brief the class for the Rev Through Bore Encoder(www.revrobotics.com/rev-11-1271/)
 class RevEncoder {
 private:
@@ -12,9 +15,9 @@ private:
 	/// @brief Used to read rise time of the encoder
 	FreqMeasureMulti freq;
 	/// @brief measure of current angle in ticks [0, 1023]
-	int ticks;
+	int ticks = 0;
 	/// @brief measure of current angle in radians [0, 2pi)
-	float radians;
+	float radians = 0;
 	/// @brief the starting value of the encoder in radians
 	float starting_value = 0;
 public:
@@ -30,6 +33,9 @@ public:
 	/// @param is_relative if the encoder is relative or absolute
 	void init(uint8_t encoder_pin, bool is_relative);
 
+	/// @brief stop measuring the PWM signal, which takes an interrupt per edge
+	void end();
+
 	/// @brief updates ticks and radians to the current angle 
 	void read();
 	/// @brief get the last angle of the encoder in ticks
@@ -0,0 +1,74 @@
+#include "control_tick.hpp"
+
+void ControlTick::init(uint32_t period_us, uint32_t now_us) {
+    noInterrupts();
+    pending_ticks = 0;
+    last_tick_us = now_us;
+    first_pending_tick_us = now_us;
+    interrupts();
+
+    this->period_us = period_us;
+    step_start_us = now_us;
+    stats = ControlTickStats{};
+    loop_time = LoopTime{};
+    loop_time.now_us = fixed_dt_us ? 0 : now_us;
+}
+
+void ControlTick::set_fixed_dt(uint32_t dt_us) {
+    fixed_dt_us = dt_us;
+    loop_time = LoopTime{};
+    loop_time.now_us = fixed_dt_us ? 0 : step_start_us;
+}
+
+void ControlTick::tick(uint32_t now_us) {
+    if (pending_ticks == 0) first_pending_tick_us = now_us;
+    pending_ticks = pending_ticks + 1;
+    last_tick_us = now_us;
+}
+
+bool ControlTick::begin_step(uint32_t now_us) {
+    // grab and clear the pending ticks atomically so a tick firing in between isn't lost
+    noInterrupts();
+    uint32_t pending = pending_ticks;
+    uint32_t tick_us = first_pending_tick_us;
+    pending_ticks = 0;
+    interrupts();
+
+    if (pending == 0) return false;
+
+    // every tick past the first one never got a step of its own
+    stats.missed_ticks += pending - 1;
+
+    // how late this step starts relative to the oldest deadline it is serving, not just the latest tick,
+    // otherwise a step that swallowed missed ticks would look on time
+    uint32_t jitter = now_us - tick_us;
+    stats.last_jitter_us = jitter;
+    if (jitter > stats.max_jitter_us) stats.max_jitter_us = jitter;
+
+    step_start_us = now_us;
+    stats.steps++;
+
+    // one timestamp and dt for the whole step
+    uint32_t step_now_us = fixed_dt_us ? loop_time.now_us + fixed_dt_us : now_us;
+    loop_time.dt = (step_now_us - loop_time.now_us) * 1E-6f;
+    loop_time.now_us = step_now_us;
+    return true;
+}
+
+bool ControlTick::end_step(uint32_t now_us) {
+    uint32_t exec = now_us - step_start_us;
+    stats.last_exec_us = exec;
+    if (exec > stats.max_exec_us) stats.max_exec_us = exec;
+    if (exec <= period_us) return false;
+
+    stats.overruns++;
+    return true;
+}
+
+uint32_t ControlTick::time_until_tick(uint32_t now_us) const {
+    if (pending_ticks) return 0;
+
+    uint32_t elapsed = now_us - last_tick_us;
+    if (elapsed >= period_us) return 0;
+    return period_us - elapsed;
+}
@@ -0,0 +1,104 @@
+#ifndef CONTROL_TICK_H
+#define CONTROL_TICK_H
+
+#include <Arduino.h>
+
+/// @brief Timing statistics of the fixed-rate control tick
+/// @note This is copied into the outgoing comms packet as raw bytes, keep it packed with fixed-width types
+struct ControlTickStats {
+    /// @brief Number of control steps that have been run
+    uint32_t steps = 0;
+    /// @brief Number of ticks that fired while a previous tick was still pending (ticks that never got a step)
+    uint32_t missed_ticks = 0;
+    /// @brief Number of steps whose execution time was longer than the tick period
+    uint32_t overruns = 0;
+    /// @brief Latency (us) between the oldest pending tick firing and the step starting, so missed ticks count in full
+    uint32_t last_jitter_us = 0;
+    /// @brief Largest latency (us) seen between a pending tick firing and its step starting
+    uint32_t max_jitter_us = 0;
+    /// @brief Execution time (us) of the last step
+    uint32_t last_exec_us = 0;
+    /// @brief Longest execution time (us) of any step
+    uint32_t max_exec_us = 0;
+};
+
+/// @brief Time of a control step, captured once when the step begins and passed to everything that runs in it
+/// so every estimator, governor and controller integrates over the same interval
+struct LoopTime {
+    /// @brief Time (us) the step began
+    uint32_t now_us = 0;
+    /// @brief Time (s) since the previous step began
+    float dt = 0;
+};
+
+/// @brief Fixed-phase control tick. A hardware timer ISR calls @ref tick() and the main loop runs one control step per tick.
+/// @note All functions take the current time as an argument so the tick can be driven by any clock (micros() on the Teensy, a fake clock elsewhere)
+class ControlTick {
+public:
+    /// @brief Default constructor, does nothing
+    ControlTick() = default;
+
+    /// @brief Reset the tick state and statistics
+    /// @param period_us tick period in microseconds
+    /// @param now_us current time in microseconds
+    void init(uint32_t period_us, uint32_t now_us);
+
+    /// @brief Mark a tick as fired. Call this from the timer ISR
+    /// @param now_us current time in microseconds
+    void tick(uint32_t now_us);
+
+    /// @brief Consume a pending tick, start timing a control step and capture its @ref LoopTime
+    /// @param now_us current time in microseconds
+    /// @return true if a tick was pending and a step should be run now, false otherwise
+    bool begin_step(uint32_t now_us);
+
+    /// @brief Use a fixed dt for every step instead of measuring it, for deterministic replay and testing
+    /// @param dt_us time (us) between steps, 0 to go back to measuring
+    /// @note The loop time then starts at 0 and advances by exactly dt_us per step, the tick statistics still use the real clock
+    void set_fixed_dt(uint32_t dt_us);
+
+    /// @brief Get the time of the current control step
+    /// @return a reference to the loop time, valid until the next begin_step()
+    inline const LoopTime& get_loop_time() const { return loop_time; }
+
+    /// @brief Stop timing the current control step and record overruns
+    /// @param now_us current time in microseconds
+    /// @return true if the step took longer than the tick period
+    bool end_step(uint32_t now_us);
+
+    /// @brief Get the time left until the next tick is expected to fire
+    /// @param now_us current time in microseconds
+    /// @return microseconds until the next tick, 0 if a tick is already pending or overdue
+    uint32_t time_until_tick(uint32_t now_us) const;
+
+    /// @brief Get the tick period
+    /// @return tick period in microseconds
+    inline uint32_t get_period() const { return period_us; }
+
+    /// @brief Get the timing statistics
+    /// @return a reference to the timing statistics
+    inline const ControlTickStats& get_stats() const { return stats; }
+
+private:
+    /// @brief Number of ticks fired since the last step began (written by the ISR)
+    volatile uint32_t pending_ticks = 0;
+    /// @brief Time (us) of the most recent tick (written by the ISR)
+    volatile uint32_t last_tick_us = 0;
+    /// @brief Time (us) of the oldest tick that hasn't had a step yet (written by the ISR)
+    volatile uint32_t first_pending_tick_us = 0;
+
+    /// @brief Tick period in microseconds
+    uint32_t period_us = 1000;
+    /// @brief Time (us) the current step began
+    uint32_t step_start_us = 0;
+
+    /// @brief Time of the current step
+    LoopTime loop_time{};
+    /// @brief Fixed time (us) between steps, 0 if dt is measured
+    uint32_t fixed_dt_us = 0;
+
+    /// @brief Timing statistics
+    ControlTickStats stats{};
+};
+
+#endif // CONTROL_TICK_H
@@ -0,0 +1,151 @@
+#include "logger.hpp"
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of 2");
+
+/// @brief Single character tag for each log level
+static const char LOG_LEVEL_TAGS[] = { '-', 'E', 'W', 'I', 'D' };
+
+bool Logger::push_entry(uint8_t level, const char* fmt, const LogArg* args, uint8_t num_args) {
+    uint32_t head = write_index.load(std::memory_order_relaxed);
+    uint32_t next = (head + 1) & (LOG_RING_SIZE - 1);
+
+    // full, drop the newest message rather than blocking
+    if (next == read_index.load(std::memory_order_acquire)) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    LogEntry& entry = entries[head];
+    entry.time_us = micros();
+    entry.fmt = fmt;
+    entry.level = level;
+    entry.num_args = num_args;
+    for (int i = 0; i < num_args; i++) entry.args[i] = args[i];
+
+    // publish the entry only once it's completely written
+    write_index.store(next, std::memory_order_release);
+    return true;
+}
+
+int Logger::drain(int max_lines) {
+    char line[LOG_LINE_LEN + 1];  // extra for newline
+    int lines = 0;
+
+    // report drops first so they show up next to the messages around them
+    uint32_t dropped_now = get_dropped();
+    if (dropped_now != dropped_reported) {
+        int len = snprintf(line, sizeof(line), "[W] log: dropped %u messages\n", (unsigned)(dropped_now - dropped_reported));
+        if (Serial.availableForWrite() < len) return 0;
+        Serial.write((const uint8_t*)line, len);
+        dropped_reported = dropped_now;
+        lines++;
+    }
+
+    while (lines < max_lines) {
+        uint32_t tail = read_index.load(std::memory_order_relaxed);
+        if (tail == write_index.load(std::memory_order_acquire)) break;
+
+        int len = format(tail, line, LOG_LINE_LEN);
+        line[len++] = '\n';
+
+        // leave the message queued if it would block, it'll be written next time
+        if (Serial.availableForWrite() < len) break;
+        Serial.write((const uint8_t*)line, len);
+
+        read_index.store((tail + 1) & (LOG_RING_SIZE - 1), std::memory_order_release);
+        lines++;
+    }
+
+    return lines;
+}
+
+int Logger::format(uint32_t index, char* buffer, int length) const {
+    const LogEntry& entry = entries[index & (LOG_RING_SIZE - 1)];
+    uint8_t level = entry.level < sizeof(LOG_LEVEL_TAGS) ? entry.level : 0;
+
+    int pos = snprintf(buffer, length, "[%c %lu] ", LOG_LEVEL_TAGS[level], (unsigned long)entry.time_us);
+    if (pos < 0) pos = 0;
+    if (pos > length - 1) pos = length - 1;
+
+    // walk the format string and format one conversion at a time with the matching captured argument
+    const char* f = entry.fmt;
+    int arg_index = 0;
+    while (*f && pos < length - 1) {
+        if (*f != '%') {
+            buffer[pos++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            buffer[pos++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // copy flags, width and precision, length modifiers are dropped since arguments are stored widened
+        char spec[16];
+        int spec_len = 0;
+        spec[spec_len++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && spec_len < 12) spec[spec_len++] = *f++;
+        while (*f && strchr("hlLjzt", *f)) f++;
+
+        char conversion = *f;
+        if (!conversion) break;
+        f++;
+
+        if (arg_index >= entry.num_args) break;
+        const LogArg& arg = entry.args[arg_index++];
+
+        // widen the captured argument to whatever the conversion expects
+        int64_t as_int = arg.type == LogArg::FLOAT ? (int64_t)arg.f : arg.i;
+        double as_float = arg.type == LogArg::FLOAT ? arg.f : (arg.type == LogArg::INT ? (double)arg.i : (double)arg.u);
+
+        int written = 0;
+        switch (conversion) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = conversion;
+            spec[spec_len] = '\0';
+            written = snprintf(buffer + pos, length - pos, spec, (long long)as_int);
+            break;
+        case 'c':
+            spec[spec_len++] = conversion;
+            spec[spec_len] = '\0';
+            written = snprintf(buffer + pos, length - pos, spec, (int)as_int);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            spec[spec_len++] = conversion;
+            spec[spec_len] = '\0';
+            written = snprintf(buffer + pos, length - pos, spec, as_float);
+            break;
+        case 's':
+            spec[spec_len++] = conversion;
+            spec[spec_len] = '\0';
+            written = snprintf(buffer + pos, length - pos, spec, arg.type == LogArg::STRING && arg.s ? arg.s : "(?)");
+            break;
+        case 'p':
+            spec[spec_len++] = conversion;
+            spec[spec_len] = '\0';
+            written = snprintf(buffer + pos, length - pos, spec, arg.p);
+            break;
+        default:
+            break;
+        }
+
+        if (written > 0) pos += written;
+        if (pos > length - 1) pos = length - 1;
+    }
+
+    buffer[pos] = '\0';
+    return pos;
+}
@@ -0,0 +1,164 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+// Log levels, a message is compiled in if its level is <= LOG_LEVEL
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Use this flag to set the compiled in log level globally.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE 64    // max number of queued messages, must be a power of 2
+#define LOG_MAX_ARGS 6      // max number of format arguments per message
+#define LOG_LINE_LEN 128    // max length of a formatted line
+#define LOG_DRAIN_LINES 4   // max number of lines written per call to drain()
+
+/// @brief A single captured format argument
+struct LogArg {
+    /// @brief Type of a captured argument
+    enum Type : uint8_t { INT, UINT, FLOAT, STRING, POINTER };
+
+    /// @brief Which member of the union is set
+    Type type;
+    /// @brief The captured value
+    union {
+        int64_t i;
+        uint64_t u;
+        double f;
+        const char* s;
+        const void* p;
+    };
+};
+
+/// @brief Capture a format argument by type so it can be formatted later
+/// @param value argument to capture
+/// @return the captured argument
+template <typename T>
+inline LogArg log_arg(T value) {
+    LogArg arg;
+    if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value) {
+        arg.type = LogArg::STRING;
+        arg.s = value;
+    } else if constexpr (std::is_pointer<T>::value) {
+        arg.type = LogArg::POINTER;
+        arg.p = (const void*)value;
+    } else if constexpr (std::is_floating_point<T>::value) {
+        arg.type = LogArg::FLOAT;
+        arg.f = value;
+    } else if constexpr (std::is_signed<T>::value || std::is_enum<T>::value) {
+        arg.type = LogArg::INT;
+        arg.i = (int64_t)value;
+    } else {
+        arg.type = LogArg::UINT;
+        arg.u = (uint64_t)value;
+    }
+    return arg;
+}
+
+/// @brief Non-blocking deferred logger. Messages are captured into a lock-free ring and formatted and written out when drain() is called in idle time.
+/// @note The ring is single producer single consumer: log from the main loop only (not from ISRs) and drain from the main loop.
+/// @note Formatting happens later, so %s arguments must point to static storage (string literals).
+class Logger {
+public:
+    /// @brief Default constructor, does nothing
+    Logger() = default;
+
+    /// @brief Queue a message. Use the LOG_* macros instead of calling this directly so disabled levels compile out.
+    /// @param level level of the message
+    /// @param fmt printf style format string, must be a string literal. A newline is added when it is written.
+    /// @param args format arguments
+    /// @return true if the message was queued, false if the ring was full and it was dropped
+    template <typename... Args>
+    bool push(uint8_t level, const char* fmt, Args... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+        LogArg packed[sizeof...(Args) + 1] = { log_arg(args)... };  // extra so this is never zero length
+        return push_entry(level, fmt, packed, sizeof...(Args));
+    }
+
+    /// @brief Format and write queued messages to Serial without blocking
+    /// @param max_lines max number of lines to write
+    /// @return number of lines written
+    int drain(int max_lines = LOG_DRAIN_LINES);
+
+    /// @brief Get the number of messages dropped because the ring was full
+    /// @return number of dropped messages
+    inline uint32_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    /// @brief Format a queued message into a buffer (used by drain())
+    /// @param index ring index of the message
+    /// @param buffer buffer to write to
+    /// @param length length of the buffer
+    /// @return number of characters written, not including the null terminator
+    int format(uint32_t index, char* buffer, int length) const;
+
+private:
+    /// @brief A queued message
+    struct LogEntry {
+        /// @brief Time (us) the message was queued
+        uint32_t time_us;
+        /// @brief Format string
+        const char* fmt;
+        /// @brief Level of the message
+        uint8_t level;
+        /// @brief Number of captured arguments
+        uint8_t num_args;
+        /// @brief Captured arguments
+        LogArg args[LOG_MAX_ARGS];
+    };
+
+    /// @brief Copy a message into the ring
+    /// @param level level of the message
+    /// @param fmt format string
+    /// @param args captured arguments
+    /// @param num_args number of captured arguments
+    /// @return true if the message was queued, false if it was dropped
+    bool push_entry(uint8_t level, const char* fmt, const LogArg* args, uint8_t num_args);
+
+    /// @brief Queued messages
+    LogEntry entries[LOG_RING_SIZE];
+    /// @brief Index the next message is written to (only written by the producer)
+    std::atomic<uint32_t> write_index{ 0 };
+    /// @brief Index the next message is read from (only written by the consumer)
+    std::atomic<uint32_t> read_index{ 0 };
+    /// @brief Number of messages dropped because the ring was full (only written by the producer)
+    std::atomic<uint32_t> dropped{ 0 };
+    /// @brief Number of dropped messages already reported by drain()
+    uint32_t dropped_reported = 0;
+};
+
+extern Logger logger;  // Global logger
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logger.push(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logger.push(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logger.push(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logger.push(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // LOGGER_H
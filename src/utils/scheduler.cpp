@@ -0,0 +1,73 @@
+#include "scheduler.hpp"
+
+int Scheduler::add_task(const char* name, task_fn_t fn, float rate_hz, uint8_t priority, uint32_t budget_us) {
+    if (num_tasks >= SCHEDULER_MAX_TASKS || rate_hz <= 0) return -1;
+
+    Task& task = tasks[num_tasks];
+    task.fn = fn;
+    task.period_us = (uint32_t)(1E6 / rate_hz);
+    task.next_release_us = clock();
+    task.budget_us = budget_us;
+    task.priority = priority;
+    task.stats = TaskStats{};
+    strncpy(task.name, name, SCHEDULER_MAX_NAME);
+    task.name[SCHEDULER_MAX_NAME] = '\0';  // ensure null termination
+
+    return num_tasks++;
+}
+
+bool Scheduler::run_next(uint32_t available_us) {
+    uint32_t now = clock();
+
+    // a release is missed if the task is still waiting when the release after it comes around
+    // this is counted for every task, not just the one that runs, so a task that never fits in the idle time shows up as missing
+    for (int i = 0; i < num_tasks; i++) {
+        Task& task = tasks[i];
+        while ((int32_t)(now - (task.next_release_us + task.period_us)) >= 0) {
+            task.stats.deadline_misses++;
+            task.next_release_us += task.period_us;
+        }
+    }
+
+    // find the released task with the lowest priority value that fits in the available time
+    // ties go to the task that has been waiting the longest
+    int next = -1;
+    for (int i = 0; i < num_tasks; i++) {
+        const Task& task = tasks[i];
+        // signed difference so this survives the clock wrapping around
+        int32_t waiting = (int32_t)(now - task.next_release_us);
+        if (waiting < 0) continue;
+        if (task.budget_us > available_us) continue;
+
+        if (next == -1 || task.priority < tasks[next].priority
+            || (task.priority == tasks[next].priority && waiting > (int32_t)(now - tasks[next].next_release_us))) {
+            next = i;
+        }
+    }
+
+    if (next == -1) return false;
+
+    Task& task = tasks[next];
+
+    task.next_release_us += task.period_us;
+
+    task.fn();
+
+    uint32_t exec = clock() - now;
+    task.stats.runs++;
+    task.stats.last_exec_us = exec;
+    task.stats.total_exec_us += exec;
+    if (exec > task.stats.max_exec_us) task.stats.max_exec_us = exec;
+    if (exec > task.budget_us) task.stats.budget_overruns++;
+
+    return true;
+}
+
+void Scheduler::print() {
+    for (int i = 0; i < num_tasks; i++) {
+        const Task& task = tasks[i];
+        uint32_t avg = task.stats.runs ? (uint32_t)(task.stats.total_exec_us / task.stats.runs) : 0;
+        Serial.printf("Task: %s\n  Runs: %u\n  Deadline misses: %u\n  Budget overruns: %u\n  Max: %u us\n  Avg: %u us\n",
+                        task.name, task.stats.runs, task.stats.deadline_misses, task.stats.budget_overruns, task.stats.max_exec_us, avg);
+    }
+}
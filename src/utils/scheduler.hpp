@@ -0,0 +1,94 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_TASKS 16  // max number of registered tasks
+#define SCHEDULER_MAX_NAME 16   // max length of a task name
+
+/// @brief Execution statistics for a single scheduled task
+struct TaskStats {
+    /// @brief Number of times the task has run
+    uint32_t runs = 0;
+    /// @brief Number of releases that were skipped because the task hadn't started by its deadline (the next release)
+    uint32_t deadline_misses = 0;
+    /// @brief Number of runs that took longer than the task's budget
+    uint32_t budget_overruns = 0;
+    /// @brief Execution time (us) of the last run
+    uint32_t last_exec_us = 0;
+    /// @brief Longest execution time (us) of any run
+    uint32_t max_exec_us = 0;
+    /// @brief Sum of all execution times (us), used for the average
+    uint64_t total_exec_us = 0;
+};
+
+/// @brief Cooperative multi-rate scheduler for background work that runs in the idle time between control ticks
+/// @note Tasks are plain functions that must return quickly, they are never preempted by the scheduler
+class Scheduler {
+public:
+    /// @brief Task function type
+    typedef void (*task_fn_t)();
+    /// @brief Clock function type, returns the current time in microseconds
+    typedef uint32_t (*clock_fn_t)();
+
+    /// @brief Default constructor, uses micros() as the clock
+    Scheduler() = default;
+
+    /// @brief Set the clock used to release and time tasks
+    /// @param clock function returning the current time in microseconds (a simulated clock can be passed here)
+    void set_clock(clock_fn_t clock) { this->clock = clock; }
+
+    /// @brief Register a periodic task
+    /// @param name A unique name to identify the task
+    /// @param fn Function to call every period
+    /// @param rate_hz Rate to run the task at (Hz)
+    /// @param priority Priority of the task, lower values run first
+    /// @param budget_us Worst case execution time (us) of the task, it is only started if this much time is available
+    /// @return ID of the task, or -1 if there are no free task slots
+    int add_task(const char* name, task_fn_t fn, float rate_hz, uint8_t priority, uint32_t budget_us);
+
+    /// @brief Run the most urgent task that is released and fits in the available time
+    /// @param available_us Time (us) left before the control step needs the CPU
+    /// @return true if a task was run, false if there was nothing to run
+    bool run_next(uint32_t available_us);
+
+    /// @brief Get the statistics of a task
+    /// @param id ID of the task returned by add_task()
+    /// @return a reference to the task statistics
+    const TaskStats& get_stats(int id) const { return tasks[id].stats; }
+
+    /// @brief Get the number of registered tasks
+    /// @return number of tasks
+    inline int get_num_tasks() const { return num_tasks; }
+
+    /// @brief Print the statistics of all tasks
+    void print();
+
+private:
+    /// @brief A registered task
+    struct Task {
+        /// @brief Function to run
+        task_fn_t fn = nullptr;
+        /// @brief Period between releases (us)
+        uint32_t period_us = 0;
+        /// @brief Time (us) the task is next released at
+        uint32_t next_release_us = 0;
+        /// @brief Worst case execution time (us)
+        uint32_t budget_us = 0;
+        /// @brief Priority, lower values run first
+        uint8_t priority = 0;
+        /// @brief Execution statistics
+        TaskStats stats{};
+        /// @brief A unique name to identify the task
+        char name[SCHEDULER_MAX_NAME + 1] = { 0 };  // extra for null terminator
+    };
+
+    /// @brief Registered tasks
+    Task tasks[SCHEDULER_MAX_TASKS];
+    /// @brief Number of registered tasks
+    int num_tasks = 0;
+    /// @brief Clock used to release and time tasks
+    clock_fn_t clock = micros;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,63 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal stand-in for the Teensy core so hardware independent code can be built and unit tested on the host.
+// Only what the code under test needs is here, anything that talks to hardware doesn't belong in a host test.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+/// @brief Fake microsecond clock, tests set this directly
+inline uint32_t host_micros = 0;
+
+inline uint32_t micros() { return host_micros; }
+inline uint32_t millis() { return host_micros / 1000; }
+
+#define F_CPU 600000000 // Teensy 4.1 core clock, for the cycle count conversions in utils/timing.hpp
+
+/// @brief Fake cycle counter, tests set this directly
+inline uint32_t host_cycle_count = 0;
+#define ARM_DWT_CYCCNT host_cycle_count
+
+// there are no interrupts on the host, the test drives "ISR" calls itself
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/// @brief Serial port that prints to stdout
+struct HostSerial {
+    int printf(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vprintf(fmt, args);
+        va_end(args);
+        return n;
+    }
+    void print(const char* s) { fputs(s, stdout); }
+    void println(const char* s = "") { puts(s); }
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+    int availableForWrite() { return 64; }
+    void flush() { fflush(stdout); }
+    operator bool() { return true; }
+};
+
+inline HostSerial Serial;
+
+// only named in the declarations of hardware code, never used on the host
+class HardwareSerial;
+
+#endif // HOST_ARDUINO_H
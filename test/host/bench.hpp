@@ -0,0 +1,42 @@
+#ifndef HOST_BENCH_HPP
+#define HOST_BENCH_HPP
+
+// Tiny timing helper for the host tests. Host numbers only show the relative cost of two code paths,
+// the Teensy's absolute timings are different
+
+#include <chrono>
+#include <stdio.h>
+
+#define BENCH_ROUNDS 5 // rounds timed per measurement, the fastest is kept to skip scheduler noise
+
+/// @brief Keep the optimizer from dropping a result that is only computed to be timed
+/// @param value result to keep
+template <typename T>
+inline void bench_keep(const T& value) { asm volatile("" : : "g"(&value) : "memory"); }
+
+/// @brief Time a function
+/// @param fn function to time
+/// @param iterations calls per round
+/// @return time per call (ns) of the fastest round
+template <typename F>
+double bench_ns(F&& fn, int iterations) {
+    double best = 1e30;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) fn();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+/// @brief Print the timing of an old and a new code path side by side
+/// @param name what was measured
+/// @param old_ns time per call (ns) of the old path
+/// @param new_ns time per call (ns) of the new path
+inline void bench_report(const char* name, double old_ns, double new_ns) {
+    printf("[bench] %s: old %.1f ns, new %.1f ns (%.2fx)\n", name, old_ns, new_ns, old_ns / new_ns);
+}
+
+#endif // HOST_BENCH_HPP
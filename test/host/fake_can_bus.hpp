@@ -0,0 +1,66 @@
+#ifndef FAKE_CAN_BUS_HPP
+#define FAKE_CAN_BUS_HPP
+
+#include "comms/can_bus.hpp"
+
+#define FAKE_CAN_MAX_FRAMES 64 // frames a FakeCANBus remembers, later writes are only counted
+
+/// @brief CANBus that records what rm_CAN does to it and lets a test inject received frames
+class FakeCANBus : public CANBus {
+public:
+    void init(uint32_t baud_rate, can_receive_fn_t handler) override {
+        this->baud_rate = baud_rate;
+        this->handler = handler;
+    }
+
+    CANWriteResult write(const CANFrame& frame) override {
+        if (write_result == CAN_WRITE_SENT || write_result == CAN_WRITE_QUEUED) {
+            if (num_sent < FAKE_CAN_MAX_FRAMES) sent[num_sent] = frame;
+            num_sent++;
+        }
+        return write_result;
+    }
+
+    void set_filters(const uint32_t* ids, int num_ids) override {
+        num_filters = num_ids;
+        for (int i = 0; i < num_ids && i < 8; i++) filter_ids[i] = ids[i];
+    }
+
+    uint32_t get_tx_error_counter() override { return tx_error_counter; }
+
+    /// @brief Deliver a frame to the receive handler as if it arrived on this bus
+    /// @param bus FlexCAN bus number (1 for CAN1)
+    /// @param id frame ID
+    /// @param data frame data
+    /// @param extended whether id is an extended ID
+    void inject(uint8_t bus, uint32_t id, const uint8_t data[CAN_FRAME_SIZE], bool extended = false) {
+        CANFrame frame;
+        frame.id = id;
+        frame.extended = extended;
+        frame.bus = bus;
+        memcpy(frame.buf, data, CAN_FRAME_SIZE);
+        if (handler) handler(frame);
+    }
+
+    /// @brief baud rate given to init(), 0 until then
+    uint32_t baud_rate = 0;
+    /// @brief handler given to init()
+    can_receive_fn_t handler = nullptr;
+
+    /// @brief first FAKE_CAN_MAX_FRAMES frames written
+    CANFrame sent[FAKE_CAN_MAX_FRAMES];
+    /// @brief number of frames sent or queued
+    int num_sent = 0;
+    /// @brief what write() reports, frames are only recorded when it is sent or queued
+    CANWriteResult write_result = CAN_WRITE_SENT;
+
+    /// @brief IDs of the last set_filters() call
+    uint32_t filter_ids[8] = { 0 };
+    /// @brief number of filters in the last set_filters() call, -1 if it was never called
+    int num_filters = -1;
+
+    /// @brief reported by get_tx_error_counter()
+    uint32_t tx_error_counter = 0;
+};
+
+#endif // FAKE_CAN_BUS_HPP
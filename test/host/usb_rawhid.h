@@ -0,0 +1,13 @@
+#ifndef HOST_USB_RAWHID_H
+#define HOST_USB_RAWHID_H
+
+// Stand-in for the Teensy core's raw HID functions so headers that include the comms layer build on the host.
+// There is no USB on the host, nothing is ever received and every send is dropped.
+
+#include <stdint.h>
+
+inline int usb_rawhid_available() { return 0; }
+inline int usb_rawhid_recv(void* buffer, uint32_t timeout) { return 0; }
+inline int usb_rawhid_send(const void* buffer, uint32_t timeout) { return 0; }
+
+#endif // HOST_USB_RAWHID_H
@@ -0,0 +1,94 @@
+#include <unity.h>
+
+#include "comms/rm_can.hpp"
+#include "utils/logger.hpp"
+#include "bench.hpp"
+
+Logger logger;
+
+static CANData can_data;
+static uint32_t seed;
+
+void setUp() {
+    memset(&can_data, 0, sizeof(can_data));
+    seed = 1;
+}
+
+void tearDown() {}
+
+/// @brief Deterministic pseudo random number
+static uint32_t rand_u32() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/// @brief Fill every motor's mailbox with random feedback and decode it like the receive ISR does
+static void fill_random_feedback(uint32_t now_us) {
+    for (int bus = 0; bus < NUM_CAN_BUSES; bus++) {
+        for (int slot = 0; slot < NUM_MOTORS_PER_BUS; slot++) {
+            uint8_t* frame = can_data.data[bus][slot];
+            uint16_t angle = rand_u32() % MOTOR_ANGLE_RESOLUTION;
+            int16_t rpm = (int16_t)(rand_u32() % 20000) - 10000;
+            int16_t current = (int16_t)(rand_u32() % 32000) - 16000;
+            frame[0] = angle >> 8;
+            frame[1] = angle & 0xff;
+            frame[2] = (uint16_t)rpm >> 8;
+            frame[3] = rpm & 0xff;
+            frame[4] = (uint16_t)current >> 8;
+            frame[5] = current & 0xff;
+            frame[6] = rand_u32() % 80;
+            can_data.decode(bus, slot, now_us);
+        }
+    }
+}
+
+void test_arrays_match_raw_frames() {
+    fill_random_feedback(0);
+    for (int bus = 0; bus < NUM_CAN_BUSES; bus++) {
+        for (int motor = 1; motor <= NUM_MOTORS_PER_BUS; motor++) {
+            int index = can_motor_index(bus, motor);
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, can_data.get_motor_attribute(bus, motor, MotorAttribute::ANGLE) * (float)(2 * PI / MOTOR_ANGLE_RESOLUTION), can_data.angle[index]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-3f, can_data.get_motor_attribute(bus, motor, MotorAttribute::SPEED) * (float)(2 * PI / 60), can_data.velocity[index]);
+            TEST_ASSERT_EQUAL_FLOAT(can_data.get_motor_attribute(bus, motor, MotorAttribute::TORQUE), can_data.current[index]);
+            TEST_ASSERT_EQUAL_FLOAT(can_data.get_motor_attribute(bus, motor, MotorAttribute::TEMP), can_data.temperature[index]);
+        }
+    }
+}
+
+void test_bench_velocity_read() {
+    fill_random_feedback(0);
+    float output[NUM_MOTORS];
+
+    // what LocalEstimator did every step before: parse every frame's speed field and convert it
+    double old_ns = bench_ns([&]() {
+        for (int i = 0; i < NUM_CAN_BUSES; i++) {
+            for (int j = 0; j < NUM_MOTORS_PER_BUS; j++) {
+                output[(i * NUM_MOTORS_PER_BUS) + j] = (can_data.get_motor_attribute(i, j + 1, MotorAttribute::SPEED) / 60) * 2 * PI;
+            }
+        }
+        bench_keep(output);
+    }, 200000);
+
+    // now: the frames were decoded on arrival, the step copies the array
+    double new_ns = bench_ns([&]() {
+        for (int i = 0; i < NUM_MOTORS; i++) output[i] = can_data.velocity[i];
+        bench_keep(output);
+    }, 200000);
+    bench_report("velocity of every motor per control step", old_ns, new_ns);
+
+    // the work moved to the receive ISR, once per frame instead of once per read
+    double decode_ns = bench_ns([&]() {
+        can_data.decode(0, 0, 0);
+        bench_keep(can_data);
+    }, 200000);
+    printf("[bench] decode of one feedback frame in the receive ISR: %.1f ns\n", decode_ns);
+
+    TEST_ASSERT_TRUE(new_ns > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_arrays_match_raw_frames);
+    RUN_TEST(test_bench_velocity_read);
+    return UNITY_END();
+}
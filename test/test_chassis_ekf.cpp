@@ -0,0 +1,182 @@
+#include <unity.h>
+
+#include "filters/chassis_ekf.hpp"
+
+#define DT 0.001f             // control step (s)
+#define POD_ANGLE 0.1745f     // odometry pods are turned 10 degrees like on the robot
+#define POD_LEVER 0.1f        // odometry pod speed per rad/s of chassis rotation (m)
+#define MECANUM_ARM 0.35f     // mecanum wheel surface speed per rad/s of chassis rotation (m)
+#define NUM_WHEELS 4
+
+// mecanum wheel surface speed per m/s of chassis x, y and per rad/s of rotation (front left, front right, back left, back right)
+static const float wheel_rows[NUM_WHEELS][3] = {
+    { 1, -1, -MECANUM_ARM },
+    { 1, 1, MECANUM_ARM },
+    { 1, 1, -MECANUM_ARM },
+    { 1, -1, MECANUM_ARM },
+};
+
+// rolling direction (x, y) and lever of each odometry pod
+static const float pod_rows[2][3] = {
+    { cosf(POD_ANGLE), sinf(POD_ANGLE), -POD_LEVER },
+    { -sinf(POD_ANGLE), cosf(POD_ANGLE), -POD_LEVER },
+};
+
+/// @brief Simulated mecanum chassis: ground truth pose and chassis frame velocity, and the sensors the estimator reads
+struct SimChassis {
+    float x = 0, y = 0, psi = 0;
+    float vx = 0, vy = 0, omega = 0;
+    uint32_t seed = 1;
+
+    /// @brief Deterministic pseudo random number in [lo, hi)
+    float rand_range(float lo, float hi) {
+        seed = seed * 1664525u + 1013904223u;
+        return lo + (hi - lo) * ((seed >> 8) / (float)(1u << 24));
+    }
+
+    /// @brief Drive along a smooth path that keeps changing speed, direction and rotation
+    void step(float t) {
+        vx = 1.5f * sinf(0.5f * t);
+        vy = 1.0f * cosf(0.3f * t);
+        omega = 2.0f * sinf(0.2f * t);
+        float c = cosf(psi);
+        float s = sinf(psi);
+        x += (vx * c - vy * s) * DT;
+        y += (vx * s + vy * c) * DT;
+        psi += omega * DT;
+        if (psi >= (float)M_PI) psi -= 2 * (float)M_PI;
+        if (psi < -(float)M_PI) psi += 2 * (float)M_PI;
+    }
+
+    float gyro() { return omega + rand_range(-0.02f, 0.02f); }
+    float pod(int i) { return pod_rows[i][0] * vx + pod_rows[i][1] * vy + pod_rows[i][2] * omega + rand_range(-0.015f, 0.015f); }
+    float wheel(int i) { return wheel_rows[i][0] * vx + wheel_rows[i][1] * vy + wheel_rows[i][2] * omega + rand_range(-0.2f, 0.2f); }
+};
+
+/// @brief Wrap an angle difference into [-pi, pi)
+static float wrap_angle(float a) {
+    while (a >= (float)M_PI) a -= 2 * (float)M_PI;
+    while (a < -(float)M_PI) a += 2 * (float)M_PI;
+    return a;
+}
+
+/// @brief Run the filter against the simulated chassis, feeding every sensor each step like ChassisEstimator
+/// @param seconds length of the run (s)
+/// @param slip_wheel wheel that loses grip and spins faster than the ground, -1 for none
+/// @param slip_start when the wheel starts slipping (s)
+/// @param slip_end when it grips again (s)
+/// @param use_pods whether the odometry pods are fused
+/// @return number of wheel readings dropped as slip
+static int run(SimChassis& sim, ChassisEKF& ekf, float seconds, int slip_wheel, float slip_start, float slip_end, bool use_pods) {
+    int dropped = 0;
+    int steps = (int)(seconds / DT);
+    for (int i = 0; i < steps; i++) {
+        float t = i * DT;
+        sim.step(t);
+
+        ekf.predict(DT);
+        ekf.update_yaw_rate(sim.gyro());
+        if (use_pods) {
+            for (int p = 0; p < 2; p++) ekf.update_pod(pod_rows[p][0], pod_rows[p][1], pod_rows[p][2], sim.pod(p));
+        }
+        for (int w = 0; w < NUM_WHEELS; w++) {
+            float speed = sim.wheel(w);
+            if (w == slip_wheel && t >= slip_start && t < slip_end) speed += 1.5f;
+            if (!ekf.update_wheel(wheel_rows[w][0], wheel_rows[w][1], wheel_rows[w][2], speed)) dropped++;
+        }
+    }
+    return dropped;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_tracks_pose_without_slip() {
+    SimChassis sim;
+    ChassisEKF ekf;
+    run(sim, ekf, 20, -1, 0, 0, true);
+
+    const float* state = ekf.get_state();
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.x, state[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.y, state[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, wrap_angle(sim.psi - state[2]));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.vx, state[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.vy, state[4]);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.omega, state[5]);
+}
+
+void test_slipping_wheel_is_dropped() {
+    SimChassis sim;
+    ChassisEKF ekf;
+    int dropped = run(sim, ekf, 20, 0, 5, 8, true);
+
+    // nearly every reading of the 3 s of slip is dropped, and few others are
+    int slip_steps = (int)(3 / DT);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT(slip_steps * 95 / 100, dropped);
+    TEST_ASSERT_LESS_OR_EQUAL_INT(slip_steps + slip_steps / 10, dropped);
+
+    const float* state = ekf.get_state();
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.x, state[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, sim.y, state[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, wrap_angle(sim.psi - state[2]));
+}
+
+void test_wheels_and_gyro_alone_ride_through_slip() {
+    // without the pods the three gripping wheels and the gyro still pin down the velocity
+    SimChassis sim;
+    ChassisEKF ekf;
+    int dropped = run(sim, ekf, 20, 2, 5, 8, false);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT((int)(3 / DT) * 9 / 10, dropped);
+
+    const float* state = ekf.get_state();
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, sim.x, state[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, sim.y, state[1]);
+}
+
+void test_pose_variance_grows_without_position_fixes() {
+    // turning moves variance between x and y, so the position is checked as a whole
+    SimChassis sim;
+    ChassisEKF ekf;
+    float previous_position = ekf.get_covariance(0, 0) + ekf.get_covariance(1, 1);
+    float previous_heading = ekf.get_covariance(2, 2);
+
+    for (int second = 0; second < 5; second++) {
+        run(sim, ekf, 1, -1, 0, 0, true);
+        float position = ekf.get_covariance(0, 0) + ekf.get_covariance(1, 1);
+        float heading = ekf.get_covariance(2, 2);
+        TEST_ASSERT_GREATER_THAN_FLOAT(previous_position, position);
+        TEST_ASSERT_GREATER_THAN_FLOAT(previous_heading, heading);
+        previous_position = position;
+        previous_heading = heading;
+    }
+
+    // the covariance stays symmetric
+    for (int i = 0; i < CHASSIS_EKF_STATES; i++) {
+        for (int j = 0; j < CHASSIS_EKF_STATES; j++) TEST_ASSERT_FLOAT_WITHIN(1e-6f, ekf.get_covariance(i, j), ekf.get_covariance(j, i));
+    }
+}
+
+void test_set_pose_keeps_velocity() {
+    SimChassis sim;
+    ChassisEKF ekf;
+    run(sim, ekf, 3, -1, 0, 0, true);
+    float vx = ekf.get_state()[3];
+    float omega = ekf.get_state()[5];
+
+    ekf.set_pose(1, 2, 0.5f);
+    TEST_ASSERT_EQUAL_FLOAT(1, ekf.get_state()[0]);
+    TEST_ASSERT_EQUAL_FLOAT(2, ekf.get_state()[1]);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, ekf.get_state()[2]);
+    TEST_ASSERT_EQUAL_FLOAT(vx, ekf.get_state()[3]);
+    TEST_ASSERT_EQUAL_FLOAT(omega, ekf.get_state()[5]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tracks_pose_without_slip);
+    RUN_TEST(test_slipping_wheel_is_dropped);
+    RUN_TEST(test_wheels_and_gyro_alone_ride_through_slip);
+    RUN_TEST(test_pose_variance_grows_without_position_fixes);
+    RUN_TEST(test_set_pose_keeps_velocity);
+    return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#include <unity.h>
+
+#include "utils/control_tick.hpp"
+
+#define PERIOD_US 1000
+
+static ControlTick control_tick;
+/// @brief fake clock (us), advanced by the tests
+static uint32_t now_us;
+
+void setUp() {
+    now_us = 0;
+    control_tick.set_fixed_dt(0);
+    control_tick.init(PERIOD_US, now_us);
+}
+
+void tearDown() {}
+
+/// @brief Advance the fake clock and fire the timer "ISR" at every tick on the way
+static void advance(uint32_t us) {
+    uint32_t end = now_us + us;
+    uint32_t next_tick = now_us + (PERIOD_US - (now_us % PERIOD_US));
+    while ((int32_t)(end - next_tick) >= 0) {
+        now_us = next_tick;
+        control_tick.tick(now_us);
+        next_tick += PERIOD_US;
+    }
+    now_us = end;
+}
+
+void test_no_step_without_tick() {
+    TEST_ASSERT_FALSE(control_tick.begin_step(now_us));
+    advance(PERIOD_US - 1);
+    TEST_ASSERT_FALSE(control_tick.begin_step(now_us));
+    TEST_ASSERT_EQUAL_UINT32(0, control_tick.get_stats().steps);
+}
+
+void test_on_time_steps() {
+    advance(PERIOD_US);
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+        advance(300);
+        TEST_ASSERT_FALSE(control_tick.end_step(now_us));
+        // the next tick is 700 us away, nothing runs until it fires
+        TEST_ASSERT_EQUAL_UINT32(PERIOD_US - 300, control_tick.time_until_tick(now_us));
+        advance(PERIOD_US - 300 - 1);
+        TEST_ASSERT_FALSE(control_tick.begin_step(now_us));
+        advance(1);
+    }
+
+    const ControlTickStats& stats = control_tick.get_stats();
+    TEST_ASSERT_EQUAL_UINT32(10, stats.steps);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.missed_ticks);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.max_jitter_us);
+    TEST_ASSERT_EQUAL_UINT32(300, stats.max_exec_us);
+}
+
+void test_late_step_records_jitter() {
+    advance(PERIOD_US + 120);
+    TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+    TEST_ASSERT_EQUAL_UINT32(120, control_tick.get_stats().last_jitter_us);
+    TEST_ASSERT_EQUAL_FLOAT(0.00112f, control_tick.get_loop_time().dt);
+    control_tick.end_step(now_us);
+
+    TEST_ASSERT_EQUAL_UINT32(0, control_tick.time_until_tick(now_us + PERIOD_US));
+}
+
+void test_overrun_counts_missed_ticks_and_full_jitter() {
+    advance(PERIOD_US);
+    TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+
+    // the step runs for 3.5 periods, three ticks fire during it
+    advance(3 * PERIOD_US + 500);
+    TEST_ASSERT_TRUE(control_tick.end_step(now_us));
+    TEST_ASSERT_EQUAL_UINT32(0, control_tick.time_until_tick(now_us));
+
+    TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+    const ControlTickStats& stats = control_tick.get_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.missed_ticks);
+    // measured from the oldest of the three ticks, not the newest
+    TEST_ASSERT_EQUAL_UINT32(2 * PERIOD_US + 500, stats.last_jitter_us);
+    TEST_ASSERT_EQUAL_UINT32(2 * PERIOD_US + 500, stats.max_jitter_us);
+    TEST_ASSERT_EQUAL_UINT32(3 * PERIOD_US + 500, stats.max_exec_us);
+
+    // back on time, the max is kept
+    control_tick.end_step(now_us);
+    advance(PERIOD_US - 500);
+    TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.last_jitter_us);
+    TEST_ASSERT_EQUAL_UINT32(2 * PERIOD_US + 500, stats.max_jitter_us);
+}
+
+void test_time_until_tick_across_clock_wrap() {
+    now_us = UINT32_MAX - 1500;
+    control_tick.init(PERIOD_US, now_us);
+    now_us += 800;
+    TEST_ASSERT_EQUAL_UINT32(200, control_tick.time_until_tick(now_us));
+
+    control_tick.tick(now_us + 200);
+    now_us += 250;
+    TEST_ASSERT_EQUAL_UINT32(0, control_tick.time_until_tick(now_us));
+    TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+    TEST_ASSERT_EQUAL_UINT32(50, control_tick.get_stats().last_jitter_us);
+
+    // the next tick lands past the wrap
+    TEST_ASSERT_EQUAL_UINT32(950, control_tick.time_until_tick(now_us));
+}
+
+void test_fixed_dt() {
+    control_tick.set_fixed_dt(2000);
+    for (int i = 1; i <= 5; i++) {
+        // real timing is irregular, the loop time isn't
+        advance(PERIOD_US + (i % 2) * 400);
+        TEST_ASSERT_TRUE(control_tick.begin_step(now_us));
+        TEST_ASSERT_EQUAL_UINT32(2000 * i, control_tick.get_loop_time().now_us);
+        TEST_ASSERT_EQUAL_FLOAT(0.002f, control_tick.get_loop_time().dt);
+        control_tick.end_step(now_us);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_step_without_tick);
+    RUN_TEST(test_on_time_steps);
+    RUN_TEST(test_late_step_records_jitter);
+    RUN_TEST(test_overrun_counts_missed_ticks_and_full_jitter);
+    RUN_TEST(test_time_until_tick_across_clock_wrap);
+    RUN_TEST(test_fixed_dt);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+// before unity.h, utils/timing.hpp defines its own UINT_MAX and limits.h replaces it cleanly
+#include "controls/controller_manager.hpp"
+#include <unity.h>
+
+#include "utils/logger.hpp"
+#include "bench.hpp"
+
+Logger logger;
+
+// the chassis controllers read the power buffer from the referee system, its real constructor lives with the serial code
+RefSystem::RefSystem() {}
+RefSystem ref;
+
+#define DT 0.001f // control step (s)
+
+static Config config;
+static uint32_t seed;
+
+/// @brief Deterministic pseudo random number in [lo, hi)
+static float rand_range(float lo, float hi) {
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((seed >> 8) / (float)(1u << 24));
+}
+
+/// @brief Give a motor a controller on one level with PID gains
+static void set_controller(int motor, int level, int type, float kp, float ki, float kd) {
+    config.controller_types[motor][level] = type;
+    config.gains[motor][level][0] = kp;
+    config.gains[motor][level][1] = ki;
+    config.gains[motor][level][2] = kd;
+}
+
+/// @brief A standard robot: four mecanum drive motors, a gimbal, a feeder and two flywheels. Every other motor slot is unused
+static void make_config() {
+    config = Config();
+    const float wheel_x[4] = { 0, 1, 0, -1 };
+    const float wheel_y[4] = { 1, 0, -1, 0 };
+    for (int i = 0; i < 4; i++) {
+        // chassis velocity to wheel velocity, then a power limited wheel velocity loop
+        config.kinematics_v[i][0] = wheel_x[i] * 20;
+        config.kinematics_v[i][1] = wheel_y[i] * 20;
+        config.kinematics_v[i][2] = 4;
+        set_controller(i, 0, 2, 1.5f, 0.1f, 0);
+        set_controller(i, 1, 4, 0.002f, 0.0001f, 0);
+    }
+
+    // yaw and pitch: position and velocity feedback straight to current
+    config.kinematics_p[4][3] = 1;
+    config.kinematics_v[4][3] = 1;
+    set_controller(4, 2, 3, 2, 0, 0.1f);
+    config.gains[4][2][4] = 0.3f;
+    config.kinematics_p[5][4] = 1;
+    config.kinematics_v[5][4] = 1;
+    set_controller(5, 2, 3, 3, 0.01f, 0.2f);
+    config.gains[5][2][4] = 0.2f;
+
+    // feeder and flywheels: state velocity to motor velocity, then a plain velocity PID
+    config.kinematics_v[8][5] = 36;
+    set_controller(8, 0, 2, 1, 0, 0);
+    set_controller(8, 1, 2, 0.001f, 0.0002f, 0);
+    for (int i = 9; i < 11; i++) {
+        config.kinematics_v[i][6] = i == 9 ? 60 : -60;
+        set_controller(i, 0, 2, 1, 0, 0);
+        set_controller(i, 1, 5, 0.0005f, 0.0001f, 0);
+        config.gains[i][1][3] = 0.00003f;
+    }
+}
+
+/// @brief Old ControllerManager::step: walks every motor and state on every level, null controllers included
+struct DenseControllers {
+    Controller* controllers[NUM_MOTORS][NUM_CONTROLLER_LEVELS];
+
+    void init() {
+        for (int m = 0; m < NUM_MOTORS; m++) {
+            for (int k = 0; k < NUM_CONTROLLER_LEVELS; k++) {
+                switch ((int)config.controller_types[m][k]) {
+                case 2: controllers[m][k] = new PIDVelocityController(k); break;
+                case 3: controllers[m][k] = new FullStateFeedbackController(k); break;
+                case 4: controllers[m][k] = new ChassisPIDVelocityController(k); break;
+                case 5: controllers[m][k] = new PIDFVelocityController(k); break;
+                default: controllers[m][k] = new NullController(); break;
+                }
+                controllers[m][k]->set_gains(config.gains[m][k]);
+            }
+        }
+    }
+
+    void step(float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float micro_estimate[NUM_MOTORS][MICRO_STATE_LEN], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float outputs[NUM_MOTORS], float dt) {
+        float micro_reference[NUM_MOTORS];
+        for (int m = 0; m < NUM_MOTORS; m++) {
+            outputs[m] = 0;
+            micro_reference[m] = macro_step(m, 0, macro_reference, macro_estimate, kinematics_p, kinematics_v, dt);
+        }
+        for (int m = 0; m < NUM_MOTORS; m++) outputs[m] += controllers[m][1]->step(micro_reference[m], micro_estimate[m], dt);
+        for (int m = 0; m < NUM_MOTORS; m++) outputs[m] += macro_step(m, 2, macro_reference, macro_estimate, kinematics_p, kinematics_v, dt);
+    }
+
+    float macro_step(int m, int level, float macro_reference[STATE_LEN][3], float macro_estimate[STATE_LEN][3], float kinematics_p[NUM_MOTORS][STATE_LEN], float kinematics_v[NUM_MOTORS][STATE_LEN], float dt) {
+        float output = 0;
+        for (int j = 0; j < STATE_LEN; j++) {
+            if (kinematics_v[m][j] == 0 && kinematics_p[m][j] == 0) continue;
+            float reference[3] = { macro_reference[j][0] * kinematics_p[m][j], macro_reference[j][1] * kinematics_v[m][j], 0 };
+            float estimate[3] = { macro_estimate[j][0] * kinematics_p[m][j], macro_estimate[j][1] * kinematics_v[m][j], 0 };
+            output += controllers[m][level]->step(reference, estimate, dt);
+        }
+        return output;
+    }
+};
+
+static float macro_reference[STATE_LEN][3];
+static float macro_estimate[STATE_LEN][3];
+static float micro_estimate[NUM_MOTORS][MICRO_STATE_LEN];
+static float kinematics_p[NUM_MOTORS][STATE_LEN];
+static float kinematics_v[NUM_MOTORS][STATE_LEN];
+
+/// @brief New random references and estimates, and the chassis turned to a random angle like main() does every loop
+static void randomize_inputs() {
+    for (int j = 0; j < STATE_LEN; j++) {
+        for (int k = 0; k < 3; k++) {
+            macro_reference[j][k] = rand_range(-1, 1);
+            macro_estimate[j][k] = rand_range(-1, 1);
+        }
+    }
+    for (int m = 0; m < NUM_MOTORS; m++) micro_estimate[m][0] = rand_range(-50, 50);
+
+    float angle = rand_range(-PI, PI);
+    for (int m = 0; m < 4; m++) {
+        float x = config.kinematics_v[m][0] / 20;
+        float y = config.kinematics_v[m][1] / 20;
+        kinematics_v[m][0] = (x * cosf(angle) - y * sinf(angle)) * 20;
+        kinematics_v[m][1] = (x * sinf(angle) + y * cosf(angle)) * 20;
+    }
+}
+
+static ControllerManager* manager;
+static DenseControllers dense;
+
+void setUp() {
+    seed = 1;
+    make_config();
+    memcpy(kinematics_p, config.kinematics_p, sizeof(kinematics_p));
+    memcpy(kinematics_v, config.kinematics_v, sizeof(kinematics_v));
+
+    bool wrap[STATE_LEN] = { false };
+    manager = new ControllerManager();
+    manager->init(&config, wrap);
+    for (int m = 0; m < 4; m++) {
+        manager->add_kinematics_entry(m, 0);
+        manager->add_kinematics_entry(m, 1);
+    }
+    dense.init();
+}
+
+void tearDown() { delete manager; }
+
+void test_plan_matches_dense_step() {
+    LoopTime time;
+    time.dt = DT;
+    for (int i = 0; i < 500; i++) {
+        randomize_inputs();
+        float expected[NUM_MOTORS];
+        float outputs[NUM_MOTORS];
+        dense.step(macro_reference, macro_estimate, micro_estimate, kinematics_p, kinematics_v, expected, DT);
+        manager->step(macro_reference, macro_estimate, micro_estimate, kinematics_p, kinematics_v, outputs, time);
+        for (int m = 0; m < NUM_MOTORS; m++) TEST_ASSERT_FLOAT_WITHIN(1e-4f * (1 + fabsf(expected[m])), expected[m], outputs[m]);
+    }
+}
+
+void test_bench_step() {
+    LoopTime time;
+    time.dt = DT;
+    float outputs[NUM_MOTORS];
+    randomize_inputs();
+
+    double old_ns = bench_ns([&]() {
+        dense.step(macro_reference, macro_estimate, micro_estimate, kinematics_p, kinematics_v, outputs, DT);
+        bench_keep(outputs);
+    }, 20000);
+    double new_ns = bench_ns([&]() {
+        manager->step(macro_reference, macro_estimate, micro_estimate, kinematics_p, kinematics_v, outputs, time);
+        bench_keep(outputs);
+    }, 20000);
+    bench_report("ControllerManager::step, 9 of 24 motors in use", old_ns, new_ns);
+
+    TEST_ASSERT_TRUE(new_ns > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_plan_matches_dense_step);
+    RUN_TEST(test_bench_step);
+    return UNITY_END();
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+
+#include "filters/gimbal_geometry.hpp"
+#include "bench.hpp"
+
+/// @brief Yaw and pitch axis configs: level, tilted forward, yaw axis leaning to -x, and yaw axis with no x component
+static const float yaw_axes[][3] = { { 0, 0, 1 }, { 0.1f, -0.05f, 0.99f }, { -0.2f, 0.1f, 0.97f }, { 0, 0.3f, 0.95f } };
+static const float pitch_axes[][3] = { { 1, 0, 0 }, { 0.98f, 0.05f, -0.1f }, { 0, 1, 0 }, { 2, 0, 0.1f } };
+#define NUM_CONFIGS 4
+#define STARTING_PITCH 0.12f // pitch encoder angle at the yaw axis calibration
+
+/// @brief The axis math the gimbal estimators ran every step before GimbalGeometry
+struct OldGeometry {
+    float yaw_axis[3];
+    float pitch_axis[3];
+    float roll_axis[3];
+
+    void compute(const float yaw_axis_vector[3], const float pitch_axis_vector[3], float starting_pitch_angle, float pitch_enc_angle) {
+        float pitch_diff = starting_pitch_angle - pitch_enc_angle;
+
+        float yaw_axis_spherical[3];
+        yaw_axis_spherical[0] = 1;
+        if (yaw_axis_vector[0] == 0)
+            yaw_axis_spherical[1] = 1.57;
+        else if (yaw_axis_vector[0] < 0)
+            yaw_axis_spherical[1] = M_PI + atan(yaw_axis_vector[1] / yaw_axis_vector[0]);
+        else
+            yaw_axis_spherical[1] = atan(yaw_axis_vector[1] / yaw_axis_vector[0]);
+        float yaw_mag = sqrt(pow(yaw_axis_vector[0], 2) + pow(yaw_axis_vector[1], 2) + pow(yaw_axis_vector[2], 2));
+        yaw_axis_spherical[2] = acos(yaw_axis_vector[2] / yaw_mag) - pitch_diff;
+
+        yaw_axis[0] = yaw_axis_spherical[0] * cos(yaw_axis_spherical[1]) * sin(yaw_axis_spherical[2]);
+        yaw_axis[1] = yaw_axis_spherical[0] * sin(yaw_axis_spherical[1]) * sin(yaw_axis_spherical[2]);
+        yaw_axis[2] = yaw_axis_spherical[0] * cos(yaw_axis_spherical[2]);
+
+        float mag = sqrt(pow(pitch_axis_vector[0], 2) + pow(pitch_axis_vector[1], 2) + pow(pitch_axis_vector[2], 2));
+        for (int i = 0; i < 3; i++) pitch_axis[i] = pitch_axis_vector[i] / mag;
+
+        // roll = pitch x yaw, the rotations by 0 rad that followed left the axes unchanged
+        roll_axis[0] = pitch_axis[1] * yaw_axis[2] - pitch_axis[2] * yaw_axis[1];
+        roll_axis[1] = -(pitch_axis[0] * yaw_axis[2] - pitch_axis[2] * yaw_axis[0]);
+        roll_axis[2] = pitch_axis[0] * yaw_axis[1] - pitch_axis[1] * yaw_axis[0];
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+/// @brief Largest difference between two vectors on any axis
+static float max_difference(const float a[3], const float b[3]) {
+    float diff = 0;
+    for (int i = 0; i < 3; i++) diff = fmaxf(diff, fabsf(a[i] - b[i]));
+    return diff;
+}
+
+void test_matches_old_math_across_pitch_sweep() {
+    for (int c = 0; c < NUM_CONFIGS; c++) {
+        GimbalGeometry geometry;
+        geometry.init(yaw_axes[c], pitch_axes[c], STARTING_PITCH);
+
+        // steps wider than the threshold, so every update recomputes
+        for (float pitch = -0.7f; pitch <= 0.7f; pitch += 0.01f) {
+            geometry.update(pitch);
+            OldGeometry old;
+            old.compute(yaw_axes[c], pitch_axes[c], STARTING_PITCH, pitch);
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0, max_difference(old.yaw_axis, geometry.yaw_axis));
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0, max_difference(old.pitch_axis, geometry.pitch_axis));
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0, max_difference(old.roll_axis, geometry.roll_axis));
+        }
+    }
+}
+
+void test_cached_axes_stay_within_threshold() {
+    // a 10 rad/s spin about any axis, projected on the cached axes, is off by at most the threshold angle
+    const float omega[3] = { 10 / sqrtf(3), 10 / sqrtf(3), 10 / sqrtf(3) };
+    float worst = 0;
+    for (int c = 0; c < NUM_CONFIGS; c++) {
+        GimbalGeometry geometry;
+        geometry.init(yaw_axes[c], pitch_axes[c], STARTING_PITCH);
+
+        // the pitch drifts slowly, most steps reuse the cached axes
+        for (int i = 0; i < 20000; i++) {
+            float pitch = 0.5f * sinf(i * 0.0003f);
+            geometry.update(pitch);
+            OldGeometry old;
+            old.compute(yaw_axes[c], pitch_axes[c], STARTING_PITCH, pitch);
+
+            float yaw_rate = 0, old_yaw_rate = 0;
+            for (int j = 0; j < 3; j++) {
+                yaw_rate += geometry.yaw_axis[j] * omega[j];
+                old_yaw_rate += old.yaw_axis[j] * omega[j];
+            }
+            worst = fmaxf(worst, fabsf(yaw_rate - old_yaw_rate));
+            TEST_ASSERT_LESS_OR_EQUAL_FLOAT(GIMBAL_GEOMETRY_PITCH_THRESHOLD + 1e-5f, max_difference(old.yaw_axis, geometry.yaw_axis));
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(10 * GIMBAL_GEOMETRY_PITCH_THRESHOLD + 1e-4f, worst);
+    printf("[gimbal_geometry] largest yaw rate error at 10 rad/s: %.5f rad/s\n", worst);
+}
+
+void test_bench_update() {
+    // the pitch follows a 0.5 Hz, 0.3 rad sine at 1 kHz, about 1 rad/s at its fastest
+    const int steps = 2000;
+    float pitch[steps];
+    for (int i = 0; i < steps; i++) pitch[i] = 0.3f * sinf(2 * (float)M_PI * 0.5f * i * 0.001f);
+
+    OldGeometry old;
+    int i = 0;
+    double old_ns = bench_ns([&]() {
+        old.compute(yaw_axes[1], pitch_axes[1], STARTING_PITCH, pitch[i]);
+        bench_keep(old);
+        i = (i + 1) % steps;
+    }, 200000);
+
+    GimbalGeometry geometry;
+    geometry.init(yaw_axes[1], pitch_axes[1], STARTING_PITCH);
+    i = 0;
+    double new_ns = bench_ns([&]() {
+        geometry.update(pitch[i]);
+        bench_keep(geometry);
+        i = (i + 1) % steps;
+    }, 200000);
+    bench_report("gimbal axes per estimator step", old_ns, new_ns);
+
+    TEST_ASSERT_TRUE(new_ns > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_old_math_across_pitch_sweep);
+    RUN_TEST(test_cached_axes_stay_within_threshold);
+    RUN_TEST(test_bench_update);
+    return UNITY_END();
+}
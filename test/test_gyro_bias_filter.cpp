@@ -0,0 +1,151 @@
+#include <unity.h>
+
+#include "filters/gyro_bias_filter.hpp"
+
+#define DT 0.001f      // IMU sample period (s)
+#define GRAVITY 9.81f  // (m/s^2)
+
+static GyroBiasFilter filter;
+static uint32_t seed;
+
+void setUp() {
+    const float zero[3] = { 0 };
+    filter.reset(zero);
+    filter.set_motion(0, 0);
+    seed = 1;
+}
+
+void tearDown() {}
+
+/// @brief Deterministic pseudo random number in [lo, hi)
+static float rand_range(float lo, float hi) {
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((seed >> 8) / (float)(1u << 24));
+}
+
+/// @brief Feed a synthetic trace: constant true rate plus bias, gravity along down, accel vibration and sensor noise
+/// @param seconds length of the trace (s)
+/// @param bias gyro bias (rad/s) added to every sample
+/// @param rate true body rate (rad/s)
+/// @param down unit vector of gravity in the IMU frame
+/// @param vibration amplitude (m/s^2) of a 20 Hz vibration on every accel axis
+static void run_trace(float seconds, const float bias[3], const float rate[3], const float down[3], float vibration) {
+    int steps = (int)(seconds / DT);
+    for (int i = 0; i < steps; i++) {
+        float gyro[3];
+        float accel[3];
+        float shake = vibration * sinf(2 * (float)M_PI * 20 * i * DT);
+        for (int j = 0; j < 3; j++) {
+            gyro[j] = rate[j] + bias[j] + rand_range(-0.005f, 0.005f);
+            accel[j] = GRAVITY * down[j] + shake + rand_range(-0.05f, 0.05f);
+        }
+        filter.update(gyro, accel, DT);
+    }
+}
+
+static const float still_rate[3] = { 0 };
+static const float flat[3] = { 0, 0, 1 };
+
+void test_still_trace_learns_bias() {
+    const float bias[3] = { 0.01f, -0.02f, 0.015f };
+    run_trace(60, bias, still_rate, flat, 0);
+
+    TEST_ASSERT_TRUE(filter.is_stationary());
+    for (int i = 0; i < 3; i++) TEST_ASSERT_FLOAT_WITHIN(0.001f, bias[i], filter.get_bias()[i]);
+}
+
+void test_stationary_only_after_hold_time() {
+    const float bias[3] = { 0.01f, 0, 0 };
+    run_trace(GYRO_BIAS_HOLD_TIME * 0.8f, bias, still_rate, flat, 0);
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    TEST_ASSERT_EQUAL_FLOAT(0, filter.get_bias()[0]);
+
+    run_trace(GYRO_BIAS_HOLD_TIME * 0.4f, bias, still_rate, flat, 0);
+    TEST_ASSERT_TRUE(filter.is_stationary());
+}
+
+void test_gravity_direction_does_not_matter() {
+    // IMU mounted on its side and tilted
+    const float tilted[3] = { 0, 0.7071f, 0.7071f };
+    const float bias[3] = { -0.01f, 0.01f, 0 };
+    run_trace(30, bias, still_rate, tilted, 0);
+
+    TEST_ASSERT_TRUE(filter.is_stationary());
+    for (int i = 0; i < 3; i++) TEST_ASSERT_FLOAT_WITHIN(0.001f, bias[i], filter.get_bias()[i]);
+}
+
+void test_spinning_motors_block_update() {
+    const float bias[3] = { 0.01f, 0.01f, 0.01f };
+    filter.set_motion(GYRO_BIAS_MOTOR_SPEED_THRESHOLD * 2, 0);
+    run_trace(10, bias, still_rate, flat, 0);
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL_FLOAT(0, filter.get_bias()[i]);
+
+    filter.set_motion(0, GYRO_BIAS_ENCODER_RATE_THRESHOLD * 2);
+    run_trace(10, bias, still_rate, flat, 0);
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL_FLOAT(0, filter.get_bias()[i]);
+}
+
+void test_vibration_blocks_update() {
+    const float bias[3] = { 0.01f, 0.01f, 0.01f };
+    run_trace(10, bias, still_rate, flat, 1.0f);
+
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    TEST_ASSERT_GREATER_THAN_FLOAT(GYRO_BIAS_ACCEL_VARIANCE_THRESHOLD, filter.get_accel_variance());
+    for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL_FLOAT(0, filter.get_bias()[i]);
+}
+
+void test_turning_blocks_update() {
+    const float bias[3] = { 0 };
+    const float turning[3] = { 0, 0, 0.5f };
+    run_trace(10, bias, turning, flat, 0);
+
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    TEST_ASSERT_EQUAL_FLOAT(0, filter.get_bias()[2]);
+}
+
+void test_slow_turn_moves_bias_at_bounded_rate() {
+    // a turn below the gyro threshold looks stationary, the rate limit keeps the damage small
+    const float bias[3] = { 0 };
+    const float creeping[3] = { 0, 0, GYRO_BIAS_GYRO_THRESHOLD * 0.8f };
+    float seconds = 5;
+    run_trace(seconds, bias, still_rate, flat, 0);
+    run_trace(seconds, bias, creeping, flat, 0);
+
+    TEST_ASSERT_TRUE(filter.is_stationary());
+    TEST_ASSERT_GREATER_THAN_FLOAT(0, filter.get_bias()[2]);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(GYRO_BIAS_MAX_RATE * seconds + 0.0005f, filter.get_bias()[2]);
+}
+
+void test_motion_restarts_hold_time() {
+    const float bias[3] = { 0.01f, 0, 0 };
+    run_trace(2, bias, still_rate, flat, 0);
+    TEST_ASSERT_TRUE(filter.is_stationary());
+
+    // a short bump, then still again: the bias holds until the hold time has passed once more
+    const float bump[3] = { 1.0f, 0, 0 };
+    run_trace(0.05f, bias, bump, flat, 0);
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    float held = filter.get_bias()[0];
+
+    run_trace(GYRO_BIAS_HOLD_TIME * 0.8f, bias, still_rate, flat, 0);
+    TEST_ASSERT_FALSE(filter.is_stationary());
+    TEST_ASSERT_EQUAL_FLOAT(held, filter.get_bias()[0]);
+
+    run_trace(GYRO_BIAS_HOLD_TIME * 0.4f, bias, still_rate, flat, 0);
+    TEST_ASSERT_TRUE(filter.is_stationary());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_still_trace_learns_bias);
+    RUN_TEST(test_stationary_only_after_hold_time);
+    RUN_TEST(test_gravity_direction_does_not_matter);
+    RUN_TEST(test_spinning_motors_block_update);
+    RUN_TEST(test_vibration_blocks_update);
+    RUN_TEST(test_turning_blocks_update);
+    RUN_TEST(test_slow_turn_moves_bias_at_bounded_rate);
+    RUN_TEST(test_motion_restarts_hold_time);
+    return UNITY_END();
+}
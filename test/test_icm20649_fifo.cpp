@@ -0,0 +1,123 @@
+#include <unity.h>
+
+#include "sensors/ICM20649FIFO.hpp"
+
+#define NUM_FRAMES 40
+#define ACCEL_SCALE 0.01f       // m/s^2 per LSB in the test stream
+#define GYRO_SCALE 0.001f       // rad/s per LSB in the test stream
+#define PERIOD_US 1000.0f       // time (us) between frames in the test stream
+
+static uint8_t stream[NUM_FRAMES * ICM_FIFO_FRAME_SIZE];
+static ICM20649FIFOParser parser;
+
+/// @brief Raw value of one axis of a frame, negative on odd frames so the sign extension is covered
+static int16_t raw_value(int frame, int axis) {
+    int value = frame * 100 + axis * 7 + 1;
+    return (int16_t)((frame & 1) ? -value : value);
+}
+
+void setUp() {
+    for (int f = 0; f < NUM_FRAMES; f++) {
+        for (int axis = 0; axis < 6; axis++) {
+            int16_t raw = raw_value(f, axis);
+            stream[f * ICM_FIFO_FRAME_SIZE + 2 * axis] = (uint8_t)(raw >> 8);
+            stream[f * ICM_FIFO_FRAME_SIZE + 2 * axis + 1] = (uint8_t)raw;
+        }
+    }
+    parser = ICM20649FIFOParser();
+    parser.set_scales(ACCEL_SCALE, GYRO_SCALE);
+    parser.set_sample_period(PERIOD_US);
+}
+
+void tearDown() {}
+
+/// @brief Check a sample holds the values of a frame
+static void check_frame(int frame, const IMUSample& sample) {
+    for (int axis = 0; axis < 3; axis++) {
+        TEST_ASSERT_EQUAL_FLOAT(raw_value(frame, axis) * ACCEL_SCALE, sample.accel[axis]);
+        TEST_ASSERT_EQUAL_FLOAT(raw_value(frame, 3 + axis) * GYRO_SCALE, sample.gyro[axis]);
+    }
+}
+
+/// @brief Feed the stream in chunks of the given sizes (repeated until it runs out) and check every frame comes out once, in order
+static void check_split(const int* sizes, int num_sizes) {
+    IMUSample samples[ICM_FIFO_MAX_FRAMES];
+    int offset = 0;
+    int next_frame = 0;
+    for (int c = 0; offset < (int)sizeof(stream); c++) {
+        int length = min(sizes[c % num_sizes], (int)sizeof(stream) - offset);
+        uint32_t now = 1000000 + offset;
+        int count = parser.parse(stream + offset, length, now, samples, ICM_FIFO_MAX_FRAMES);
+        offset += length;
+
+        // only frames completed by this chunk come out, the newest at the time passed in
+        TEST_ASSERT_EQUAL_INT(offset / ICM_FIFO_FRAME_SIZE - next_frame, count);
+        for (int i = 0; i < count; i++) {
+            check_frame(next_frame + i, samples[i]);
+            TEST_ASSERT_EQUAL_UINT32(now - (uint32_t)((count - 1 - i) * PERIOD_US), samples[i].time_us);
+        }
+        next_frame += count;
+    }
+    TEST_ASSERT_EQUAL_INT(NUM_FRAMES, next_frame);
+}
+
+void test_whole_frames_in_one_read() {
+    IMUSample samples[ICM_FIFO_MAX_FRAMES];
+    int count = parser.parse(stream, sizeof(stream), 50000, samples, ICM_FIFO_MAX_FRAMES);
+    TEST_ASSERT_EQUAL_INT(NUM_FRAMES, count);
+    for (int i = 0; i < count; i++) {
+        check_frame(i, samples[i]);
+        TEST_ASSERT_EQUAL_UINT32(50000 - (uint32_t)((NUM_FRAMES - 1 - i) * PERIOD_US), samples[i].time_us);
+    }
+}
+
+void test_one_byte_at_a_time() {
+    const int sizes[] = { 1 };
+    check_split(sizes, 1);
+}
+
+void test_odd_splits() {
+    const int sizes[] = { 5, 7, 13, 1, 23, 11, 2, 37 };
+    check_split(sizes, sizeof(sizes) / sizeof(sizes[0]));
+}
+
+void test_split_one_short_of_a_frame() {
+    const int sizes[] = { ICM_FIFO_FRAME_SIZE - 1, ICM_FIFO_FRAME_SIZE + 1, 3 * ICM_FIFO_FRAME_SIZE - 1 };
+    check_split(sizes, sizeof(sizes) / sizeof(sizes[0]));
+}
+
+void test_frames_past_the_sample_array_are_dropped() {
+    IMUSample samples[4];
+    // 6 whole frames and half of the 7th
+    int count = parser.parse(stream, 6 * ICM_FIFO_FRAME_SIZE + 6, 10000, samples, 4);
+    TEST_ASSERT_EQUAL_INT(4, count);
+    for (int i = 0; i < count; i++) check_frame(i, samples[i]);
+
+    // the half frame is still finished by the next read
+    count = parser.parse(stream + 6 * ICM_FIFO_FRAME_SIZE + 6, 6, 11000, samples, 4);
+    TEST_ASSERT_EQUAL_INT(1, count);
+    check_frame(6, samples[0]);
+}
+
+void test_reset_drops_a_partial_frame() {
+    IMUSample samples[ICM_FIFO_MAX_FRAMES];
+    TEST_ASSERT_EQUAL_INT(0, parser.parse(stream, 5, 0, samples, ICM_FIFO_MAX_FRAMES));
+    parser.reset();
+
+    // after a FIFO reset the next byte starts a new frame
+    int count = parser.parse(stream + 2 * ICM_FIFO_FRAME_SIZE, 2 * ICM_FIFO_FRAME_SIZE, 0, samples, ICM_FIFO_MAX_FRAMES);
+    TEST_ASSERT_EQUAL_INT(2, count);
+    check_frame(2, samples[0]);
+    check_frame(3, samples[1]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_whole_frames_in_one_read);
+    RUN_TEST(test_one_byte_at_a_time);
+    RUN_TEST(test_odd_splits);
+    RUN_TEST(test_split_one_short_of_a_frame);
+    RUN_TEST(test_frames_past_the_sample_array_are_dropped);
+    RUN_TEST(test_reset_drops_a_partial_frame);
+    return UNITY_END();
+}
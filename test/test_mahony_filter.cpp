@@ -0,0 +1,145 @@
+#include <unity.h>
+
+#include "filters/mahony_filter.hpp"
+
+#define SAMPLE_DT 0.001f    // IMU sample period (s) of the synthetic traces
+
+void setUp() {}
+void tearDown() {}
+
+/// @brief Ground truth attitude, rotated yaw about Z, then pitch about X, then roll about Y (the filter's Euler order)
+struct Attitude {
+    float yaw;
+    float pitch;
+    float roll;
+};
+
+/// @brief Accelerometer reading at rest for an attitude, gravity rotated into the body frame
+static void gravity_in_body(const Attitude& a, float accel[3]) {
+    accel[0] = -cosf(a.pitch) * sinf(a.roll) * MAHONY_GRAVITY;
+    accel[1] = sinf(a.pitch) * MAHONY_GRAVITY;
+    accel[2] = cosf(a.pitch) * cosf(a.roll) * MAHONY_GRAVITY;
+}
+
+/// @brief Feed the filter a still IMU at an attitude with a constant gyro reading
+static void run_static(MahonyFilter& filter, const Attitude& a, const float gyro[3], float seconds) {
+    float accel[3];
+    gravity_in_body(a, accel);
+    int steps = (int)(seconds / SAMPLE_DT);
+    for (int i = 0; i < steps; i++) filter.update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], SAMPLE_DT);
+}
+
+void test_static_tilt_aligns_to_gravity() {
+    const Attitude cases[] = { { 0, 0, 0 }, { 0, 0.3f, 0 }, { 0, 0, -0.4f }, { 0, -0.5f, 0.2f }, { 0, 1.2f, -0.7f } };
+    const float no_rate[3] = { 0, 0, 0 };
+    for (const Attitude& truth : cases) {
+        MahonyFilter filter;
+        run_static(filter, truth, no_rate, 1.0f);
+
+        float yaw, pitch, roll;
+        filter.get_euler(yaw, pitch, roll);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, truth.pitch, pitch);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, truth.roll, roll);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, yaw);
+    }
+}
+
+void test_constant_yaw_rate_integrates() {
+    MahonyFilter filter;
+    const Attitude level = { 0, 0, 0 };
+    const float yaw_rate[3] = { 0, 0, 0.5f };
+    const float no_rate[3] = { 0, 0, 0 };
+    run_static(filter, level, no_rate, 0.1f);
+    // level so gravity doesn't change while yawing, 4s at 0.5 rad/s
+    run_static(filter, level, yaw_rate, 4.0f);
+
+    float yaw, pitch, roll;
+    filter.get_euler(yaw, pitch, roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 2.0f, yaw);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, pitch);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, roll);
+
+    // a full turn comes back around to where it started
+    MahonyFilter turn;
+    run_static(turn, level, no_rate, 0.1f);
+    const float turn_rate[3] = { 0, 0, (float)PI };
+    run_static(turn, level, turn_rate, 2.0f);
+    turn.get_euler(yaw, pitch, roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 0, sinf(yaw));
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 1, cosf(yaw));
+}
+
+void test_pitch_rate_tracks_gravity() {
+    // pitch up at 0.2 rad/s for 2s with the accelerometer following the true attitude
+    MahonyFilter filter;
+    const float no_rate[3] = { 0, 0, 0 };
+    run_static(filter, { 0, 0, 0 }, no_rate, 0.1f);
+    Attitude truth = { 0, 0, 0 };
+    for (int i = 0; i < 2000; i++) {
+        truth.pitch += 0.2f * SAMPLE_DT;
+        float accel[3];
+        gravity_in_body(truth, accel);
+        filter.update(0.2f, 0, 0, accel[0], accel[1], accel[2], SAMPLE_DT);
+    }
+
+    float yaw, pitch, roll;
+    filter.get_euler(yaw, pitch, roll);
+    TEST_ASSERT_FLOAT_WITHIN(2e-3f, 0.4f, pitch);
+    TEST_ASSERT_FLOAT_WITHIN(2e-3f, 0, roll);
+}
+
+void test_injected_gyro_bias_is_learned() {
+    MahonyFilter filter;
+    const Attitude level = { 0, 0, 0 };
+    const float bias[3] = { 0.01f, -0.02f, 0.005f };
+    run_static(filter, level, bias, 120.0f);
+
+    // with gravity as the only reference the tilt axes (X, Y) are observable, yaw (Z) isn't
+    const float* correction = filter.get_bias_correction();
+    TEST_ASSERT_FLOAT_WITHIN(0.05f * fabsf(bias[0]), -bias[0], correction[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f * fabsf(bias[1]), -bias[1], correction[1]);
+
+    // and the bias no longer tilts the estimate
+    float yaw, pitch, roll;
+    filter.get_euler(yaw, pitch, roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, pitch);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, roll);
+}
+
+void test_shaken_accelerometer_is_ignored() {
+    MahonyFilter filter;
+    const float no_rate[3] = { 0, 0, 0 };
+    run_static(filter, { 0, 0.3f, 0 }, no_rate, 0.1f);
+
+    // 2g of sideways shaking for a second, the attitude holds on the gyro alone
+    for (int i = 0; i < 1000; i++) filter.update(0, 0, 0, 2 * MAHONY_GRAVITY, 0, 0, SAMPLE_DT);
+
+    float yaw, pitch, roll;
+    filter.get_euler(yaw, pitch, roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.3f, pitch);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, roll);
+}
+
+void test_reset_realigns() {
+    MahonyFilter filter;
+    const float no_rate[3] = { 0, 0, 0 };
+    run_static(filter, { 0, 0.5f, 0 }, no_rate, 0.1f);
+    filter.reset();
+    run_static(filter, { 0, -0.2f, 0.1f }, no_rate, 0.01f);
+
+    float yaw, pitch, roll;
+    filter.get_euler(yaw, pitch, roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, -0.2f, pitch);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.1f, roll);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_static_tilt_aligns_to_gravity);
+    RUN_TEST(test_constant_yaw_rate_integrates);
+    RUN_TEST(test_pitch_rate_tracks_gravity);
+    RUN_TEST(test_injected_gyro_bias_is_learned);
+    RUN_TEST(test_shaken_accelerometer_is_ignored);
+    RUN_TEST(test_reset_realigns);
+    return UNITY_END();
+}
@@ -0,0 +1,86 @@
+#include <unity.h>
+
+#include "sensors/MT6835Frame.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+/// @brief Build the frame the encoder would clock out for an angle and status, with a correct CRC
+static void make_frame(uint32_t raw_angle, uint8_t status, uint8_t frame[MT6835_FRAME_SIZE]) {
+    frame[0] = 0xA0;
+    frame[1] = 0x03;
+    frame[2] = (raw_angle >> 13) & 0xFF;
+    frame[3] = (raw_angle >> 5) & 0xFF;
+    frame[4] = ((raw_angle & 0x1F) << 3) | (status & 0x07);
+    frame[5] = mt6835_crc8(frame + 2, 3);
+}
+
+void test_crc8_check_value() {
+    // CRC-8 (poly 0x07, init 0, no reflection) of "123456789"
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    TEST_ASSERT_EQUAL_HEX8(0xF4, mt6835_crc8(check, sizeof(check)));
+}
+
+void test_crc8_known_values() {
+    const uint8_t zeros[3] = { 0, 0, 0 };
+    TEST_ASSERT_EQUAL_HEX8(0x00, mt6835_crc8(zeros, 3));
+    const uint8_t one[1] = { 0x01 };
+    TEST_ASSERT_EQUAL_HEX8(0x07, mt6835_crc8(one, 1));
+    const uint8_t ff[1] = { 0xFF };
+    TEST_ASSERT_EQUAL_HEX8(0xF3, mt6835_crc8(ff, 1));
+}
+
+void test_decode_round_trip() {
+    const uint32_t angles[] = { 0, 1, 0x1F, 0x20, 0x12345, 0x100000, 0x1FFFFF };
+    for (uint32_t angle : angles) {
+        for (uint8_t status = 0; status < 8; status++) {
+            uint8_t frame[MT6835_FRAME_SIZE];
+            make_frame(angle, status, frame);
+
+            MT6835Reading reading;
+            TEST_ASSERT_TRUE(mt6835_decode(frame, reading));
+            TEST_ASSERT_TRUE(reading.crc_ok);
+            TEST_ASSERT_EQUAL_UINT32(angle, reading.raw_angle);
+            TEST_ASSERT_EQUAL_UINT8(status, reading.status);
+        }
+    }
+}
+
+void test_decode_ignores_command_bytes() {
+    uint8_t frame[MT6835_FRAME_SIZE];
+    make_frame(0x0ABCDE, 0x02, frame);
+    frame[0] = 0xFF;
+    frame[1] = 0xFF;
+
+    MT6835Reading reading;
+    TEST_ASSERT_TRUE(mt6835_decode(frame, reading));
+    TEST_ASSERT_EQUAL_UINT32(0x0ABCDE, reading.raw_angle);
+}
+
+void test_decode_rejects_every_single_bit_flip() {
+    uint8_t frame[MT6835_FRAME_SIZE];
+    make_frame(0x15A5A5, 0x01, frame);
+
+    // every flipped bit of the angle, status or CRC bytes fails the check
+    for (int byte = 2; byte < MT6835_FRAME_SIZE; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t corrupt[MT6835_FRAME_SIZE];
+            memcpy(corrupt, frame, sizeof(corrupt));
+            corrupt[byte] ^= 1 << bit;
+
+            MT6835Reading reading;
+            TEST_ASSERT_FALSE(mt6835_decode(corrupt, reading));
+            TEST_ASSERT_FALSE(reading.crc_ok);
+        }
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc8_check_value);
+    RUN_TEST(test_crc8_known_values);
+    RUN_TEST(test_decode_round_trip);
+    RUN_TEST(test_decode_ignores_command_bytes);
+    RUN_TEST(test_decode_rejects_every_single_bit_flip);
+    return UNITY_END();
+}
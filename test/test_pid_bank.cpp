@@ -0,0 +1,105 @@
+#include <unity.h>
+
+#include "filters/pid_bank.hpp"
+#include "filters/pid_filter.hpp"
+
+// tolerance between the bank and PIDFilter, the bank wraps in float where PIDFilter wraps in double
+#define PID_BANK_TOLERANCE 1e-4f
+
+void setUp() {}
+void tearDown() {}
+
+/// @brief Deterministic pseudo random number in [lo, hi)
+static float rand_range(uint32_t& seed, float lo, float hi) {
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((seed >> 8) / (float)(1u << 24));
+}
+
+/// @brief Step one bank channel and a PIDFilter side by side and check they agree every step
+static void check_against_filter(const float K[4], bool bound, bool wrap, float range, uint32_t seed) {
+    PIDBank bank;
+    PIDFilter filter{};
+    int channel = bank.add_channel(K, bound, wrap);
+    filter.set_K((float*)K);
+    TEST_ASSERT_EQUAL_INT(0, channel);
+
+    for (int step = 0; step < 2000; step++) {
+        float dt = rand_range(seed, 0.0008f, 0.0012f);
+        float setpoint = rand_range(seed, -range, range);
+        float measurement = rand_range(seed, -range, range);
+
+        bank.setpoint[channel] = setpoint;
+        bank.measurement[channel] = measurement;
+        bank.step(dt);
+
+        filter.setpoint = setpoint;
+        filter.measurement = measurement;
+        float expected = filter.filter(dt, bound, wrap);
+
+        TEST_ASSERT_FLOAT_WITHIN(PID_BANK_TOLERANCE * fmaxf(1.0f, fabsf(expected)), expected, bank.output[channel]);
+    }
+}
+
+void test_plain_channel_matches_filter() {
+    const float K[4] = { 2.0f, 0.5f, 0.01f, 0.1f };
+    check_against_filter(K, false, false, 5.0f, 1);
+}
+
+void test_bounded_channel_matches_filter() {
+    const float K[4] = { 4.0f, 0.0f, 0.002f, -0.2f };
+    check_against_filter(K, true, false, 5.0f, 2);
+}
+
+void test_wrapped_channel_matches_filter() {
+    const float K[4] = { 1.5f, 0.0f, 0.001f, 0.0f };
+    check_against_filter(K, false, true, 2 * PI, 3);
+}
+
+void test_bounded_wrapped_channel_matches_filter() {
+    const float K[4] = { 3.0f, 0.0f, 0.003f, 0.05f };
+    check_against_filter(K, true, true, 2 * PI, 4);
+}
+
+void test_channels_are_independent() {
+    const float K_a[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    const float K_b[4] = { 10.0f, 0.0f, 0.0f, 0.5f };
+    PIDBank bank;
+    int a = bank.add_channel(K_a, false, false);
+    int b = bank.add_channel(K_b, true, false);
+    TEST_ASSERT_EQUAL_INT(2, bank.get_num_channels());
+
+    bank.setpoint[a] = 1.0f;
+    bank.setpoint[b] = 1.0f;
+    bank.step(0.001f);
+
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, bank.output[a]);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, bank.output[b]);
+
+    // changing gains of one channel leaves the other alone
+    const float K_c[4] = { 0.5f, 0.0f, 0.0f, 0.0f };
+    bank.set_gains(b, K_c);
+    bank.step(0.001f);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, bank.output[a]);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, bank.output[b]);
+}
+
+void test_bank_rejects_channels_when_full() {
+    const float K[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    PIDBank bank;
+    for (int i = 0; i < PID_BANK_SIZE; i++) TEST_ASSERT_EQUAL_INT(i, bank.add_channel(K, false, false));
+    TEST_ASSERT_EQUAL_INT(-1, bank.add_channel(K, false, false));
+
+    bank.clear();
+    TEST_ASSERT_EQUAL_INT(0, bank.get_num_channels());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_plain_channel_matches_filter);
+    RUN_TEST(test_bounded_channel_matches_filter);
+    RUN_TEST(test_wrapped_channel_matches_filter);
+    RUN_TEST(test_bounded_wrapped_channel_matches_filter);
+    RUN_TEST(test_channels_are_independent);
+    RUN_TEST(test_bank_rejects_channels_when_full);
+    return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include <unity.h>
+
+#include "comms/rm_can.hpp"
+#include "utils/logger.hpp"
+#include "fake_can_bus.hpp"
+
+Logger logger;
+
+static FakeCANBus bus1, bus2, bus3;
+static FakeCANBus* fake[NUM_CAN_BUSES] = { &bus1, &bus2, &bus3 };
+static rm_CAN* can;
+
+void setUp() {
+    host_micros = 0;
+    for (int i = 0; i < NUM_CAN_BUSES; i++) *fake[i] = FakeCANBus();
+    CANBus* buses[NUM_CAN_BUSES] = { &bus1, &bus2, &bus3 };
+    can = new rm_CAN(buses);
+}
+
+void tearDown() { delete can; }
+
+/// @brief Feedback frame as a DJI motor controller sends it
+static void make_feedback(uint16_t angle, int16_t rpm, int16_t current, uint8_t temp, uint8_t data[CAN_FRAME_SIZE]) {
+    data[0] = angle >> 8;
+    data[1] = angle & 0xff;
+    data[2] = (uint16_t)rpm >> 8;
+    data[3] = rpm & 0xff;
+    data[4] = (uint16_t)current >> 8;
+    data[5] = current & 0xff;
+    data[6] = temp;
+    data[7] = 0;
+}
+
+void test_init_starts_every_bus() {
+    can->init();
+    for (int i = 0; i < NUM_CAN_BUSES; i++) {
+        TEST_ASSERT_EQUAL_UINT32(CAN_BAUD_RATE, fake[i]->baud_rate);
+        TEST_ASSERT_NOT_NULL(fake[i]->handler);
+    }
+
+    // init() writes zeros to the groups of the default map: 0x200 and 0x1ff on CAN 1 and CAN 2
+    TEST_ASSERT_EQUAL_INT(2, bus1.num_sent);
+    TEST_ASSERT_EQUAL_HEX32(0x200, bus1.sent[0].id);
+    TEST_ASSERT_EQUAL_HEX32(0x1ff, bus1.sent[1].id);
+    TEST_ASSERT_EQUAL_INT(2, bus2.num_sent);
+    TEST_ASSERT_EQUAL_INT(0, bus3.num_sent);
+    for (int i = 0; i < CAN_FRAME_SIZE; i++) TEST_ASSERT_EQUAL_HEX8(0, bus1.sent[0].buf[i]);
+}
+
+void test_write_goes_through_the_backend() {
+    can->init();
+    uint8_t data[CAN_FRAME_SIZE];
+    make_feedback(0, 0, 0, 30, data);
+    bus1.inject(1, 0x202, data);
+    can->read();
+    bus1.num_sent = 0;
+
+    // motor 2 is online and gets its command, silent motor 3 is held at zero
+    can->write_motor(CAN_1, 2, 0x1234);
+    can->write_motor(CAN_1, 3, 0x1234);
+    can->write();
+    TEST_ASSERT_EQUAL_INT(2, bus1.num_sent);
+    TEST_ASSERT_EQUAL_HEX32(0x200, bus1.sent[0].id);
+    TEST_ASSERT_EQUAL_HEX8(0x12, bus1.sent[0].buf[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, bus1.sent[0].buf[3]);
+    TEST_ASSERT_EQUAL_HEX8(0, bus1.sent[0].buf[4]);
+    TEST_ASSERT_EQUAL_HEX8(0, bus1.sent[0].buf[5]);
+}
+
+void test_filters_follow_active_motors() {
+    can->init();
+    // filters stay open until the active motors are known
+    TEST_ASSERT_EQUAL_INT(-1, bus1.num_filters);
+
+    bool active[NUM_MOTORS] = {};
+    active[0] = true;
+    active[9] = true;
+    can->set_active_motors(active);
+    TEST_ASSERT_EQUAL_INT(1, bus1.num_filters);
+    TEST_ASSERT_EQUAL_HEX32(0x201, bus1.filter_ids[0]);
+    TEST_ASSERT_EQUAL_INT(1, bus2.num_filters);
+    TEST_ASSERT_EQUAL_HEX32(0x202, bus2.filter_ids[0]);
+    TEST_ASSERT_EQUAL_INT(0, bus3.num_filters);
+}
+
+void test_injected_frame_reaches_the_snapshot() {
+    can->init();
+    uint8_t data[CAN_FRAME_SIZE];
+    make_feedback(4096, 60, -100, 35, data);
+    bus2.inject(2, 0x203, data);
+
+    can->read();
+    CANData* input = can->get_data();
+    TEST_ASSERT_EQUAL_UINT32(1, input->seq[CAN_2][2]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, input->data[CAN_2][2], CAN_FRAME_SIZE);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)PI, input->angle[can_motor_index(CAN_2, 3)]);
+    TEST_ASSERT_EQUAL_INT(4096, can->get_motor_attribute(CAN_2, 3, MotorAttribute::ANGLE));
+}
+
+/// @brief Map logical motor 0 to CAN 3 motor 4 and logical motor 1 to CAN 1 motor 1, everything else unused
+static void map_two_motors() {
+    MotorInfo motors[NUM_MOTORS];
+    motors[0].can_id = CAN_3;
+    motors[0].motor_id = 4;
+    motors[0].controller_type = GM6020;
+    motors[1].can_id = CAN_1;
+    motors[1].motor_id = 1;
+    can->set_motor_map(motors);
+}
+
+void test_mapped_feedback_is_decoded() {
+    map_two_motors();
+    can->init();
+
+    uint8_t data[CAN_FRAME_SIZE];
+    make_feedback(2048, -120, 5000, 42, data);
+    host_micros = 1000;
+    bus3.inject(3, 0x204, data);
+
+    can->read();
+    CANData* input = can->get_data();
+    int slot = input->motor_slot[0];
+    TEST_ASSERT_EQUAL_INT(can_motor_index(CAN_3, 4), slot);
+    TEST_ASSERT_EQUAL_INT(can_motor_index(CAN_1, 1), input->motor_slot[1]);
+    TEST_ASSERT_EQUAL_INT(-1, input->motor_slot[2]);
+
+    TEST_ASSERT_EQUAL_UINT32(1, input->seq[CAN_3][3]);
+    TEST_ASSERT_EQUAL_UINT32(1000, input->timestamp[CAN_3][3]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)HALF_PI, input->angle[slot]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, -120 * (float)(2 * PI / 60), input->velocity[slot]);
+    TEST_ASSERT_EQUAL_FLOAT(5000, input->current[slot]);
+    TEST_ASSERT_EQUAL_FLOAT(42, input->temperature[slot]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)HALF_PI, input->position[slot]);
+
+    // every new frame bumps seq and moves the timestamp
+    host_micros = 2000;
+    bus3.inject(3, 0x204, data);
+    can->read();
+    TEST_ASSERT_EQUAL_UINT32(2, input->seq[CAN_3][3]);
+    TEST_ASSERT_EQUAL_UINT32(2000, input->timestamp[CAN_3][3]);
+}
+
+void test_unmapped_and_foreign_frames_are_rejected() {
+    map_two_motors();
+    can->init();
+
+    uint8_t data[CAN_FRAME_SIZE];
+    make_feedback(1000, 10, 10, 30, data);
+    // a slot no logical motor is mapped to
+    bus1.inject(1, 0x202, data);
+    // the right slot on the wrong bus
+    bus2.inject(2, 0x204, data);
+    // not motor feedback at all
+    bus1.inject(1, 0x200, data);
+    bus1.inject(1, 0x209, data);
+    // an extended ID that matches a feedback ID
+    bus1.inject(1, 0x201, data, true);
+
+    host_micros = CAN_STATS_WINDOW_US;
+    can->read();
+    CANData* input = can->get_data();
+    for (int bus = 0; bus < NUM_CAN_BUSES; bus++) {
+        for (int slot = 0; slot < NUM_MOTORS_PER_BUS; slot++) TEST_ASSERT_EQUAL_UINT32(0, input->seq[bus][slot]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, input->online_mask);
+
+    const CANBusStats* stats = can->get_bus_stats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats[CAN_1].rx_frames);
+    TEST_ASSERT_EQUAL_UINT32(4, stats[CAN_1].rx_rejected);
+    TEST_ASSERT_EQUAL_UINT32(1, stats[CAN_2].rx_rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[CAN_3].rx_frames);
+}
+
+void test_online_mask_follows_feedback() {
+    map_two_motors();
+    can->init();
+    CANData* input = can->get_data();
+
+    // no motor has reported yet
+    can->read();
+    TEST_ASSERT_EQUAL_UINT32(0, input->online_mask);
+
+    uint8_t data[CAN_FRAME_SIZE];
+    make_feedback(0, 0, 0, 30, data);
+    host_micros = 10000;
+    bus3.inject(3, 0x204, data);
+    can->read();
+    TEST_ASSERT_EQUAL_HEX32(0x1, input->online_mask);
+    TEST_ASSERT_TRUE(input->is_online(0));
+    TEST_ASSERT_FALSE(input->is_online(1));
+
+    bus1.inject(1, 0x201, data);
+    can->read();
+    TEST_ASSERT_EQUAL_HEX32(0x3, input->online_mask);
+
+    // motor 0 goes quiet past the timeout, motor 1 keeps reporting
+    host_micros += CAN_MOTOR_TIMEOUT_US - 1;
+    can->read();
+    TEST_ASSERT_EQUAL_HEX32(0x3, input->online_mask);
+    bus1.inject(1, 0x201, data);
+    host_micros += 1;
+    can->read();
+    TEST_ASSERT_EQUAL_HEX32(0x2, input->online_mask);
+
+    // a motor that is switched off is never online, even while it reports
+    bool active[NUM_MOTORS] = {};
+    active[0] = true;
+    can->set_active_motors(active);
+    bus3.inject(3, 0x204, data);
+    bus1.inject(1, 0x201, data);
+    can->read();
+    TEST_ASSERT_EQUAL_HEX32(0x1, input->online_mask);
+}
+
+void test_only_accepted_frames_count_as_sent() {
+    can->init();
+    const CANBusStats* stats = can->get_bus_stats();
+    // init() sent the two default groups on CAN 1
+    TEST_ASSERT_EQUAL_UINT32(2, stats[CAN_1].tx_frames);
+
+    bus1.write_result = CAN_WRITE_QUEUED;
+    can->write();
+    TEST_ASSERT_EQUAL_UINT32(4, stats[CAN_1].tx_frames);
+    TEST_ASSERT_EQUAL_UINT32(2, stats[CAN_1].tx_mailbox_full);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[CAN_1].tx_dropped);
+
+    bus1.write_result = CAN_WRITE_FULL;
+    TEST_ASSERT_EQUAL_UINT8(0, can->write());
+    TEST_ASSERT_EQUAL_UINT32(4, stats[CAN_1].tx_frames);
+    TEST_ASSERT_EQUAL_UINT32(2, stats[CAN_1].tx_dropped);
+
+    bus1.write_result = CAN_WRITE_BUS_OFF;
+    TEST_ASSERT_EQUAL_UINT8(0, can->write());
+    TEST_ASSERT_EQUAL_UINT32(4, stats[CAN_1].tx_frames);
+    TEST_ASSERT_EQUAL_UINT32(4, stats[CAN_1].tx_dropped);
+    TEST_ASSERT_EQUAL_UINT32(2, stats[CAN_1].tx_mailbox_full);
+
+    // the other buses are unaffected
+    TEST_ASSERT_EQUAL_UINT32(8, stats[CAN_2].tx_frames);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[CAN_2].tx_dropped);
+
+    bus1.write_result = CAN_WRITE_SENT;
+    TEST_ASSERT_EQUAL_UINT8(1, can->write());
+    TEST_ASSERT_EQUAL_UINT32(6, stats[CAN_1].tx_frames);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_starts_every_bus);
+    RUN_TEST(test_write_goes_through_the_backend);
+    RUN_TEST(test_filters_follow_active_motors);
+    RUN_TEST(test_injected_frame_reaches_the_snapshot);
+    RUN_TEST(test_mapped_feedback_is_decoded);
+    RUN_TEST(test_unmapped_and_foreign_frames_are_rejected);
+    RUN_TEST(test_online_mask_follows_feedback);
+    RUN_TEST(test_only_accepted_frames_count_as_sent);
+    return UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include <unity.h>
+
+#include "utils/scheduler.hpp"
+
+/// @brief simulated clock (us), tasks advance it by their execution time
+static uint32_t sim_us;
+static uint32_t sim_clock() { return sim_us; }
+
+/// @brief order the tasks ran in, one letter per run
+static char run_log[64];
+static int run_count;
+
+/// @brief simulated execution time (us) of each task
+static uint32_t exec_a, exec_b, exec_c;
+
+static void log_run(char name, uint32_t exec) {
+    if (run_count < (int)sizeof(run_log) - 1) run_log[run_count++] = name;
+    run_log[run_count] = '\0';
+    sim_us += exec;
+}
+
+static void task_a() { log_run('a', exec_a); }
+static void task_b() { log_run('b', exec_b); }
+static void task_c() { log_run('c', exec_c); }
+
+static Scheduler scheduler;
+
+void setUp() {
+    sim_us = 0;
+    run_count = 0;
+    run_log[0] = '\0';
+    exec_a = exec_b = exec_c = 10;
+    scheduler = Scheduler();
+    scheduler.set_clock(sim_clock);
+}
+
+void tearDown() {}
+
+/// @brief Run every task that fits in the idle time of one 1 ms control tick, the control step takes step_us
+static void run_tick(uint32_t step_us) {
+    uint32_t tick_end = sim_us + 1000;
+    sim_us += step_us;
+    while ((int32_t)(tick_end - sim_us) > 0 && scheduler.run_next(tick_end - sim_us)) {}
+    sim_us = tick_end;
+}
+
+void test_tasks_run_at_their_rate() {
+    int a = scheduler.add_task("a", task_a, 100, 0, 50);
+    int b = scheduler.add_task("b", task_b, 10, 1, 50);
+
+    for (int i = 0; i < 1000; i++) run_tick(300);
+
+    TEST_ASSERT_EQUAL_UINT32(100, scheduler.get_stats(a).runs);
+    TEST_ASSERT_EQUAL_UINT32(10, scheduler.get_stats(b).runs);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.get_stats(a).deadline_misses);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.get_stats(b).deadline_misses);
+}
+
+void test_priority_then_waiting_time_orders_tasks() {
+    scheduler.add_task("a", task_a, 10, 2, 50);
+    scheduler.add_task("b", task_b, 10, 1, 50);
+    scheduler.add_task("c", task_c, 10, 1, 50);
+
+    // all released together: b and c share the top priority and b is first, then a
+    run_tick(0);
+    TEST_ASSERT_EQUAL_STRING("bca", run_log);
+}
+
+void test_nothing_runs_before_release() {
+    int a = scheduler.add_task("a", task_a, 10, 0, 50);
+    // released at 0 and then every 100 ticks
+    run_tick(0);
+    for (int i = 0; i < 99; i++) run_tick(0);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.get_stats(a).runs);
+    run_tick(0);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.get_stats(a).runs);
+}
+
+void test_task_only_starts_if_budget_fits() {
+    int a = scheduler.add_task("a", task_a, 100, 0, 500);
+    int b = scheduler.add_task("b", task_b, 100, 1, 100);
+
+    // 600 us left each tick: both fit
+    for (int i = 0; i < 100; i++) run_tick(400);
+    TEST_ASSERT_EQUAL_UINT32(10, scheduler.get_stats(a).runs);
+    TEST_ASSERT_EQUAL_UINT32(10, scheduler.get_stats(b).runs);
+
+    // 300 us left each tick: a never fits and misses every release, b keeps running
+    for (int i = 0; i < 100; i++) run_tick(700);
+    TEST_ASSERT_EQUAL_UINT32(10, scheduler.get_stats(a).runs);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(9, scheduler.get_stats(a).deadline_misses);
+    TEST_ASSERT_EQUAL_UINT32(20, scheduler.get_stats(b).runs);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.get_stats(b).deadline_misses);
+}
+
+void test_budget_overrun_is_counted() {
+    int a = scheduler.add_task("a", task_a, 100, 0, 50);
+    exec_a = 80;
+    for (int i = 0; i < 20; i++) run_tick(100);
+
+    const TaskStats& stats = scheduler.get_stats(a);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.budget_overruns);
+    TEST_ASSERT_EQUAL_UINT32(80, stats.max_exec_us);
+    TEST_ASSERT_EQUAL_UINT32(160, (uint32_t)stats.total_exec_us);
+}
+
+void test_long_stall_counts_each_missed_release_once() {
+    int a = scheduler.add_task("a", task_a, 1000, 0, 50);
+    run_tick(0);
+
+    // the CPU is gone for 10 ms, the task catches up with one run, not ten
+    sim_us += 10000;
+    run_tick(0);
+    const TaskStats& stats = scheduler.get_stats(a);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(10, stats.deadline_misses);
+}
+
+void test_release_survives_clock_wrap() {
+    sim_us = UINT32_MAX - 5500;
+    int a = scheduler.add_task("a", task_a, 200, 0, 50);
+    for (int i = 0; i < 20; i++) run_tick(0);
+    TEST_ASSERT_EQUAL_UINT32(4, scheduler.get_stats(a).runs);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.get_stats(a).deadline_misses);
+}
+
+void test_full_scheduler_rejects_tasks() {
+    for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) TEST_ASSERT_EQUAL_INT(i, scheduler.add_task("a", task_a, 1, 0, 10));
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.add_task("a", task_a, 1, 0, 10));
+    TEST_ASSERT_EQUAL_INT(SCHEDULER_MAX_TASKS, scheduler.get_num_tasks());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tasks_run_at_their_rate);
+    RUN_TEST(test_priority_then_waiting_time_orders_tasks);
+    RUN_TEST(test_nothing_runs_before_release);
+    RUN_TEST(test_task_only_starts_if_budget_fits);
+    RUN_TEST(test_budget_overrun_is_counted);
+    RUN_TEST(test_long_stall_counts_each_missed_release_once);
+    RUN_TEST(test_release_survives_clock_wrap);
+    RUN_TEST(test_full_scheduler_rejects_tasks);
+    return UNITY_END();
+}
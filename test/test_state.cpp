@@ -0,0 +1,294 @@
+#include <unity.h>
+
+#include "controls/state.hpp"
+#include "utils/logger.hpp"
+#include "bench.hpp"
+
+Logger logger;
+
+/// @brief The reference governor as it was before the governor plan, every state is governed straight from the limits
+struct LegacyGovernor {
+    float reference[STATE_LEN][3] = { { 0 } };
+    float reference_limits[STATE_LEN][3][2] = { { { 0 } } };
+    int count = 0;
+
+    void step_reference(float ungoverned_reference[STATE_LEN][3], const float governor_type[STATE_LEN], float dt) {
+        float threshold = 0.0005;
+        if (count == 0) {
+            dt = 0;
+            count++;
+        }
+        for (int n = 0; n < STATE_LEN; n++) {
+            bool is_wrap = (((int)(reference_limits[n][0][1] * 100) == 314) && ((int)(reference_limits[n][0][0] * 100) == -314));
+            if (is_wrap) {
+                while (ungoverned_reference[n][0] >= PI) ungoverned_reference[n][0] -= 2 * PI;
+                while (ungoverned_reference[n][0] <= -PI) ungoverned_reference[n][0] += 2 * PI;
+                for (int p = 1; p < 3; p++) {
+                    if (ungoverned_reference[n][p] < reference_limits[n][p][0]) ungoverned_reference[n][p] = reference_limits[n][p][0];
+                    if (ungoverned_reference[n][p] > reference_limits[n][p][1]) ungoverned_reference[n][p] = reference_limits[n][p][1];
+                }
+            } else {
+                for (int p = 0; p < 3; p++) {
+                    if (ungoverned_reference[n][p] < reference_limits[n][p][0]) ungoverned_reference[n][p] = reference_limits[n][p][0];
+                    if (ungoverned_reference[n][p] > reference_limits[n][p][1]) ungoverned_reference[n][p] = reference_limits[n][p][1];
+                }
+            }
+
+            if ((int)governor_type[n] == 1) {
+                float pos_error = ungoverned_reference[n][0] - reference[n][0];
+                if (pos_error > PI && is_wrap) pos_error -= 2 * PI;
+                if (pos_error < -PI && is_wrap) pos_error += 2 * PI;
+                float vel_error = ungoverned_reference[n][1] - reference[n][1];
+                if (pos_error > threshold) reference[n][2] = reference_limits[n][2][1];
+                else if (pos_error < -threshold) reference[n][2] = reference_limits[n][2][0];
+                else {
+                    reference[n][2] = 0;
+                    reference[n][1] = ungoverned_reference[n][1];
+                }
+
+                if (reference[n][2] != 0) {
+                    if (pos_error > 0) {
+                        float dist_to_deccel = (pow(ungoverned_reference[n][1], 2) - pow(reference[n][1], 2)) / (2 * (reference_limits[n][2][0]));
+                        if (dist_to_deccel > pos_error) {
+                            if (vel_error > 0) reference[n][2] = reference_limits[n][2][1];
+                            else reference[n][2] = reference_limits[n][2][0];
+                        }
+                    } else {
+                        float dist_to_deccel = (pow(ungoverned_reference[n][1], 2) - pow(reference[n][1], 2)) / (2 * (reference_limits[n][2][1]));
+                        if (dist_to_deccel < pos_error) {
+                            if (vel_error > 0) reference[n][2] = reference_limits[n][2][1];
+                            else reference[n][2] = reference_limits[n][2][0];
+                        }
+                    }
+                }
+
+                reference[n][1] += reference[n][2] * dt;
+                reference[n][0] += reference[n][1] * dt;
+
+            } else if ((int)governor_type[n] == 2) {
+                float vel_error = ungoverned_reference[n][1] - reference[n][1];
+                if (vel_error > (reference_limits[n][2][1] * dt)) {
+                    reference[n][2] = reference_limits[n][2][1];
+                } else if (vel_error < (reference_limits[n][2][0] * dt)) {
+                    reference[n][2] = reference_limits[n][2][0];
+                } else {
+                    reference[n][1] = ungoverned_reference[n][1];
+                    reference[n][2] = 0;
+                }
+                reference[n][1] += reference[n][2] * dt;
+
+            } else {
+                reference[n][2] = ungoverned_reference[n][2];
+                reference[n][1] = ungoverned_reference[n][1];
+                reference[n][0] = ungoverned_reference[n][0];
+            }
+            if (is_wrap) {
+                while (reference[n][0] >= PI) reference[n][0] -= 2 * PI;
+                while (reference[n][0] <= -PI) reference[n][0] += 2 * PI;
+                for (int p = 1; p < 3; p++) {
+                    if (reference[n][p] < reference_limits[n][p][0]) reference[n][p] = reference_limits[n][p][0];
+                    if (reference[n][p] > reference_limits[n][p][1]) reference[n][p] = reference_limits[n][p][1];
+                }
+            } else {
+                for (int p = 0; p < 3; p++) {
+                    if (reference[n][p] < reference_limits[n][p][0]) reference[n][p] = reference_limits[n][p][0];
+                    if (reference[n][p] > reference_limits[n][p][1]) reference[n][p] = reference_limits[n][p][1];
+                }
+            }
+        }
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+/// @brief Deterministic pseudo random number in [lo, hi)
+static float rand_range(uint32_t& seed, float lo, float hi) {
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((seed >> 8) / (float)(1u << 24));
+}
+
+/// @brief Check two floats are the same bit for bit, unlike TEST_ASSERT_EQUAL_FLOAT which allows a relative tolerance
+#define TEST_ASSERT_SAME_BITS(expected, actual) TEST_ASSERT_EQUAL_HEX32(float_bits(expected), float_bits(actual))
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/// @brief Fill reference limits with a mix of linear, wrapping and inactive states and pick a governor for each
+static void make_config(uint32_t& seed, float limits[STATE_LEN][3][2], float governor_type[STATE_LEN], bool active[STATE_LEN]) {
+    memset(limits, 0, sizeof(float) * STATE_LEN * 3 * 2);
+    for (int n = 0; n < STATE_LEN; n++) {
+        int kind = (int)rand_range(seed, 0, 3);
+        governor_type[n] = (int)rand_range(seed, 0, 3);
+        active[n] = kind != 0;
+        if (kind == 1) {
+            // linear state
+            limits[n][0][0] = -rand_range(seed, 1, 10);
+            limits[n][0][1] = rand_range(seed, 1, 10);
+        } else if (kind == 2) {
+            // angle that wraps at +-pi
+            limits[n][0][0] = -3.14f;
+            limits[n][0][1] = 3.14f;
+        } else {
+            continue;
+        }
+        limits[n][1][0] = -rand_range(seed, 1, 20);
+        limits[n][1][1] = rand_range(seed, 1, 20);
+        limits[n][2][0] = -rand_range(seed, 5, 50);
+        limits[n][2][1] = rand_range(seed, 5, 50);
+    }
+}
+
+/// @brief Run the governor plan and the legacy governor on the same random targets and check the references match every step
+static void check_against_legacy(uint32_t seed) {
+    float limits[STATE_LEN][3][2];
+    float governor_type[STATE_LEN];
+    bool active[STATE_LEN];
+    make_config(seed, limits, governor_type, active);
+
+    State state;
+    LegacyGovernor legacy;
+    float start[STATE_LEN][3] = { { 0 } };
+    state.set_reference_limits(limits);
+    state.set_reference(start);
+    memcpy(legacy.reference_limits, limits, sizeof(limits));
+
+    float target[STATE_LEN][3] = { { 0 } };
+    for (int step = 0; step < 5000; step++) {
+        // move the targets now and then so both the driving and settling paths are covered
+        if (step % 250 == 0) {
+            for (int n = 0; n < STATE_LEN; n++) {
+                target[n][0] = rand_range(seed, -12, 12);
+                target[n][1] = rand_range(seed, -25, 25);
+                target[n][2] = rand_range(seed, -60, 60);
+            }
+        }
+
+        float plan_target[STATE_LEN][3];
+        float legacy_target[STATE_LEN][3];
+        memcpy(plan_target, target, sizeof(target));
+        memcpy(legacy_target, target, sizeof(target));
+
+        LoopTime time;
+        time.dt = rand_range(seed, 0.0009f, 0.0011f);
+        state.step_reference(plan_target, governor_type, time);
+        legacy.step_reference(legacy_target, governor_type, time.dt);
+
+        float reference[STATE_LEN][3];
+        state.get_reference(reference);
+        for (int n = 0; n < STATE_LEN; n++) {
+            for (int p = 0; p < 3; p++) {
+                TEST_ASSERT_SAME_BITS(legacy.reference[n][p], reference[n][p]);
+                // the plan leaves the targets of inactive states untouched, the legacy governor clamped them to 0
+                if (active[n]) TEST_ASSERT_SAME_BITS(legacy_target[n][p], plan_target[n][p]);
+            }
+        }
+    }
+}
+
+void test_plan_matches_legacy_governor() {
+    for (uint32_t seed = 1; seed <= 20; seed++) check_against_legacy(seed);
+}
+
+void test_wrap_flags_follow_limits() {
+    float limits[STATE_LEN][3][2] = { { { 0 } } };
+    limits[2][0][0] = -3.14f;
+    limits[2][0][1] = 3.14f;
+    limits[3][0][0] = -3.14f;
+    limits[3][0][1] = 3.15f;
+    limits[4][0][0] = -1;
+    limits[4][0][1] = 1;
+
+    State state;
+    state.set_reference_limits(limits);
+    const bool* wrap = state.get_wrap();
+    TEST_ASSERT_TRUE(wrap[2]);
+    TEST_ASSERT_FALSE(wrap[3]);
+    TEST_ASSERT_FALSE(wrap[4]);
+    TEST_ASSERT_FALSE(wrap[5]);
+}
+
+void test_inactive_states_stay_zero() {
+    float limits[STATE_LEN][3][2] = { { { 0 } } };
+    limits[0][0][0] = -1;
+    limits[0][0][1] = 1;
+    float governor_type[STATE_LEN] = { 0 };
+
+    State state;
+    float start[STATE_LEN][3];
+    for (int n = 0; n < STATE_LEN; n++) start[n][0] = start[n][1] = start[n][2] = 0.5f;
+    state.set_reference_limits(limits);
+    state.set_reference(start);
+
+    float target[STATE_LEN][3];
+    for (int n = 0; n < STATE_LEN; n++) target[n][0] = target[n][1] = target[n][2] = 2;
+    LoopTime time;
+    time.dt = 0.001f;
+    state.step_reference(target, governor_type, time);
+
+    float reference[STATE_LEN][3];
+    state.get_reference(reference);
+    TEST_ASSERT_EQUAL_FLOAT(1, reference[0][0]);
+    for (int n = 1; n < STATE_LEN; n++) {
+        for (int p = 0; p < 3; p++) TEST_ASSERT_EQUAL_FLOAT(0, reference[n][p]);
+    }
+}
+
+void test_bench_step_reference() {
+    // a standard robot: x, y, chassis heading, yaw, pitch, feeder and flywheel governed, the other 17 states unused
+    float limits[STATE_LEN][3][2] = { { { 0 } } };
+    float governor_type[STATE_LEN] = { 0 };
+    for (int n = 0; n < 7; n++) {
+        bool is_angle = n == 2 || n == 3;
+        limits[n][0][0] = is_angle ? -3.14f : -10;
+        limits[n][0][1] = is_angle ? 3.14f : 10;
+        limits[n][1][0] = -5;
+        limits[n][1][1] = 5;
+        limits[n][2][0] = -20;
+        limits[n][2][1] = 20;
+        governor_type[n] = n < 5 ? 1 : 2;
+    }
+
+    uint32_t seed = 1;
+    float target[STATE_LEN][3] = { { 0 } };
+    for (int n = 0; n < 7; n++) {
+        for (int p = 0; p < 3; p++) target[n][p] = rand_range(seed, -3, 3);
+    }
+
+    State state;
+    LegacyGovernor legacy;
+    float start[STATE_LEN][3] = { { 0 } };
+    state.set_reference_limits(limits);
+    state.set_reference(start);
+    memcpy(legacy.reference_limits, limits, sizeof(limits));
+
+    // both governors clamp the targets in place, so each call gets a fresh copy
+    float step_target[STATE_LEN][3];
+    LoopTime time;
+    time.dt = 0.001f;
+    double old_ns = bench_ns([&]() {
+        memcpy(step_target, target, sizeof(target));
+        legacy.step_reference(step_target, governor_type, time.dt);
+        bench_keep(legacy.reference);
+    }, 100000);
+    double new_ns = bench_ns([&]() {
+        memcpy(step_target, target, sizeof(target));
+        state.step_reference(step_target, governor_type, time);
+        bench_keep(state);
+    }, 100000);
+    bench_report("step_reference, 7 of 24 states governed", old_ns, new_ns);
+
+    TEST_ASSERT_TRUE(new_ns > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_plan_matches_legacy_governor);
+    RUN_TEST(test_wrap_flags_follow_limits);
+    RUN_TEST(test_inactive_states_stay_zero);
+    RUN_TEST(test_bench_step_reference);
+    return UNITY_END();
+}
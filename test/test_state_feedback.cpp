@@ -0,0 +1,234 @@
+// before unity.h, utils/timing.hpp defines its own UINT_MAX and limits.h replaces it cleanly
+#include "controls/state_feedback.hpp"
+#include <unity.h>
+
+#include "utils/logger.hpp"
+#include "bench.hpp"
+
+Logger logger;
+
+// the chassis controllers read the power buffer from the referee system, its real constructor lives with the serial code
+RefSystem::RefSystem() {}
+RefSystem ref;
+
+/// @brief A motor of the test robot and the states it couples to
+struct TestMotor {
+    int motor;
+    int num_states;
+    uint8_t states[STATE_FEEDBACK_STATES_PER_MOTOR];
+};
+
+// four chassis wheels on x, y and psi, then gimbal yaw and pitch, with motors 6 and 7 left out of the bank
+static const TestMotor test_motors[] = {
+    { 0, 3, { 0, 1, 2 } },
+    { 1, 3, { 0, 1, 2 } },
+    { 2, 3, { 0, 1, 2 } },
+    { 3, 3, { 0, 1, 2 } },
+    { 4, 1, { 3 } },
+    { 5, 2, { 3, 4 } },
+};
+#define NUM_TEST_MOTORS (int)(sizeof(test_motors) / sizeof(test_motors[0]))
+
+static StateFeedbackBank bank;
+static float gains[NUM_MOTORS][NUM_GAINS];
+static bool wrap_states[STATE_LEN];
+static float macro_reference[STATE_LEN][3];
+static float macro_estimate[STATE_LEN][3];
+static float kinematics_p[NUM_MOTORS][STATE_LEN];
+static float kinematics_v[NUM_MOTORS][STATE_LEN];
+static uint32_t seed;
+
+/// @brief Deterministic pseudo random number in [lo, hi)
+static float rand_range(float lo, float hi) {
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((seed >> 8) / (float)(1u << 24));
+}
+
+void setUp() {
+    seed = 1;
+    bank.clear();
+    memset(gains, 0, sizeof(gains));
+    memset(wrap_states, 0, sizeof(wrap_states));
+    memset(kinematics_p, 0, sizeof(kinematics_p));
+    memset(kinematics_v, 0, sizeof(kinematics_v));
+    // chassis heading and gimbal yaw wrap
+    wrap_states[2] = true;
+    wrap_states[3] = true;
+}
+
+void tearDown() {}
+
+/// @brief Random references, estimates and kinematics on the coupled states, angles anywhere in [-pi, pi)
+static void randomize_inputs() {
+    for (int j = 0; j < STATE_LEN; j++) {
+        macro_reference[j][0] = rand_range(-PI, PI);
+        macro_estimate[j][0] = rand_range(-PI, PI);
+        macro_reference[j][1] = rand_range(-5, 5);
+        macro_estimate[j][1] = rand_range(-5, 5);
+    }
+    for (int i = 0; i < NUM_TEST_MOTORS; i++) {
+        const TestMotor& test_motor = test_motors[i];
+        for (int k = 0; k < test_motor.num_states; k++) {
+            kinematics_p[test_motor.motor][test_motor.states[k]] = rand_range(-2, 2);
+            kinematics_v[test_motor.motor][test_motor.states[k]] = rand_range(-2, 2);
+        }
+    }
+}
+
+/// @brief Add every test motor to the bank
+/// @return row of each test motor
+static void add_test_motors(int rows[NUM_TEST_MOTORS]) {
+    for (int i = 0; i < NUM_TEST_MOTORS; i++) {
+        const TestMotor& test_motor = test_motors[i];
+        rows[i] = bank.add_motor(test_motor.motor, gains[test_motor.motor], test_motor.states, test_motor.num_states, wrap_states);
+    }
+}
+
+/// @brief Plain u = K e for one motor, straight from its gains row and the kinematics
+static float reference_output(const TestMotor& test_motor) {
+    float sum = 0;
+    for (int k = 0; k < test_motor.num_states; k++) {
+        int n = test_motor.states[k];
+        int m = test_motor.motor;
+        float pos_error = macro_reference[n][0] - macro_estimate[n][0];
+        if (wrap_states[n]) {
+            if (pos_error > PI) pos_error -= 2 * PI;
+            if (pos_error < -PI) pos_error += 2 * PI;
+        }
+        float vel_error = macro_reference[n][1] - macro_estimate[n][1];
+        sum += gains[m][k] * kinematics_p[m][n] * pos_error;
+        sum += gains[m][STATE_FEEDBACK_STATES_PER_MOTOR + k] * kinematics_v[m][n] * vel_error;
+    }
+    return constrain(sum, -1.0f, 1.0f);
+}
+
+/// @brief Step the bank against the reference for many random inputs
+static void check_against_reference(const int rows[NUM_TEST_MOTORS]) {
+    for (int i = 0; i < 200; i++) {
+        randomize_inputs();
+        bank.step(macro_reference, macro_estimate, kinematics_p, kinematics_v);
+        for (int t = 0; t < NUM_TEST_MOTORS; t++) TEST_ASSERT_FLOAT_WITHIN(1e-5f, reference_output(test_motors[t]), bank.output[rows[t]]);
+    }
+}
+
+void test_small_gains_match_reference() {
+    // small enough that the outputs rarely saturate
+    for (int m = 0; m < NUM_MOTORS; m++) {
+        for (int g = 0; g < NUM_GAINS; g++) gains[m][g] = rand_range(-0.05f, 0.05f);
+    }
+    int rows[NUM_TEST_MOTORS];
+    add_test_motors(rows);
+    TEST_ASSERT_EQUAL_INT(NUM_TEST_MOTORS, bank.get_num_rows());
+    check_against_reference(rows);
+}
+
+void test_large_gains_saturate_like_reference() {
+    for (int m = 0; m < NUM_MOTORS; m++) {
+        for (int g = 0; g < NUM_GAINS; g++) gains[m][g] = rand_range(-5, 5);
+    }
+    int rows[NUM_TEST_MOTORS];
+    add_test_motors(rows);
+    check_against_reference(rows);
+}
+
+void test_sparse_gains_match_reference() {
+    // position only on some motors, velocity only on others, and one motor with every gain zero
+    for (int m = 0; m < NUM_MOTORS; m++) {
+        for (int k = 0; k < STATE_FEEDBACK_STATES_PER_MOTOR; k++) {
+            if (m % 2 == 0) gains[m][k] = rand_range(-0.1f, 0.1f);
+            else gains[m][STATE_FEEDBACK_STATES_PER_MOTOR + k] = rand_range(-0.1f, 0.1f);
+        }
+    }
+    memset(gains[4], 0, sizeof(gains[4]));
+    int rows[NUM_TEST_MOTORS];
+    add_test_motors(rows);
+    check_against_reference(rows);
+    TEST_ASSERT_EQUAL_FLOAT(0, bank.output[rows[4]]);
+}
+
+void test_unassigned_states_do_not_leak_between_motors() {
+    // only the pitch gains are set: its yaw and pitch errors must not reach the chassis or the yaw motor
+    gains[5][0] = 0.1f;
+    gains[5][1] = 0.2f;
+    gains[5][STATE_FEEDBACK_STATES_PER_MOTOR] = 0.01f;
+    gains[5][STATE_FEEDBACK_STATES_PER_MOTOR + 1] = 0.02f;
+    int rows[NUM_TEST_MOTORS];
+    add_test_motors(rows);
+
+    for (int i = 0; i < 50; i++) {
+        randomize_inputs();
+        // entries the motors aren't coupled to don't matter either, the bank only reads each motor's own states
+        for (int m = 0; m < NUM_MOTORS; m++) kinematics_p[m][6] = kinematics_v[m][6] = 100;
+        bank.step(macro_reference, macro_estimate, kinematics_p, kinematics_v);
+        for (int t = 0; t < 5; t++) TEST_ASSERT_EQUAL_FLOAT(0, bank.output[rows[t]]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, reference_output(test_motors[5]), bank.output[rows[5]]);
+    }
+}
+
+void test_position_error_wraps() {
+    gains[4][0] = 0.1f;
+    const TestMotor yaw = test_motors[4];
+    int row = bank.add_motor(yaw.motor, gains[yaw.motor], yaw.states, yaw.num_states, wrap_states);
+    kinematics_p[4][3] = 1;
+
+    memset(macro_reference, 0, sizeof(macro_reference));
+    memset(macro_estimate, 0, sizeof(macro_estimate));
+    // 3 rad to -3 rad is 0.28 rad the short way around, not -6 rad
+    macro_reference[3][0] = -3;
+    macro_estimate[3][0] = 3;
+    bank.step(macro_reference, macro_estimate, kinematics_p, kinematics_v);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.1f * (float)(2 * PI - 6), bank.output[row]);
+}
+
+void test_bench_step() {
+    for (int m = 0; m < NUM_MOTORS; m++) {
+        for (int g = 0; g < NUM_GAINS; g++) gains[m][g] = rand_range(-0.05f, 0.05f);
+    }
+    int rows[NUM_TEST_MOTORS];
+    add_test_motors(rows);
+    randomize_inputs();
+
+    // what coupled control cost before: a FullStateFeedbackController (two PIDs) per motor and coupled state
+    FullStateFeedbackController controllers[NUM_TEST_MOTORS] = { 2, 2, 2, 2, 2, 2 };
+    for (int i = 0; i < NUM_TEST_MOTORS; i++) controllers[i].set_gains(gains[test_motors[i].motor]);
+    float outputs[NUM_TEST_MOTORS];
+    double old_ns = bench_ns([&]() {
+        for (int i = 0; i < NUM_TEST_MOTORS; i++) {
+            const TestMotor& test_motor = test_motors[i];
+            float output = 0;
+            for (int k = 0; k < test_motor.num_states; k++) {
+                int n = test_motor.states[k];
+                float reference[3] = { macro_reference[n][0] * kinematics_p[i][n], macro_reference[n][1] * kinematics_v[i][n], 0 };
+                float estimate[3] = { macro_estimate[n][0] * kinematics_p[i][n], macro_estimate[n][1] * kinematics_v[i][n], 0 };
+                output += controllers[i].step(reference, estimate, 0.001f);
+            }
+            outputs[i] = output;
+        }
+        bench_keep(outputs);
+    }, 100000);
+
+    double new_ns = bench_ns([&]() {
+        bank.step(macro_reference, macro_estimate, kinematics_p, kinematics_v);
+        bench_keep(bank.output);
+    }, 100000);
+    bench_report("state feedback of 4 chassis motors and the gimbal", old_ns, new_ns);
+
+    double reference_ns = bench_ns([&]() {
+        for (int i = 0; i < NUM_TEST_MOTORS; i++) outputs[i] = reference_output(test_motors[i]);
+        bench_keep(outputs);
+    }, 100000);
+    printf("[bench] plain per-motor K e reference: %.1f ns\n", reference_ns);
+
+    TEST_ASSERT_TRUE(new_ns > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_small_gains_match_reference);
+    RUN_TEST(test_large_gains_saturate_like_reference);
+    RUN_TEST(test_sparse_gains_match_reference);
+    RUN_TEST(test_unassigned_states_do_not_leak_between_motors);
+    RUN_TEST(test_position_error_wraps);
+    RUN_TEST(test_bench_step);
+    return UNITY_END();
+}
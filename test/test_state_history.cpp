@@ -0,0 +1,142 @@
+#include <unity.h>
+
+#include "controls/state_history.hpp"
+
+static StateHistory history;
+static float estimate[STATE_LEN][3];
+static float reference[STATE_LEN][3];
+
+void setUp() {
+    history.clear();
+    memset(estimate, 0, sizeof(estimate));
+    memset(reference, 0, sizeof(reference));
+}
+
+void tearDown() {}
+
+/// @brief Record a step with a marker in the estimate of state 0, so a found snapshot can be identified
+static void record_step(uint32_t time_us, uint16_t packet_id, float marker) {
+    estimate[0][0] = marker;
+    history.record(time_us, packet_id, estimate, reference);
+}
+
+void test_empty_history_finds_nothing() {
+    TEST_ASSERT_NULL(history.latest());
+    TEST_ASSERT_NULL(history.find_packet(1));
+    TEST_ASSERT_NULL(history.find_time(0));
+}
+
+void test_find_packet_returns_matching_snapshot() {
+    for (int i = 0; i < 10; i++) record_step(1000 * i, 100 + i, i);
+
+    const StateSnapshot* snapshot = history.find_packet(104);
+    TEST_ASSERT_NOT_NULL(snapshot);
+    TEST_ASSERT_EQUAL_UINT16(104, snapshot->packet_id);
+    TEST_ASSERT_EQUAL_FLOAT(4, snapshot->estimate[0][0]);
+    TEST_ASSERT_NULL(history.find_packet(99));
+}
+
+void test_find_packet_forgets_overwritten_snapshots() {
+    // more steps than the history holds, with packet IDs wrapping past 65535 and skipping 0 like main.cpp
+    uint16_t packet_id = UINT16_MAX - 60;
+    for (int i = 0; i < STATE_HISTORY_LEN + 40; i++) {
+        record_step(1000 * i, packet_id, i);
+        packet_id = packet_id == UINT16_MAX ? 1 : packet_id + 1;
+    }
+    TEST_ASSERT_EQUAL_INT(STATE_HISTORY_LEN, history.size());
+
+    // the oldest 40 are gone
+    TEST_ASSERT_NULL(history.find_packet(UINT16_MAX - 60));
+    TEST_ASSERT_NULL(history.find_packet(UINT16_MAX - 21));
+    TEST_ASSERT_NOT_NULL(history.find_packet(UINT16_MAX - 20));
+    // the first ID after the wrap is still held
+    const StateSnapshot* snapshot = history.find_packet(1);
+    TEST_ASSERT_NOT_NULL(snapshot);
+    TEST_ASSERT_EQUAL_FLOAT(61, snapshot->estimate[0][0]);
+    // newest
+    TEST_ASSERT_EQUAL_PTR(history.latest(), history.find_packet(packet_id - 1));
+}
+
+void test_find_time_returns_latest_at_or_before() {
+    for (int i = 0; i < 10; i++) record_step(1000 * i, i + 1, i);
+
+    TEST_ASSERT_EQUAL_FLOAT(3, history.find_time(3000)->estimate[0][0]);
+    TEST_ASSERT_EQUAL_FLOAT(3, history.find_time(3999)->estimate[0][0]);
+    TEST_ASSERT_EQUAL_FLOAT(0, history.find_time(0)->estimate[0][0]);
+    // newer than the newest gives the newest
+    TEST_ASSERT_EQUAL_FLOAT(9, history.find_time(20000)->estimate[0][0]);
+}
+
+void test_find_time_across_micros_rollover() {
+    // steps straddle micros() wrapping from 2^32 - 1 to 0
+    uint32_t start = UINT32_MAX - 4500;
+    for (int i = 0; i < 10; i++) record_step(start + 1000 * i, i + 1, i);
+
+    // before the rollover
+    TEST_ASSERT_EQUAL_FLOAT(2, history.find_time(start + 2500)->estimate[0][0]);
+    // the step just before the rollover
+    TEST_ASSERT_EQUAL_FLOAT(4, history.find_time(UINT32_MAX)->estimate[0][0]);
+    // just after the rollover
+    TEST_ASSERT_EQUAL_FLOAT(4, history.find_time(100)->estimate[0][0]);
+    TEST_ASSERT_EQUAL_FLOAT(5, history.find_time(start + 5000)->estimate[0][0]);
+    // older than the history
+    TEST_ASSERT_NULL(history.find_time(start - 1));
+}
+
+void test_repropagate_carries_the_correction_to_now() {
+    record_step(0, 1, 1.0f);
+    const StateSnapshot* past = history.find_packet(1);
+
+    float measured[STATE_LEN][3] = { { 0 } };
+    float current[STATE_LEN][3] = { { 0 } };
+    measured[0][0] = 1.5f;  // the estimate was 0.5 short at that step
+    measured[0][1] = 0.2f;
+    current[0][0] = 3.0f;   // robot has moved 2 since
+    current[0][1] = 0.1f;
+    history.repropagate(past, measured, current);
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 3.5f, current[0][0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.3f, current[0][1]);
+}
+
+void test_repropagate_wraps_angles() {
+    bool wrap[STATE_LEN] = { false };
+    wrap[3] = true;
+    history.set_wrap(wrap);
+
+    estimate[3][0] = -3.0f;
+    history.record(0, 1, estimate, reference);
+    const StateSnapshot* past = history.latest();
+
+    // the measurement moves the yaw another 0.1 past -pi
+    float measured[STATE_LEN][3] = { { 0 } };
+    float current[STATE_LEN][3] = { { 0 } };
+    measured[3][0] = -3.1f;
+    current[3][0] = -3.1f;
+    history.repropagate(past, measured, current);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, -3.2f + 2 * PI, current[3][0]);
+
+    // a measurement on the other side of the wrap is the same small correction
+    measured[3][0] = 3.1f;
+    current[3][0] = -2.9f;
+    history.repropagate(past, measured, current);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, -2.9f + (3.1f - 2 * PI + 3.0f), current[3][0]);
+
+    // states that don't wrap are left unwrapped
+    measured[0][0] = 10.0f;
+    current[0][0] = 0;
+    history.repropagate(past, measured, current);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 10.0f, current[0][0]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_history_finds_nothing);
+    RUN_TEST(test_find_packet_returns_matching_snapshot);
+    RUN_TEST(test_find_packet_forgets_overwritten_snapshots);
+    RUN_TEST(test_find_time_returns_latest_at_or_before);
+    RUN_TEST(test_find_time_across_micros_rollover);
+    RUN_TEST(test_repropagate_carries_the_correction_to_now);
+    RUN_TEST(test_repropagate_wraps_angles);
+    return UNITY_END();
+}